@@ -0,0 +1,123 @@
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CommonStructs.h"
+
+// Synthetic inputs shared by the benchmarks. Everything is derived from a
+// fixed seed so runs on different machines and revisions see the same data.
+namespace BenchCorpus
+{
+    // Directory written by gen_corpus.py (txt/, docx/, pdf/ subfolders).
+    // PURECPP_BENCH_CORPUS overrides the location configured by CMake.
+    inline std::filesystem::path Dir()
+    {
+        if (const char *env = std::getenv("PURECPP_BENCH_CORPUS"))
+            return env;
+        return PURECPP_BENCH_CORPUS_DIR;
+    }
+
+    // Zipf-distributed vocabulary with a few accented words, so tokenizers,
+    // BM25 and accent folding see realistic skew.
+    class TextGenerator
+    {
+    public:
+        explicit TextGenerator(std::uint64_t seed = 42, std::size_t vocabulary = 5000) : m_rng(seed)
+        {
+            static const char *syllables[] = {"ka", "lo", "re", "tin", "mar", "so", "ve", "qu", "an", "dro",
+                                              "pel", "ti", "ção", "né", "ar", "bu", "es", "mi", "ro", "zé"};
+            std::uniform_int_distribution<int> len(1, 4), syl(0, std::size(syllables) - 1);
+            m_words.reserve(vocabulary);
+            std::vector<double> weights;
+            weights.reserve(vocabulary);
+            for (std::size_t i = 0; i < vocabulary; ++i)
+            {
+                std::string w;
+                for (int s = len(m_rng); s > 0; --s)
+                    w += syllables[syl(m_rng)];
+                m_words.push_back(std::move(w));
+                weights.push_back(1.0 / double(i + 1));
+            }
+            m_pick = std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+        }
+
+        inline const std::string &Word() { return m_words[m_pick(m_rng)]; }
+
+        // Sentences of 6..24 words, with the odd URL, e-mail address and run
+        // of whitespace for the cleaner to strip.
+        std::string Text(std::size_t words)
+        {
+            std::string out;
+            out.reserve(words * 8);
+            std::uniform_int_distribution<int> sentence(6, 24), noise(0, 99);
+            int left = sentence(m_rng);
+            bool capital = true;
+            for (std::size_t i = 0; i < words; ++i)
+            {
+                std::string w = Word();
+                if (capital && !w.empty() && w[0] >= 'a' && w[0] <= 'z')
+                    w[0] = char(w[0] - 'a' + 'A');
+                capital = false;
+                out += w;
+                const int n = noise(m_rng);
+                if (n == 0)
+                    out += " https://example.com/" + Word() + "?id=" + std::to_string(i);
+                else if (n == 1)
+                    out += " " + Word() + "@example.org";
+                if (--left == 0)
+                {
+                    out += n < 50 ? ".\n" : ".  ";
+                    left = sentence(m_rng);
+                    capital = true;
+                }
+                else
+                    out += ' ';
+            }
+            return out;
+        }
+
+        std::vector<RAGLibrary::Document> Documents(std::size_t count, std::size_t words)
+        {
+            std::vector<RAGLibrary::Document> docs;
+            docs.reserve(count);
+            for (std::size_t i = 0; i < count; ++i)
+                docs.emplace_back(RAGLibrary::Metadata{{"source", "doc" + std::to_string(i)}, {"group", std::to_string(i % 8)}},
+                                  Text(words));
+            return docs;
+        }
+
+        // `n` unit-length rows of `dim` floats.
+        std::vector<float> Embeddings(std::size_t n, std::size_t dim)
+        {
+            std::normal_distribution<float> g;
+            std::vector<float> out(n * dim);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                float *row = out.data() + i * dim;
+                double norm = 0.0;
+                for (std::size_t d = 0; d < dim; ++d)
+                {
+                    row[d] = g(m_rng);
+                    norm += double(row[d]) * row[d];
+                }
+                const float inv = float(1.0 / std::sqrt(norm));
+                for (std::size_t d = 0; d < dim; ++d)
+                    row[d] *= inv;
+            }
+            return out;
+        }
+
+    private:
+        std::mt19937_64 m_rng;
+        std::vector<std::string> m_words;
+        std::discrete_distribution<std::size_t> m_pick;
+    };
+}
+#endif
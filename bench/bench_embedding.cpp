@@ -0,0 +1,77 @@
+// Embedding-side benchmarks: tokenization and pooling.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+
+#include <tokenizers_cpp.h>
+
+#include "bench_corpus.h"
+#include "FileUtilsLocal.h"
+#include "ChunkCommons/ChunkCommons.h"
+
+namespace
+{
+    // PURECPP_BENCH_TOKENIZER points at a HuggingFace tokenizer.json, e.g.
+    // models/sentence-transformers/all-MiniLM-L6-v2/tokenizer.json.
+    void BM_TokenizeBatch(benchmark::State &state)
+    {
+        const char *path = std::getenv("PURECPP_BENCH_TOKENIZER");
+        if (path == nullptr || !std::filesystem::is_regular_file(path))
+        {
+            state.SkipWithError("PURECPP_BENCH_TOKENIZER not set");
+            return;
+        }
+        auto tokenizer = tokenizers::Tokenizer::FromBlobJSON(RAGLibrary::FileReader(path));
+        BenchCorpus::TextGenerator gen;
+        std::vector<std::string> texts;
+        size_t bytes = 0;
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            texts.push_back(gen.Text(size_t(state.range(1))));
+            bytes += texts.back().size();
+        }
+        for (auto _ : state)
+        {
+            auto ids = tokenizer->EncodeBatch(texts);
+            benchmark::DoNotOptimize(ids.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * texts.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * bytes));
+    }
+
+    // One sequence of range(0) tokens with range(1)-wide hidden states; the
+    // last quarter is padding.
+    void BM_MeanPooling(benchmark::State &state)
+    {
+        const size_t tokens = size_t(state.range(0)), dim = size_t(state.range(1));
+        BenchCorpus::TextGenerator gen;
+        const auto hidden = gen.Embeddings(tokens, dim);
+        std::vector<int64_t> mask(tokens, 1);
+        std::fill(mask.begin() + tokens * 3 / 4, mask.end(), 0);
+        for (auto _ : state)
+        {
+            auto pooled = Chunk::MeanPooling(hidden, mask, dim);
+            benchmark::DoNotOptimize(pooled.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations() * hidden.size() * sizeof(float)));
+    }
+
+    void BM_NormalizeEmbeddings(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        auto emb = gen.Embeddings(1, size_t(state.range(0)));
+        for (auto _ : state)
+        {
+            Chunk::NormalizeEmbeddings(emb);
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(int64_t(state.iterations() * emb.size() * sizeof(float)));
+    }
+}
+
+BENCHMARK(BM_TokenizeBatch)->Args({32, 200})->Args({256, 200})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MeanPooling)->Args({128, 384})->Args({512, 768});
+BENCHMARK(BM_NormalizeEmbeddings)->Arg(384)->Arg(1536);
@@ -0,0 +1,201 @@
+// Ingest-side benchmarks: loading, cleaning and chunking.
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <re2/re2.h>
+
+#include "bench_corpus.h"
+
+#include "PDFLoader/PDFLoader.h"
+#include "DOCXLoader/DOCXLoader.h"
+#include "TXTLoader/TXTLoader.h"
+#include "ContentCleaner/ContentCleaner.h"
+#include "ChunkCommons/ChunkCommons.h"
+#include "ChunkDefault/ChunkDefault.h"
+#include "ChunkDedup/ChunkDedup.h"
+#include "ChunkCount/ChunkCount.h"
+#include "ChunkSimilarity/ChunkSimilarity.h"
+
+namespace
+{
+    size_t TotalBytes(const std::vector<RAGLibrary::Document> &docs)
+    {
+        return std::accumulate(docs.begin(), docs.end(), size_t(0), [](size_t n, const RAGLibrary::Document &d)
+                               { return n + d.page_content.size(); });
+    }
+
+    using LoadFn = std::vector<RAGLibrary::Document> (*)(const std::string &, unsigned);
+
+    template <typename Loader>
+    std::vector<RAGLibrary::Document> LoadWith(const std::string &path, unsigned threads)
+    {
+        Loader loader(path, threads);
+        return loader.Load();
+    }
+
+    // Extraction of every file in a corpus subfolder, range(0) loader threads.
+    void BM_Loader(benchmark::State &state, const char *folder, LoadFn load)
+    {
+        const auto dir = BenchCorpus::Dir() / folder;
+        if (!std::filesystem::is_directory(dir))
+        {
+            state.SkipWithError(("corpus not found: " + dir.string() + " (run the bench_corpus target)").c_str());
+            return;
+        }
+        size_t docs = 0, bytes = 0;
+        for (auto _ : state)
+        {
+            auto out = load(dir.string(), unsigned(state.range(0)));
+            docs += out.size();
+            bytes += TotalBytes(out);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(int64_t(docs));
+        state.SetBytesProcessed(int64_t(bytes));
+    }
+
+    void BM_ContentCleaner(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        const auto docs = gen.Documents(size_t(state.range(0)), 2000);
+        CleanData::ContentCleaner cleaner({R"(https?://\S+)", R"([\w.+-]+@[\w-]+\.[\w.]+)", R"(\s{2,})"});
+        for (auto _ : state)
+        {
+            auto out = cleaner.ProcessDocuments(docs, {}, int(state.range(1)));
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * TotalBytes(docs)));
+    }
+
+    // Built-in paths: the default patterns (vectorized kernel) and the
+    // Unicode ops; both bypass RE2.
+    void BM_ContentCleanerBuiltin(benchmark::State &state, std::vector<std::string> patterns)
+    {
+        BenchCorpus::TextGenerator gen;
+        const auto docs = gen.Documents(size_t(state.range(0)), 2000);
+        CleanData::ContentCleaner cleaner(patterns);
+        for (auto _ : state)
+        {
+            auto out = cleaner.ProcessDocuments(docs, {}, int(state.range(1)));
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * TotalBytes(docs)));
+    }
+
+    void BM_SplitText(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        const std::string text = gen.Text(size_t(state.range(0)));
+        for (auto _ : state)
+        {
+            auto out = Chunk::SplitText(text, 20, 100);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations() * text.size()));
+    }
+
+    void BM_SplitTextByCount(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        const std::string text = gen.Text(size_t(state.range(0)));
+        const auto regex = std::make_shared<re2::RE2>(R"((\.))");
+        for (auto _ : state)
+        {
+            auto out = Chunk::SplitTextByCount(text, 10, 5, regex);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetBytesProcessed(int64_t(state.iterations() * text.size()));
+    }
+
+    void BM_ChunkDefault(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        const auto docs = gen.Documents(size_t(state.range(0)), 2000);
+        for (auto _ : state)
+        {
+            Chunk::ChunkDefault chunks(500, 50, docs, int(state.range(1)));
+            benchmark::DoNotOptimize(chunks.getChunks().data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * TotalBytes(docs)));
+    }
+
+    // range(0) chunks of 100 words, a third of them repeats of a few
+    // boilerplate texts.
+    void BM_ChunkDedup(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        auto docs = gen.Documents(size_t(state.range(0)), 100);
+        const auto boilerplate = gen.Documents(8, 100);
+        for (size_t i = 0; i < docs.size(); i += 3)
+            docs[i].page_content = boilerplate[i % boilerplate.size()].page_content;
+        const Chunk::ChunkDedup dedup;
+        for (auto _ : state)
+        {
+            auto canonical = dedup.Find(docs, int(state.range(1)));
+            benchmark::DoNotOptimize(canonical.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * TotalBytes(docs)));
+    }
+
+    void BM_ChunkCount(benchmark::State &state)
+    {
+        BenchCorpus::TextGenerator gen;
+        const auto docs = gen.Documents(size_t(state.range(0)), 2000);
+        Chunk::ChunkCount chunker(".", 1, 5);
+        for (auto _ : state)
+        {
+            auto out = chunker.ProcessDocuments(docs, int(state.range(1)));
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+        state.SetBytesProcessed(int64_t(state.iterations() * TotalBytes(docs)));
+    }
+
+    // Needs an embedding model: PURECPP_BENCH_EMBED_MODEL names a model
+    // resolvable by Chunk::Embeddings (local ONNX export or OpenAI, with
+    // OPENAI_API_KEY set).
+    void BM_ChunkSimilarity(benchmark::State &state)
+    {
+        const char *model = std::getenv("PURECPP_BENCH_EMBED_MODEL");
+        if (model == nullptr)
+        {
+            state.SkipWithError("PURECPP_BENCH_EMBED_MODEL not set");
+            return;
+        }
+        const char *key = std::getenv("OPENAI_API_KEY");
+        BenchCorpus::TextGenerator gen;
+        const auto docs = gen.Documents(size_t(state.range(0)), 500);
+        Chunk::ChunkSimilarity chunker(100, 20, model, key ? key : "");
+        for (auto _ : state)
+        {
+            auto out = chunker.ProcessDocuments(docs, 4);
+            benchmark::DoNotOptimize(out.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * docs.size()));
+    }
+}
+
+BENCHMARK_CAPTURE(BM_Loader, txt, "txt", &LoadWith<TXTLoader::TXTLoader>)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Loader, docx, "docx", &LoadWith<DOCXLoader::DOCXLoader>)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Loader, pdf, "pdf", &LoadWith<PDFLoader::PDFLoader>)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK(BM_ContentCleaner)->Args({256, 1})->Args({256, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ContentCleanerBuiltin, default, std::vector<std::string>{})->Args({256, 1})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ContentCleanerBuiltin, unicode_ops, std::vector<std::string>{"op:nfkc", "op:strip_control", "op:dehyphenate", "op:collapse_whitespace"})
+    ->Args({256, 1})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SplitText)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK(BM_SplitTextByCount)->Arg(1 << 12)->Arg(1 << 16);
+BENCHMARK(BM_ChunkDefault)->Args({256, 1})->Args({256, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ChunkDedup)->Args({20000, 1})->Args({20000, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ChunkCount)->Args({256, 1})->Args({256, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ChunkSimilarity)->Arg(16)->Unit(benchmark::kMillisecond)->UseRealTime();
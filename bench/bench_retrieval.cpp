@@ -0,0 +1,183 @@
+// Retrieval benchmarks: ChunkQuery over in-memory chunks and the vdb backends.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <tuple>
+
+#include <nlohmann/json.hpp>
+
+#include "bench_corpus.h"
+#include "ChunkDefault/ChunkDefault.h"
+#include "ChunkQuery/ChunkQuery.h"
+#include "vectordb/registry.h"
+
+namespace vdb
+{
+    void force_link_redis_backend();
+    void force_link_hnsw_backend();
+    void force_link_ivfpq_backend();
+    void force_link_binary_backend();
+}
+
+namespace
+{
+    constexpr const char *kModel = "bench-synthetic";
+
+    // One short document per chunk, with random unit embeddings attached.
+    // Stores are built once per (n, dim, storage) and shared by every run.
+    const Chunk::ChunkDefault &Store(size_t n, size_t dim, int variant)
+    {
+        static std::mutex mutex;
+        static std::map<std::tuple<size_t, size_t, int>, std::unique_ptr<Chunk::ChunkDefault>> cache;
+        std::lock_guard lock(mutex);
+        auto &slot = cache[{n, dim, variant}];
+        if (!slot)
+        {
+            BenchCorpus::TextGenerator gen(7);
+            slot = std::make_unique<Chunk::ChunkDefault>(1000, 0, gen.Documents(n, 12), 8);
+            const size_t chunks = slot->getChunks().size();
+            slot->AddEmb(kModel, gen.Embeddings(chunks, dim), dim);
+            if (variant == 1)
+                slot->Quantize(0, Chunk::StorageType::INT8, true, 8);
+            else if (variant == 2)
+                slot->BuildBinaryIndex(0, 8);
+        }
+        return *slot;
+    }
+
+    // range(0) chunks, range(1) dims, top-10. The variant selects FP32
+    // exact, INT8 with float re-ranking, or the binary Hamming pre-pass.
+    void BM_ChunkQueryRetrieve(benchmark::State &state, int variant)
+    {
+        const size_t n = size_t(state.range(0)), dim = size_t(state.range(1));
+        const auto &chunks = Store(n, dim, variant);
+
+        BenchCorpus::TextGenerator gen(11);
+        RAGLibrary::Document query({{"model", kModel}}, "synthetic query", gen.Embeddings(1, dim));
+        Chunk::ChunkQuery q;
+        q.Query(query, &chunks, 0);
+        if (variant == 1)
+            q.setRerank(4);
+        else if (variant == 2)
+            q.setSearchMode(Chunk::SearchMode::Binary, 10);
+
+        for (auto _ : state)
+        {
+            auto hits = q.Retrieve(size_t(10), -1.0f);
+            benchmark::DoNotOptimize(hits.data());
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * chunks.getChunks().size()));
+    }
+
+    std::vector<RAGLibrary::Document> VdbDocs(size_t n, size_t dim, uint64_t seed)
+    {
+        BenchCorpus::TextGenerator gen(seed);
+        const auto flat = gen.Embeddings(n, dim);
+        std::vector<RAGLibrary::Document> docs;
+        docs.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            docs.emplace_back(RAGLibrary::Metadata{{"id", std::to_string(i)}, {"group", std::to_string(i % 8)}},
+                              "doc " + std::to_string(i),
+                              std::vector<float>(flat.begin() + i * dim, flat.begin() + (i + 1) * dim));
+        return docs;
+    }
+
+    // Backend config for the benchmarks; redis needs PURECPP_BENCH_REDIS_URI.
+    std::optional<nlohmann::json> VdbConfig(const std::string &name, size_t n, size_t dim)
+    {
+        nlohmann::json cfg = {{"dim", dim}, {"capacity", n}};
+        if (name == "ivfpq")
+        {
+            cfg["nlist"] = 256;
+            cfg["train_size"] = std::min<size_t>(n, 256 * 39);
+        }
+        else if (name == "redis")
+        {
+            const char *uri = std::getenv("PURECPP_BENCH_REDIS_URI");
+            if (uri == nullptr)
+                return std::nullopt;
+            cfg["uri"] = uri;
+            cfg["index"] = "purecpp_bench_idx";
+            cfg["prefix"] = "purecpp_bench";
+        }
+        return cfg;
+    }
+
+    void LinkBackends()
+    {
+        vdb::force_link_redis_backend();
+        vdb::force_link_hnsw_backend();
+        vdb::force_link_ivfpq_backend();
+        vdb::force_link_binary_backend();
+    }
+
+    void BM_VdbInsert(benchmark::State &state, const std::string &name)
+    {
+        LinkBackends();
+        const size_t n = size_t(state.range(0)), dim = size_t(state.range(1));
+        const auto cfg = VdbConfig(name, n, dim);
+        if (!cfg)
+        {
+            state.SkipWithError("PURECPP_BENCH_REDIS_URI not set");
+            return;
+        }
+        const auto docs = VdbDocs(n, dim, 3);
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            auto backend = vdb::Registry::instance().make(name, *cfg);
+            state.ResumeTiming();
+            backend->insert(docs);
+            state.PauseTiming();
+            backend->close();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(int64_t(state.iterations() * n));
+    }
+
+    void BM_VdbQuery(benchmark::State &state, const std::string &name)
+    {
+        LinkBackends();
+        const size_t n = size_t(state.range(0)), dim = size_t(state.range(1));
+        const auto cfg = VdbConfig(name, n, dim);
+        if (!cfg)
+        {
+            state.SkipWithError("PURECPP_BENCH_REDIS_URI not set");
+            return;
+        }
+        auto backend = vdb::Registry::instance().make(name, *cfg);
+        backend->insert(VdbDocs(n, dim, 3));
+
+        BenchCorpus::TextGenerator gen(5);
+        const auto queries = gen.Embeddings(64, dim);
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            std::span<const float> q(queries.data() + (i++ % 64) * dim, dim);
+            auto hits = backend->query(q, 10);
+            benchmark::DoNotOptimize(hits.data());
+        }
+        backend->close();
+        state.SetItemsProcessed(int64_t(state.iterations()));
+    }
+}
+
+BENCHMARK_CAPTURE(BM_ChunkQueryRetrieve, fp32, 0)->Args({10000, 384})->Args({100000, 384});
+BENCHMARK_CAPTURE(BM_ChunkQueryRetrieve, int8, 1)->Args({10000, 384})->Args({100000, 384});
+BENCHMARK_CAPTURE(BM_ChunkQueryRetrieve, binary, 2)->Args({10000, 384})->Args({100000, 384});
+
+BENCHMARK_CAPTURE(BM_VdbInsert, hnsw, std::string("hnsw"))->Args({10000, 128})->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_VdbInsert, ivfpq, std::string("ivfpq"))->Args({10000, 128})->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_VdbInsert, binary, std::string("binary"))->Args({10000, 128})->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_VdbInsert, redis, std::string("redis"))->Args({10000, 128})->Unit(benchmark::kMillisecond)->Iterations(3);
+
+BENCHMARK_CAPTURE(BM_VdbQuery, hnsw, std::string("hnsw"))->Args({10000, 128});
+BENCHMARK_CAPTURE(BM_VdbQuery, ivfpq, std::string("ivfpq"))->Args({10000, 128});
+BENCHMARK_CAPTURE(BM_VdbQuery, binary, std::string("binary"))->Args({10000, 128});
+BENCHMARK_CAPTURE(BM_VdbQuery, redis, std::string("redis"))->Args({10000, 128});
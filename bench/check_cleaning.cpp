@@ -0,0 +1,161 @@
+// Differential check of the ContentCleaner fast paths.
+//
+// Built twice by bench/CMakeLists.txt, once without and once with AVX2, so
+// both kernels in CleaningOps are compared against RE2 on the same inputs:
+//   - the default kernel against the fused RE2 pass and against the
+//     original one-GlobalReplace-per-pattern cleaner (valid UTF-8 only; on
+//     malformed input the kernel hands over to RE2, which is still checked
+//     against the fused pass),
+//   - the byte-class ops against GlobalReplace of the regex they replace.
+// Exits non-zero and prints the first differing input on a mismatch.
+//
+//   cmake --build <build> --target check_cleaning
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <re2/re2.h>
+
+#include "ContentCleaner/ContentCleaner.h"
+#include "ContentCleaner/CleaningOps.h"
+
+namespace
+{
+    constexpr std::string_view kSpaces = "\\s+";
+    constexpr std::string_view kNonAscii = "[^\\x00-\\x7F]+";
+    constexpr std::string_view kSymbols = "^\\W+|\\W+$";
+
+    class Cleaner : public CleanData::ContentCleaner
+    {
+    public:
+        using CleanData::ContentCleaner::ContentCleaner;
+        using CleanData::ContentCleaner::CleanContent;
+    };
+
+    void Trim(std::string &text)
+    {
+        auto isNoSpace = [](unsigned char ch)
+        { return !std::isspace(ch); };
+        text.erase(text.begin(), std::find_if(text.begin(), text.end(), isNoSpace));
+        text.erase(std::find_if(text.rbegin(), text.rend(), isNoSpace).base(), text.end());
+    }
+
+    // The cleaner before the patterns were fused: one GlobalReplace per
+    // pattern, in the original order, then a trim.
+    std::string CleanSequential(std::string text)
+    {
+        static const re2::RE2 spaces{std::string(kSpaces)};
+        static const re2::RE2 nonAscii{std::string(kNonAscii)};
+        static const re2::RE2 symbols{std::string(kSymbols)};
+        for (const re2::RE2 *regex : {&spaces, &nonAscii, &symbols})
+            re2::RE2::GlobalReplace(&text, *regex, " ");
+        Trim(text);
+        return text;
+    }
+
+    std::string Replace(std::string text, const re2::RE2 &regex, std::string_view rewrite)
+    {
+        re2::RE2::GlobalReplace(&text, regex, re2::StringPiece(rewrite.data(), rewrite.size()));
+        return text;
+    }
+
+    // Runs of words, punctuation, every ASCII space, multi-byte characters
+    // and, when `malformed`, stray and truncated UTF-8 bytes. Lengths cross
+    // the 32-byte vector blocks.
+    std::string RandomText(std::mt19937_64 &rng, bool malformed)
+    {
+        static const std::vector<std::string> pieces = {
+            "a", "Z", "9", "_", "word", "Hello", " ", "  ", "\t", "\n", "\r", "\f", "\v",
+            ".", ",", "!?", "--", "(", ")", "\"", "#", "\x01", "\x7f",
+            "\xc3\xa9", "\xc3\x87", "\xe2\x80\x94", "\xe2\x80\x8b", "\xef\xac\x81", "\xf0\x9f\x98\x80"};
+        static const std::vector<std::string> broken = {"\x80", "\xbf", "\xc3", "\xe2\x80", "\xf0\x9f", "\xff", "\xc0\xaf"};
+
+        std::uniform_int_distribution<size_t> count(0, std::uniform_int_distribution<int>(0, 9)(rng) == 0 ? 120 : 24);
+        std::uniform_int_distribution<size_t> pick(0, pieces.size() - 1);
+        std::uniform_int_distribution<size_t> pickBroken(0, broken.size() - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        std::string text;
+        for (size_t n = count(rng); n > 0; --n)
+            text += malformed && percent(rng) < 5 ? broken[pickBroken(rng)] : pieces[pick(rng)];
+        return text;
+    }
+
+    std::string Escape(std::string_view text)
+    {
+        std::string out;
+        for (const unsigned char c : text)
+        {
+            if (c >= 0x20 && c < 0x7f && c != '\\')
+            {
+                out += char(c);
+            }
+            else
+            {
+                char hex[5];
+                std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+                out += hex;
+            }
+        }
+        return out;
+    }
+
+    bool Same(const char *what, std::string_view input, const std::string &got, const std::string &want)
+    {
+        if (got == want)
+            return true;
+        std::fprintf(stderr, "%s differs\n  input: \"%s\"\n  got:   \"%s\"\n  want:  \"%s\"\n",
+                     what, Escape(input).c_str(), Escape(got).c_str(), Escape(want).c_str());
+        return false;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 200000;
+
+    Cleaner kernel;
+    // Same patterns spelled differently, so the fused RE2 pass runs instead
+    // of the kernel.
+    Cleaner fused({"(?:" + std::string(kSymbols) + ")", std::string(kSpaces), std::string(kNonAscii)});
+
+    const re2::RE2 spaces{std::string(kSpaces)};
+    const re2::RE2 nonAscii{std::string(kNonAscii)};
+    const re2::RE2 symbols{std::string(kSymbols)};
+
+    std::mt19937_64 rng(42);
+    std::string out;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        const bool malformed = i % 4 == 3;
+        const std::string text = RandomText(rng, malformed);
+        const std::string cleaned = kernel.CleanContent(text);
+
+        bool ok = Same("default kernel vs fused RE2", text, cleaned, fused.CleanContent(text));
+        if (!malformed)
+        {
+            ok = ok && Same("default kernel vs sequential RE2", text, cleaned, CleanSequential(text));
+
+            CleanData::CleaningOps::CollapseWhitespace(text, out);
+            ok = ok && Same("op:collapse_whitespace", text, out, Replace(text, spaces, " "));
+            CleanData::CleaningOps::StripNonAscii(text, out);
+            ok = ok && Same("op:strip_non_ascii", text, out, Replace(text, nonAscii, " "));
+            CleanData::CleaningOps::TrimSymbols(text, out);
+            ok = ok && Same("op:trim_symbols", text, out, Replace(text, symbols, ""));
+        }
+        if (!ok)
+            return 1;
+    }
+
+#if defined(__AVX2__)
+    const char *kernels = "AVX2";
+#else
+    const char *kernels = "scalar";
+#endif
+    std::printf("check_cleaning (%s): %zu inputs, no differences\n", kernels, iterations);
+    return 0;
+}
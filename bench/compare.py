@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Compares two Google Benchmark JSON reports and flags regressions.
+
+    purecpp_bench --benchmark_out=base.json --benchmark_repetitions=5
+    ... upgrade ...
+    purecpp_bench --benchmark_out=new.json --benchmark_repetitions=5
+    python3 bench/compare.py base.json new.json --threshold 0.05
+
+Runs are matched by name. With repetitions the median is compared,
+otherwise the single run. The exit status is 1 when any benchmark is
+slower than the threshold allows, so the script can gate CI.
+"""
+import argparse
+import json
+import sys
+from statistics import median
+
+NS_PER = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    with open(path, encoding="utf-8") as f:
+        report = json.load(f)
+    runs, medians = {}, {}
+    for b in report.get("benchmarks", []):
+        if b.get("error_occurred") or b.get("skipped"):
+            continue
+        name = b.get("run_name", b["name"])
+        value = b[metric] * NS_PER.get(b.get("time_unit", "ns"), 1.0)
+        if b.get("run_type") == "aggregate":
+            if b.get("aggregate_name") == "median":
+                medians[name] = value
+        else:
+            runs.setdefault(name, []).append(value)
+    times = {name: median(values) for name, values in runs.items()}
+    times.update(medians)
+    return times, report.get("context", {})
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("baseline")
+    ap.add_argument("contender")
+    ap.add_argument("--threshold", type=float, default=0.05,
+                    help="relative slowdown reported as a regression (default 0.05 = 5%%)")
+    ap.add_argument("--metric", choices=("real_time", "cpu_time"), default="real_time")
+    ap.add_argument("--filter", default="", help="only compare names containing this string")
+    args = ap.parse_args()
+
+    base, base_ctx = load(args.baseline, args.metric)
+    new, new_ctx = load(args.contender, args.metric)
+    if base_ctx.get("num_cpus") != new_ctx.get("num_cpus"):
+        print(f"warning: reports come from different machines "
+              f"({base_ctx.get('num_cpus')} vs {new_ctx.get('num_cpus')} CPUs)", file=sys.stderr)
+
+    names = sorted(n for n in base.keys() & new.keys() if args.filter in n)
+    width = max((len(n) for n in names), default=10)
+    regressions = []
+    print(f"{'benchmark':<{width}}  {'baseline ns':>12}  {'contender ns':>12}  {'change':>8}")
+    for name in names:
+        change = new[name] / base[name] - 1.0 if base[name] > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        elif change < -args.threshold:
+            flag = "  improved"
+        print(f"{name:<{width}}  {base[name]:>12.4g}  {new[name]:>12.4g}  {change:>+8.1%}{flag}")
+
+    for label, missing in (("only in baseline", base.keys() - new.keys()),
+                           ("only in contender", new.keys() - base.keys())):
+        for name in sorted(n for n in missing if args.filter in n):
+            print(f"{name:<{width}}  ({label})")
+
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) above {args.threshold:.0%}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Writes the synthetic benchmark corpus: the same documents as .txt, .docx
+and .pdf, generated from a fixed seed with the standard library only.
+
+    python3 bench/gen_corpus.py --out build/bench/corpus --docs 64 --words 4000
+"""
+import argparse
+import io
+import random
+import zipfile
+from pathlib import Path
+from xml.sax.saxutils import escape
+
+SYLLABLES = ["ka", "lo", "re", "tin", "mar", "so", "ve", "qu", "an", "dro",
+             "pel", "ti", "ção", "né", "ar", "bu", "es", "mi", "ro", "zé"]
+
+
+def make_vocabulary(rng, size):
+    words = ["".join(rng.choice(SYLLABLES) for _ in range(rng.randint(1, 4))) for _ in range(size)]
+    weights = [1.0 / (i + 1) for i in range(size)]
+    return words, weights
+
+
+def make_paragraphs(rng, words, weights, total):
+    """Paragraphs of 3..8 sentences, with the odd URL and e-mail address."""
+    paragraphs, sentence, sentences = [], [], []
+    for i, w in enumerate(rng.choices(words, weights, k=total)):
+        if not sentence:
+            w = w[:1].upper() + w[1:]
+        sentence.append(w)
+        roll = rng.randrange(100)
+        if roll == 0:
+            sentence.append(f"https://example.com/{w}?id={i}")
+        elif roll == 1:
+            sentence.append(f"{w}@example.org")
+        if len(sentence) >= rng.randint(6, 24):
+            sentences.append(" ".join(sentence) + ".")
+            sentence = []
+            if len(sentences) >= rng.randint(3, 8):
+                paragraphs.append(" ".join(sentences))
+                sentences = []
+    if sentence:
+        sentences.append(" ".join(sentence) + ".")
+    if sentences:
+        paragraphs.append(" ".join(sentences))
+    return paragraphs
+
+
+def write_txt(path, paragraphs):
+    path.write_text("\n\n".join(paragraphs) + "\n", encoding="utf-8")
+
+
+def write_docx(path, paragraphs):
+    body = "".join(f'<w:p><w:r><w:t xml:space="preserve">{escape(p)}</w:t></w:r></w:p>' for p in paragraphs)
+    document = ('<?xml version="1.0" encoding="UTF-8" standalone="yes"?>'
+                '<w:document xmlns:w="http://schemas.openxmlformats.org/wordprocessingml/2006/main">'
+                f"<w:body>{body}</w:body></w:document>")
+    content_types = ('<?xml version="1.0" encoding="UTF-8" standalone="yes"?>'
+                     '<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types">'
+                     '<Default Extension="rels" ContentType="application/vnd.openxmlformats-package.relationships+xml"/>'
+                     '<Default Extension="xml" ContentType="application/xml"/>'
+                     '<Override PartName="/word/document.xml" '
+                     'ContentType="application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml"/>'
+                     "</Types>")
+    rels = ('<?xml version="1.0" encoding="UTF-8" standalone="yes"?>'
+            '<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">'
+            '<Relationship Id="rId1" '
+            'Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument" '
+            'Target="word/document.xml"/></Relationships>')
+    with zipfile.ZipFile(path, "w", zipfile.ZIP_DEFLATED) as z:
+        for name, data in (("[Content_Types].xml", content_types), ("_rels/.rels", rels),
+                           ("word/document.xml", document)):
+            info = zipfile.ZipInfo(name, date_time=(2024, 1, 1, 0, 0, 0))  # reproducible bytes
+            info.compress_type = zipfile.ZIP_DEFLATED
+            z.writestr(info, data)
+
+
+def wrap(text, width):
+    line = ""
+    for word in text.split():
+        if line and len(line) + 1 + len(word) > width:
+            yield line
+            line = word
+        else:
+            line = f"{line} {word}" if line else word
+    if line:
+        yield line
+
+
+def write_pdf(path, paragraphs, lines_per_page=48, width=90):
+    """Minimal PDF 1.4: Helvetica text pages, WinAnsi encoded."""
+    lines = []
+    for p in paragraphs:
+        lines.extend(wrap(p, width))
+        lines.append("")
+    pages = [lines[i:i + lines_per_page] for i in range(0, len(lines), lines_per_page)] or [[]]
+
+    def pdf_string(s):
+        s = s.encode("cp1252", "replace").decode("latin-1")
+        return "(" + s.replace("\\", "\\\\").replace("(", "\\(").replace(")", "\\)") + ")"
+
+    objects = {1: b"<< /Type /Catalog /Pages 2 0 R >>",
+               3: b"<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>"}
+    kids = []
+    for i, page in enumerate(pages):
+        page_id, content_id = 4 + 2 * i, 5 + 2 * i
+        kids.append(f"{page_id} 0 R")
+        ops = ["BT", "/F1 10 Tf", "14 TL", "50 760 Td"] + [f"{pdf_string(l)} Tj T*" for l in page] + ["ET"]
+        stream = "\n".join(ops).encode("latin-1")
+        objects[page_id] = (f"<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] "
+                            f"/Resources << /Font << /F1 3 0 R >> >> /Contents {content_id} 0 R >>").encode()
+        objects[content_id] = b"<< /Length %d >>\nstream\n%s\nendstream" % (len(stream), stream)
+    objects[2] = f"<< /Type /Pages /Kids [{' '.join(kids)}] /Count {len(pages)} >>".encode()
+
+    out = io.BytesIO()
+    out.write(b"%PDF-1.4\n%\xe2\xe3\xcf\xd3\n")
+    offsets = {}
+    for oid in sorted(objects):
+        offsets[oid] = out.tell()
+        out.write(b"%d 0 obj\n%s\nendobj\n" % (oid, objects[oid]))
+    xref = out.tell()
+    count = max(objects) + 1
+    out.write(b"xref\n0 %d\n0000000000 65535 f \n" % count)
+    for oid in range(1, count):
+        out.write(b"%010d 00000 n \n" % offsets[oid])
+    out.write(b"trailer\n<< /Size %d /Root 1 0 R >>\nstartxref\n%d\n%%%%EOF\n" % (count, xref))
+    path.write_bytes(out.getvalue())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--out", required=True, type=Path)
+    ap.add_argument("--docs", type=int, default=64)
+    ap.add_argument("--words", type=int, default=4000, help="words per document")
+    ap.add_argument("--vocabulary", type=int, default=5000)
+    ap.add_argument("--seed", type=int, default=42)
+    args = ap.parse_args()
+
+    rng = random.Random(args.seed)
+    words, weights = make_vocabulary(rng, args.vocabulary)
+    for kind in ("txt", "docx", "pdf"):
+        (args.out / kind).mkdir(parents=True, exist_ok=True)
+    for i in range(args.docs):
+        paragraphs = make_paragraphs(rng, words, weights, args.words)
+        name = f"doc{i:04d}"
+        write_txt(args.out / "txt" / f"{name}.txt", paragraphs)
+        write_docx(args.out / "docx" / f"{name}.docx", paragraphs)
+        write_pdf(args.out / "pdf" / f"{name}.pdf", paragraphs)
+    print(f"wrote {args.docs} documents x 3 formats to {args.out}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,352 @@
+#include "ChunkBM25.h"
+#include "RagException.h"
+#include "TopK.h"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint32_t kEnd = std::numeric_limits<uint32_t>::max();
+
+    inline void PutVarint(std::vector<uint8_t>& out, uint32_t v) {
+        while (v >= 0x80) {
+            out.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    // Unchecked: only used on posting data that Build wrote or Read validated.
+    inline uint32_t GetVarint(const uint8_t*& p) {
+        uint32_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            const uint8_t byte = *p++;
+            v |= uint32_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+    }
+
+    // Bounds-checked decode for data read from a store; false when the
+    // varint runs past `end` or does not fit 32 bits.
+    inline bool GetVarintChecked(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 35 && p < end; shift += 7) {
+            const uint8_t byte = *p++;
+            if (shift == 28 && (byte & 0x70)) return false;
+            v |= uint32_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    inline bool IsWordByte(unsigned char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+    }
+
+    inline bool IsJoiner(char c) {
+        return c == '-' || c == '.' || c == '/' || c == '_';
+    }
+
+    inline std::string Lower(std::string_view s) {
+        std::string out(s);
+        for (auto& c : out) {
+            if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+        }
+        return out;
+    }
+}
+
+// Walks one posting list block by block; a block is decoded only when the
+// cursor lands in it.
+class Chunk::ChunkBM25::Cursor
+{
+public:
+    explicit Cursor(const Postings& p) : m_p(&p) { Load(0); }
+
+    inline uint32_t doc() const { return m_pos < m_count ? m_docs[m_pos] : kEnd; }
+    inline uint32_t tf() const { return m_tfs[m_pos]; }
+
+    void Next() {
+        if (++m_pos == m_count && m_block + 1 < m_p->block_last.size()) Load(m_block + 1);
+    }
+
+    // Moves to the first posting with doc id >= target.
+    void Advance(uint32_t target) {
+        if (doc() >= target) return;
+        const auto& last = m_p->block_last;
+        if (last[m_block] < target) {
+            const auto it = std::lower_bound(last.begin() + m_block + 1, last.end(), target);
+            if (it == last.end()) {
+                m_pos = m_count;
+                return;
+            }
+            Load(size_t(it - last.begin()));
+        }
+        while (m_docs[m_pos] < target) ++m_pos;
+    }
+
+private:
+    const Postings* m_p;
+    size_t m_block = 0;
+    size_t m_pos = 0;
+    size_t m_count = 0;
+    uint32_t m_docs[kBlock];
+    uint32_t m_tfs[kBlock];
+
+    void Load(size_t block) {
+        m_block = block;
+        m_pos = 0;
+        m_count = std::min<size_t>(kBlock, m_p->df - block * kBlock);
+        const uint8_t* p = m_p->data.data() + m_p->block_offset[block];
+        uint32_t doc = block ? m_p->block_last[block - 1] : 0;
+        for (size_t i = 0; i < m_count; ++i) {
+            doc += GetVarint(p);
+            m_docs[i] = doc;
+            m_tfs[i] = GetVarint(p);
+        }
+    }
+};
+
+Chunk::ChunkBM25::ChunkBM25(float k1, float b) : m_k1(k1), m_b(b)
+{
+    if (k1 < 0.0f || b < 0.0f || b > 1.0f) {
+        throw std::invalid_argument("BM25 parameters out of range (k1 >= 0, 0 <= b <= 1).");
+    }
+}
+
+std::vector<std::string> Chunk::ChunkBM25::Tokenize(std::string_view text)
+{
+    std::vector<std::string> out;
+    const size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        if (!IsWordByte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+            continue;
+        }
+        const size_t start = i;
+        size_t parts = 0;
+        for (;;) {
+            const size_t s = i;
+            while (i < n && IsWordByte(static_cast<unsigned char>(text[i]))) ++i;
+            out.push_back(Lower(text.substr(s, i - s)));
+            ++parts;
+            if (i + 1 < n && IsJoiner(text[i]) && IsWordByte(static_cast<unsigned char>(text[i + 1]))) {
+                ++i;
+                continue;
+            }
+            break;
+        }
+        if (parts > 1) out.push_back(Lower(text.substr(start, i - start)));
+    }
+    return out;
+}
+
+void Chunk::ChunkBM25::Build(const std::vector<RAGLibrary::Document>& docs, int max_workers)
+{
+    clear();
+    const size_t n = docs.size();
+    if (n == 0) return;
+    if (n >= kEnd) throw std::length_error("Too many chunks for the BM25 index.");
+
+    std::vector<std::vector<std::string>> tokens(n);
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads) {
+        max_threads = max_workers;
+    }
+#pragma omp parallel for schedule(dynamic, 64) num_threads(max_threads)
+    for (int i = 0; i < int(n); ++i) {
+        tokens[i] = Tokenize(docs[i].page_content);
+        std::sort(tokens[i].begin(), tokens[i].end());
+    }
+
+    // Documents are visited in order, so every posting list is built sorted.
+    std::unordered_map<std::string, std::vector<std::pair<uint32_t, uint32_t>>> lists;
+    m_doc_len.resize(n);
+    double total = 0.0;
+    for (size_t d = 0; d < n; ++d) {
+        const auto& t = tokens[d];
+        m_doc_len[d] = uint32_t(t.size());
+        total += double(t.size());
+        for (size_t i = 0; i < t.size();) {
+            size_t j = i + 1;
+            while (j < t.size() && t[j] == t[i]) ++j;
+            lists[t[i]].emplace_back(uint32_t(d), uint32_t(j - i));
+            i = j;
+        }
+        std::vector<std::string>().swap(tokens[d]);
+    }
+    m_avgdl = total > 0.0 ? float(total / double(n)) : 1.0f;
+
+    m_postings.reserve(lists.size());
+    for (auto& [term, list] : lists) {
+        Postings p;
+        p.df = uint32_t(list.size());
+        p.idf = std::log(1.0f + (float(n) - float(p.df) + 0.5f) / (float(p.df) + 0.5f));
+        const size_t blocks = (list.size() + kBlock - 1) / kBlock;
+        p.block_last.reserve(blocks);
+        p.block_offset.reserve(blocks);
+        uint32_t prev = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (i % kBlock == 0) p.block_offset.push_back(uint32_t(p.data.size()));
+            const auto [doc, tf] = list[i];
+            PutVarint(p.data, doc - prev);
+            PutVarint(p.data, tf);
+            prev = doc;
+            if (i % kBlock == kBlock - 1 || i + 1 == list.size()) p.block_last.push_back(doc);
+            p.max_score = std::max(p.max_score, TermScore(p.idf, tf, m_doc_len[doc]));
+        }
+        p.data.shrink_to_fit();
+        m_postings.emplace(term, std::move(p));
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(list);
+    }
+}
+
+std::vector<std::pair<size_t, float>> Chunk::ChunkBM25::Search(std::string_view query, size_t k, const vdb::Bitmap* allowed) const
+{
+    if (k == 0 || m_doc_len.empty()) return {};
+
+    auto tokens = Tokenize(query);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    std::vector<Cursor> cursors;
+    std::vector<const Postings*> lists;
+    for (const auto& t : tokens) {
+        auto it = m_postings.find(t);
+        if (it == m_postings.end()) continue;
+        lists.push_back(&it->second);
+    }
+    cursors.reserve(lists.size());
+    for (const auto* p : lists) cursors.emplace_back(*p);
+    if (cursors.empty()) return {};
+
+    std::vector<size_t> order(cursors.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+
+    VectorUtils::TopK<size_t> best(k);
+    for (;;) {
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cursors[a].doc() < cursors[b].doc(); });
+
+        // Pivot: the first cursor at which the summed score bounds can beat
+        // the current k-th score; no document before its doc id can.
+        const float threshold = best.threshold();
+        float bound = 0.0f;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (cursors[order[i]].doc() == kEnd) break;
+            bound += lists[order[i]]->max_score;
+            if (bound > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) break;
+
+        const uint32_t doc = cursors[order[pivot]].doc();
+        if (cursors[order[0]].doc() == doc) {
+            float score = 0.0f;
+            const bool admitted = !allowed || allowed->contains(doc);
+            for (size_t i = 0; i < order.size() && cursors[order[i]].doc() == doc; ++i) {
+                auto& c = cursors[order[i]];
+                if (admitted) score += TermScore(lists[order[i]]->idf, c.tf(), m_doc_len[doc]);
+                c.Next();
+            }
+            if (admitted && score > threshold) best.push(doc, score);
+        } else {
+            for (size_t i = 0; i < pivot; ++i) cursors[order[i]].Advance(doc);
+        }
+    }
+    return best.sorted();
+}
+
+void Chunk::ChunkBM25::Write(std::ostream& out) const
+{
+    RAGLibrary::WritePod(out, m_k1);
+    RAGLibrary::WritePod(out, m_b);
+    RAGLibrary::WritePod(out, m_avgdl);
+    RAGLibrary::WriteArray(out, m_doc_len);
+    RAGLibrary::WritePod(out, uint64_t(m_postings.size()));
+    for (const auto& [term, p] : m_postings) {
+        RAGLibrary::WriteString(out, term);
+        RAGLibrary::WritePod(out, p.df);
+        RAGLibrary::WritePod(out, p.idf);
+        RAGLibrary::WritePod(out, p.max_score);
+        RAGLibrary::WriteArray(out, p.data);
+        RAGLibrary::WriteArray(out, p.block_last);
+        RAGLibrary::WriteArray(out, p.block_offset);
+    }
+}
+
+void Chunk::ChunkBM25::Read(RAGLibrary::ByteReader& in)
+{
+    clear();
+    m_k1 = in.Read<float>();
+    m_b = in.Read<float>();
+    m_avgdl = in.Read<float>();
+    m_doc_len = in.ReadArray<uint32_t>();
+    const auto terms = in.Read<uint64_t>();
+    m_postings.reserve(terms);
+    for (uint64_t t = 0; t < terms; ++t) {
+        std::string term = in.ReadString();
+        Postings p;
+        p.df = in.Read<uint32_t>();
+        p.idf = in.Read<float>();
+        p.max_score = in.Read<float>();
+        p.data = in.ReadArray<uint8_t>();
+        p.block_last = in.ReadArray<uint32_t>();
+        p.block_offset = in.ReadArray<uint32_t>();
+        const size_t blocks = (size_t(p.df) + kBlock - 1) / kBlock;
+        if (p.df == 0 || p.block_last.size() != blocks || p.block_offset.size() != blocks
+            || !ValidPostings(p, m_doc_len.size())) {
+            throw RAGLibrary::RagException("Corrupt BM25 index (term '" + term + "').");
+        }
+        m_postings.emplace(std::move(term), std::move(p));
+    }
+}
+
+// Decodes every block once so the unchecked Cursor can trust the data:
+// blocks tile `data` exactly, doc ids strictly increase, stay below
+// `n_docs` and end each block at its block_last entry.
+bool Chunk::ChunkBM25::ValidPostings(const Postings& p, size_t n_docs)
+{
+    const size_t blocks = p.block_last.size();
+    const uint8_t* base = p.data.data();
+    uint32_t prev = 0;
+    for (size_t b = 0; b < blocks; ++b) {
+        const size_t begin = p.block_offset[b];
+        const size_t end = b + 1 < blocks ? p.block_offset[b + 1] : p.data.size();
+        if (begin > end || end > p.data.size() || (b == 0 && begin != 0)) return false;
+        const uint8_t* q = base + begin;
+        const size_t count = std::min<size_t>(kBlock, p.df - b * kBlock);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t delta = 0, tf = 0;
+            if (!GetVarintChecked(q, base + end, delta) || !GetVarintChecked(q, base + end, tf)) return false;
+            const bool first = b == 0 && i == 0;
+            if ((!first && delta == 0) || uint64_t(prev) + delta >= n_docs || tf == 0) return false;
+            prev += delta;
+        }
+        if (q != base + end || prev != p.block_last[b]) return false;
+    }
+    return true;
+}
+
+void Chunk::ChunkBM25::clear(void)
+{
+    m_doc_len.clear();
+    m_postings.clear();
+    m_avgdl = 0.0f;
+}
+
+size_t Chunk::ChunkBM25::bytes(void) const
+{
+    size_t total = m_doc_len.size() * sizeof(uint32_t);
+    for (const auto& [term, p] : m_postings) {
+        total += term.size() + sizeof(Postings) + p.data.size()
+               + (p.block_last.size() + p.block_offset.size()) * sizeof(uint32_t);
+    }
+    return total;
+}
@@ -0,0 +1,74 @@
+#ifndef CHUNK_BM25_H
+#define CHUNK_BM25_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "BinaryIO.h"
+#include "CommonStructs.h"
+#include "vectordb/attribute_index.h"
+
+namespace Chunk
+{
+    // Okapi BM25 over the chunk texts, for the exact-term matches (part
+    // numbers, citations, identifiers) that embeddings tend to miss.
+    //
+    // Postings are doc-id deltas and term frequencies in LEB128 varints,
+    // grouped in blocks of 128 whose last doc id allows skipping without
+    // decoding. Queries use WAND: documents that cannot beat the current
+    // k-th score given the per-term score bounds are never scored.
+    class ChunkBM25
+    {
+    public:
+        ChunkBM25(float k1 = 1.2f, float b = 0.75f);
+        ~ChunkBM25() = default;
+
+        void Build(const std::vector<RAGLibrary::Document>& docs, int max_workers = 4);
+        // Top-k (chunk index, BM25 score), restricted to `allowed` when given.
+        std::vector<std::pair<size_t, float>> Search(std::string_view query, size_t k, const vdb::Bitmap* allowed = nullptr) const;
+        void clear(void);
+        // Serialized form, embedded in ChunkDefault chunk stores.
+        void Write(std::ostream& out) const;
+        void Read(RAGLibrary::ByteReader& in);
+
+        // Lowercased ASCII alphanumeric runs (UTF-8 sequences kept as-is).
+        // Runs joined by single '-', '.', '/' or '_' are also emitted whole,
+        // so "AB-12.3" yields "ab", "12", "3" and "ab-12.3".
+        static std::vector<std::string> Tokenize(std::string_view text);
+
+        inline size_t size(void) const { return m_doc_len.size(); }
+        inline size_t terms(void) const { return m_postings.size(); }
+        size_t bytes(void) const;
+
+    private:
+        static constexpr size_t kBlock = 128;
+
+        struct Postings {
+            std::vector<uint8_t> data;          // varint (doc delta, tf) pairs
+            std::vector<uint32_t> block_last;   // last doc id of each block
+            std::vector<uint32_t> block_offset; // byte offset of each block in data
+            uint32_t df = 0;
+            float idf = 0.0f;
+            float max_score = 0.0f;             // upper bound of the term's contribution
+        };
+        class Cursor;
+
+        static bool ValidPostings(const Postings& p, size_t n_docs);
+
+        float m_k1;
+        float m_b;
+        float m_avgdl = 0.0f;
+        std::vector<uint32_t> m_doc_len;
+        std::unordered_map<std::string, Postings> m_postings;
+
+        inline float TermScore(float idf, uint32_t tf, uint32_t dl) const {
+            const float norm = m_k1 * (1.0f - m_b + m_b * float(dl) / m_avgdl);
+            return idf * float(tf) * (m_k1 + 1.0f) / (float(tf) + norm);
+        }
+    };
+}
+#endif
@@ -1,6 +1,7 @@
 #include "ChunkCommons.h"
 #include "RagException.h"
 #include "StringUtils.h"
+#include "Tracing.h"
 
 #include <nlohmann/json.hpp>
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
@@ -20,6 +21,8 @@ using namespace Chunk;
 
 std::vector<RAGLibrary::Document> Chunk::Embeddings(const std::vector<RAGLibrary::Document>& list, std::string model)
 {     
+    Tracing::Span span("chunk::embeddings", "ingest");
+    span.SetItems(int64_t(list.size()));
     std::vector<RAGLibrary::Document> emb;
 
     std::optional<std::string> vendor_opt = Chunk::resolve_vendor_from_model(model);
@@ -46,6 +49,12 @@ std::vector<RAGLibrary::Document> Chunk::Embeddings(const std::vector<RAGLibrary
             throw std::runtime_error("Failed to generate valid embeddings after 3 attempts.");
         }
 
+        if (span.active()) {
+            int64_t bytes = 0;
+            for (const auto& doc : emb)
+                bytes += int64_t(doc.embedding->size() * sizeof(float));
+            span.SetBytes(bytes);
+        }
         return emb;
     }
 
@@ -116,8 +125,15 @@ void Chunk::NormalizeEmbeddings(std::vector<float> &embeddings)
     }
 }
 
-std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size)
+// Runs `model` over `chunks` in batches of `batch_size`. Each batch is padded
+// to its longest encoding; `emit(i, outputs, tokens, width)` then receives the
+// `tokens` x `width` outputs of chunk i without the padding.
+template <typename Emit>
+static void RunEmbeddingModel(const std::vector<std::string> &chunks, const std::string &model, const int batch_size, Emit &&emit)
 {
+    if (batch_size <= 0)
+        throw RAGLibrary::RagException("batch_size must be positive.");
+
     const auto model_c = model.c_str();
     const std::string modelPath = std::format("models/{}/model.onnx", model_c);
     const std::string tokenizerPath = std::format("models/{}/tokenizer.json", model_c);
@@ -132,33 +148,29 @@ std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std
 
     Ort::AllocatorWithDefaultOptions allocator;
 
-    std::vector<std::vector<float>> results;
-    for (int start_idx = 0; start_idx < chunks.size(); start_idx += batch_size)
+    for (size_t start_idx = 0; start_idx < chunks.size(); start_idx += size_t(batch_size))
     {
-        size_t end_idx = std::min<ptrdiff_t>(start_idx + batch_size, chunks.size());
+        size_t end_idx = std::min(start_idx + size_t(batch_size), chunks.size());
         std::vector<std::string> texts(chunks.begin() + start_idx, chunks.begin() + end_idx);
-        auto encode_batch = tokenizer->EncodeBatch(chunks);
+        auto encode_batch = tokenizer->EncodeBatch(texts);
 
-        size_t total_size = std::accumulate(encode_batch.begin(), encode_batch.end(), std::size_t(0),
-                                            [](std::size_t sum, const std::vector<int32_t> &encode)
-                                            {
-                                                return sum + encode.size();
-                                            });
+        size_t max_len = 1;
+        for (const auto &encode : encode_batch)
+            max_len = std::max(max_len, encode.size());
+        const size_t total_size = encode_batch.size() * max_len;
 
         std::vector<int64_t> inputIds(total_size, 0);
         std::vector<int64_t> attentionMask(total_size, 0);
-        size_t ii = 0;
-        for (int i = 0; i < encode_batch.size(); ++i)
+        for (size_t i = 0; i < encode_batch.size(); ++i)
         {
-            for (auto index = 0; index < encode_batch[i].size(); ++index)
+            for (size_t index = 0; index < encode_batch[i].size(); ++index)
             {
-                inputIds[ii + index] = encode_batch[i][index];
-                inputIds[ii + index] > 0 ? attentionMask[ii + index] = 1 : attentionMask[ii + index] = 0;
+                inputIds[i * max_len + index] = encode_batch[i][index];
+                attentionMask[i * max_len + index] = encode_batch[i][index] > 0 ? 1 : 0;
             }
-            ii += encode_batch[i].size();
         }
         std::vector<int64_t> tokenTypeIds(total_size, 0);
-        std::vector<int64_t> inputShape{int64_t(encode_batch.size()), int64_t(encode_batch.front().size())};
+        std::vector<int64_t> inputShape{int64_t(encode_batch.size()), int64_t(max_len)};
 
         auto attentionTensor = CreateTensorOrt<int64_t>(allocator, attentionMask, inputShape);
         auto inputTensor = CreateTensorOrt<int64_t>(allocator, inputIds, inputShape);
@@ -173,39 +185,68 @@ std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std
         const char *outputNames[] = {"logits"};
         std::vector<Ort::Value> outputTensors = session->Run(Ort::RunOptions(nullptr), inputNames, inputTensors.data(), 3, outputNames, 1);
 
-        float *logits = outputTensors.front().GetTensorMutableData<float>();
+        const float *logits = outputTensors.front().GetTensorMutableData<float>();
         size_t outputSize = outputTensors.front().GetTensorTypeAndShapeInfo().GetElementCount();
 
-        results.reserve(results.size() + encode_batch.size());
-        ii = 0;
-        size_t numLabels = outputSize / total_size;
-        for (int i = 0; i < encode_batch.size(); i++)
-        {
-            std::vector<float> tokenLogits(logits + ii * numLabels, logits + (ii + encode_batch[i].size()) * numLabels);
-            results.push_back(std::move(tokenLogits));
-            ii += encode_batch[i].size();
-        }
+        const size_t width = outputSize / total_size;
+        for (size_t i = 0; i < encode_batch.size(); ++i)
+            emit(start_idx + i, logits + i * max_len * width, encode_batch[i].size(), width);
     }
+}
 
+std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size)
+{
+    std::vector<std::vector<float>> results(chunks.size());
+    RunEmbeddingModel(chunks, model, batch_size,
+                      [&](size_t i, const float *outputs, size_t tokens, size_t width)
+                      {
+                          results[i].assign(outputs, outputs + tokens * width);
+                      });
+    return results;
+}
+
+std::vector<std::vector<float>> Chunk::EmbeddingModelPooled(const std::vector<std::string> &chunks, const std::string &model, const int batch_size)
+{
+    std::vector<std::vector<float>> results(chunks.size());
+    RunEmbeddingModel(chunks, model, batch_size,
+                      [&](size_t i, const float *outputs, size_t tokens, size_t width)
+                      {
+                          auto &pooled = results[i];
+                          pooled.assign(width, 0.0f);
+                          for (size_t t = 0; t < tokens; ++t)
+                              for (size_t j = 0; j < width; ++j)
+                                  pooled[j] += outputs[t * width + j];
+                          const float inv = 1.0f / float(std::max<size_t>(tokens, 1));
+                          for (float &value : pooled)
+                              value *= inv;
+                          if (VectorUtils::norm(pooled.data(), width) > 0.0f)
+                              Chunk::NormalizeEmbeddings(pooled);
+                      });
     return results;
 }
 
 std::vector<std::vector<float>> Chunk::EmbeddingOpeanAI(const std::vector<std::string> &chunks, const std::string &openai_api_key)
 {
-    std::vector<std::vector<float>> results;
+    // Inputs per request; the endpoint accepts up to 2048.
+    constexpr size_t kRequestBatch = 256;
+
+    std::vector<std::vector<float>> results(chunks.size());
     openai::start(openai_api_key);
-    results.reserve(chunks.size());
-    for (int i = 0; i < chunks.size(); i++)
+    for (size_t start = 0; start < chunks.size(); start += kRequestBatch)
     {
-        auto &chunk = chunks[i];
-        auto startTime = std::chrono::high_resolution_clock::now();
-        auto values = openai::embedding().create(openai::_detail::Json{
-            {"input", std::vector<std::string>{chunk}},
+        const size_t end = std::min(start + kRequestBatch, chunks.size());
+        auto data = openai::embedding().create(openai::_detail::Json{
+            {"input", std::vector<std::string>(chunks.begin() + start, chunks.begin() + end)},
             {"model", "text-embedding-ada-002"},
-        })["data"][0]["embedding"];
-        if (values.is_array())
+        })["data"];
+        if (!data.is_array() || data.size() != end - start)
+            throw RAGLibrary::RagException("Unexpected embedding response from OpenAI.");
+        for (const auto &item : data)
         {
-            results.push_back(values.get<std::vector<float>>());
+            const size_t index = start + item["index"].get<size_t>();
+            if (index >= end)
+                throw RAGLibrary::RagException("Unexpected embedding response from OpenAI.");
+            results[index] = item["embedding"].get<std::vector<float>>();
         }
     }
     return results;
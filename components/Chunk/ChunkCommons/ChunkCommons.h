@@ -11,25 +11,113 @@
 #include <algorithm>
 #include <string>
 #include <cctype>
+#include <cstdint>
+#include <memory>
 #include "EmbeddingOpenAI.h"
+#include "MappedFile.h"
+#include "Quantize.h"
+#include "VectorUtils.h"
 namespace Chunk
 {
+    // Element type of the stored embeddings. Anything but FP32 keeps a compressed
+    // copy that ChunkQuery scores directly; flatVD is then either released or
+    // kept for re-ranking (see ChunkDefault::Quantize).
+    enum class StorageType { FP32, FP16, BF16, INT8 };
+
     struct vdb_data {
-        std::vector<float> flatVD;
+        // Shared so that NumPy views of the rows outlive Quantize / clear / Load.
+        std::shared_ptr<const std::vector<float>> flatVD;
+        StorageType storage = StorageType::FP32;
+        std::vector<uint16_t> flatVD16; // FP16 / BF16 bit patterns, n x dim
+        std::vector<int8_t> flatVD8;    // INT8 codes, n x dim
+        std::vector<float> scales;      // INT8: row i decodes as flatVD8[i] * scales[i]
+        std::vector<uint64_t> bits;     // sign codes, n x binary_words(dim); see BuildBinaryIndex
+        std::vector<float> bits_center; // mean row the sign codes are taken against
         std::string vendor;
         std::string model;
         size_t dim = 0;
         size_t n = 0;
+        // Elements opened from a chunk store (ChunkDefault::Load) read their
+        // arrays straight from the shared read-only mapping; the vectors above
+        // then stay empty until Quantize / BuildBinaryIndex replace them.
+        struct Mapped {
+            std::shared_ptr<const RAGLibrary::MappedFile> file;
+            const float* f32 = nullptr;
+            const uint16_t* f16 = nullptr;
+            const int8_t* i8 = nullptr;
+            const float* scales = nullptr;
+            const uint64_t* bits = nullptr;
+            const float* bits_center = nullptr;
+            const float* norms = nullptr;   // row norms of the scanned representation
+        } mapped;
         //----------------------------------------------------
+        // Owned array if present, otherwise the mapped one (nullptr if neither).
+        inline const float* f32Data(void) const{ return flatVD && !flatVD->empty() ? flatVD->data() : mapped.f32; };
+        inline const uint16_t* f16Data(void) const{ return flatVD16.empty() ? mapped.f16 : flatVD16.data(); };
+        inline const int8_t* i8Data(void) const{ return flatVD8.empty() ? mapped.i8 : flatVD8.data(); };
+        inline const float* scaleData(void) const{ return scales.empty() ? mapped.scales : scales.data(); };
+        inline const uint64_t* bitsData(void) const{ return bits.empty() ? mapped.bits : bits.data(); };
+        inline const float* centerData(void) const{ return bits_center.empty() ? mapped.bits_center : bits_center.data(); };
+        inline bool isMapped(void) const{ return mapped.file != nullptr; };
+        // Whatever keeps f32Data() alive: the owned rows or the mapping.
+        inline std::shared_ptr<const void> f32Owner(void) const{
+            if (flatVD && !flatVD->empty()) return flatVD;
+            if (mapped.f32) return mapped.file;
+            return nullptr;
+        };
+
         inline const std::tuple<size_t, size_t>  getPar(void) const{return { n, dim };}; 
         inline std::pair<std::string, std::string>getEmbPar(void) const{return { vendor , model };}; 
         inline const float* getVDpointer(void) const{
-            if (flatVD.empty()) {
+            if (f32Data() == nullptr) {
                 std::cout << "[Info] Empty Vector Data Base\n";
                 return {};
             }
-            return flatVD.data();
+            return f32Data();
         }; 
+        inline bool empty(void) const{
+            return n == 0 || (f32Data() == nullptr && f16Data() == nullptr && i8Data() == nullptr);
+        };
+        inline size_t bytes(void) const{
+            const size_t cells = n * dim;
+            return (f32Data() ? cells * sizeof(float) : 0) + (f16Data() ? cells * sizeof(uint16_t) : 0)
+                 + (i8Data() ? cells + n * sizeof(float) : 0)
+                 + (bitsData() ? n * VectorUtils::binary_words(dim) * sizeof(uint64_t) + dim * sizeof(float) : 0);
+        };
+        // Dot product of a float query with row i of the scanned representation.
+        inline float dotRow(const float* q, size_t i) const{
+            switch (storage) {
+                case StorageType::FP16: return VectorUtils::dot_f16(q, f16Data() + i * dim, dim);
+                case StorageType::BF16: return VectorUtils::dot_bf16(q, f16Data() + i * dim, dim);
+                case StorageType::INT8: return scaleData()[i] * VectorUtils::dot_i8(q, i8Data() + i * dim, dim);
+                default: return VectorUtils::dot(q, f32Data() + i * dim, dim);
+            }
+        };
+        // Row i of the scanned representation as floats: a pointer into the
+        // float array for FP32, otherwise decoded into `scratch` (dim floats).
+        inline const float* rowData(size_t i, float* scratch) const{
+            const size_t off = i * dim;
+            switch (storage) {
+                case StorageType::FP16: {
+                    const uint16_t* row = f16Data() + off;
+                    for (size_t t = 0; t < dim; ++t) scratch[t] = VectorUtils::half_to_float(row[t]);
+                    return scratch;
+                }
+                case StorageType::BF16: {
+                    const uint16_t* row = f16Data() + off;
+                    for (size_t t = 0; t < dim; ++t) scratch[t] = VectorUtils::bf16_to_float(row[t]);
+                    return scratch;
+                }
+                case StorageType::INT8: {
+                    const int8_t* row = i8Data() + off;
+                    const float scale = scaleData()[i];
+                    for (size_t t = 0; t < dim; ++t) scratch[t] = scale * float(row[t]);
+                    return scratch;
+                }
+                default:
+                    return f32Data() + off;
+            }
+        };
     };
     
         extern inline const std::unordered_map<std::string, std::vector<std::string>> EmbeddingModel = {
@@ -112,10 +200,13 @@ namespace Chunk
     void NormalizeEmbeddings(std::vector<float> &embeddings);
 
     std::vector<std::vector<float>> EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size = 32);
+    // One mean-pooled, L2-normalized vector per chunk (sentence embeddings).
+    std::vector<std::vector<float>> EmbeddingModelPooled(const std::vector<std::string> &chunks, const std::string &model, const int batch_size = 32);
     inline std::vector<std::vector<float>> EmbeddingHuggingFaceTransformers(const std::vector<std::string> &chunks)
     {
         return EmbeddingModelBatch(chunks, "sentence-transformers/all-MiniLM-L6-v2");
     }
+    // Sends the chunks in batched requests; results keep the input order.
     std::vector<std::vector<float>> EmbeddingOpeanAI(const std::vector<std::string> &chunks, const std::string &openai_api_key);
 
     at::Tensor toTensor(std::vector<std::vector<float>> &vect);
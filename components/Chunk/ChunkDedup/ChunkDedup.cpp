@@ -0,0 +1,221 @@
+#include "ChunkDedup.h"
+#include "ChunkBM25/ChunkBM25.h"
+#include "RagException.h"
+#include "Tracing.h"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+    // Leaders compared per LSH bucket; a member that matches none of them is
+    // left to the other bands instead of making a bucket quadratic.
+    constexpr size_t kMaxLeaders = 32;
+
+    // splitmix64 finalizer.
+    inline uint64_t Mix64(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    inline uint64_t Combine(uint64_t h, uint64_t v) {
+        return Mix64(h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2)));
+    }
+
+    inline uint32_t Root(std::vector<uint32_t>& parent, uint32_t x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+}
+
+Chunk::ChunkDedup::ChunkDedup(float threshold, size_t num_perm, size_t shingle, uint64_t seed)
+    : m_num_perm(num_perm), m_shingle(shingle)
+{
+    if (!(threshold > 0.0f && threshold <= 1.0f))
+        throw RAGLibrary::RagException("The dedup threshold must be in (0, 1].");
+    if (num_perm == 0 || shingle == 0)
+        throw RAGLibrary::RagException("num_perm and shingle must be positive.");
+
+    // Banding with b bands of r rows proposes a pair with probability
+    // 1 - (1 - s^r)^b, whose steepest point is near (1/b)^(1/r). The highest
+    // such point not above the threshold keeps false negatives low; the
+    // candidates are verified against the full signature anyway.
+    m_rows = 1;
+    m_bands = num_perm;
+    double best = 0.0;
+    for (size_t r = 1; r <= num_perm; ++r) {
+        const size_t b = num_perm / r;
+        const double point = std::pow(1.0 / double(b), 1.0 / double(r));
+        if (point <= threshold && point > best) {
+            best = point;
+            m_rows = r;
+            m_bands = b;
+        }
+    }
+    m_min_equal = size_t(std::ceil(double(threshold) * double(num_perm)));
+
+    std::mt19937_64 rng(seed);
+    m_mul.resize(num_perm);
+    m_add.resize(num_perm);
+    for (size_t p = 0; p < num_perm; ++p) {
+        m_mul[p] = rng() | 1;
+        m_add[p] = rng();
+    }
+}
+
+void Chunk::ChunkDedup::Signature(const std::vector<uint64_t>& tokens, uint32_t* out) const
+{
+    std::fill(out, out + m_num_perm, std::numeric_limits<uint32_t>::max());
+    const size_t width = std::min(m_shingle, tokens.size());
+    const size_t count = tokens.empty() ? 0 : tokens.size() - width + 1;
+    const uint64_t* mul = m_mul.data();
+    const uint64_t* add = m_add.data();
+    for (size_t s = 0; s < count; ++s) {
+        uint64_t x = 0;
+        for (size_t j = s; j < s + width; ++j)
+            x = Combine(x, tokens[j]);
+#pragma omp simd
+        for (size_t p = 0; p < m_num_perm; ++p) {
+            const uint32_t v = uint32_t((mul[p] * x + add[p]) >> 32);
+            out[p] = std::min(out[p], v);
+        }
+    }
+}
+
+bool Chunk::ChunkDedup::Similar(const uint32_t* a, const uint32_t* b) const
+{
+    size_t equal = 0;
+#pragma omp simd reduction(+ : equal)
+    for (size_t p = 0; p < m_num_perm; ++p)
+        equal += a[p] == b[p];
+    return equal >= m_min_equal;
+}
+
+std::vector<uint32_t> Chunk::ChunkDedup::Find(const std::vector<RAGLibrary::Document>& docs, int max_workers) const
+{
+    Tracing::Span span("chunk_dedup::find", "ingest");
+    span.SetItems(int64_t(docs.size()));
+    const size_t n = docs.size();
+    if (n > std::numeric_limits<uint32_t>::max())
+        throw RAGLibrary::RagException("Too many chunks to deduplicate.");
+
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+    {
+        max_threads = max_workers;
+    }
+    omp_set_num_threads(max_threads);
+
+    // Token hashes and a hash of the whole token stream per text.
+    std::vector<std::vector<uint64_t>> tokens(n);
+    std::vector<uint64_t> exact(n);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < n; ++i) {
+        const auto words = Chunk::ChunkBM25::Tokenize(docs[i].page_content);
+        auto& hashes = tokens[i];
+        hashes.reserve(words.size());
+        uint64_t h = words.size();
+        for (const auto& word : words) {
+            hashes.push_back(Mix64(std::hash<std::string_view>{}(word)));
+            h = Combine(h, hashes.back());
+        }
+        exact[i] = h;
+    }
+
+    // Exact duplicates point at the first occurrence; only the first
+    // occurrences get a signature.
+    std::vector<uint32_t> canonical(n);
+    std::vector<uint32_t> reps;
+    {
+        std::unordered_map<uint64_t, uint32_t> first;
+        first.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            const auto [it, inserted] = first.try_emplace(exact[i], uint32_t(i));
+            canonical[i] = it->second;
+            if (inserted)
+                reps.push_back(uint32_t(i));
+        }
+    }
+
+    const size_t m = reps.size();
+    std::vector<uint32_t> signatures(m * m_num_perm);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t r = 0; r < m; ++r) {
+        Signature(tokens[reps[r]], signatures.data() + r * m_num_perm);
+        std::vector<uint64_t>().swap(tokens[reps[r]]);
+    }
+
+    // LSH: within each band, signatures whose rows hash alike are candidate
+    // pairs. Each bucket is scanned in index order and every member is
+    // compared with the bucket's leaders so far.
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> edges(m_bands);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t band = 0; band < m_bands; ++band) {
+        std::vector<std::pair<uint64_t, uint32_t>> keys(m);
+        for (size_t r = 0; r < m; ++r) {
+            const uint32_t* row = signatures.data() + r * m_num_perm + band * m_rows;
+            uint64_t h = band;
+            for (size_t j = 0; j < m_rows; ++j)
+                h = Combine(h, row[j]);
+            keys[r] = {h, uint32_t(r)};
+        }
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<uint32_t> leaders;
+        for (size_t s = 0; s < m;) {
+            size_t e = s + 1;
+            while (e < m && keys[e].first == keys[s].first)
+                ++e;
+            if (e - s > 1) {
+                leaders.assign(1, keys[s].second);
+                for (size_t j = s + 1; j < e; ++j) {
+                    const uint32_t r = keys[j].second;
+                    const uint32_t* sig = signatures.data() + size_t(r) * m_num_perm;
+                    bool matched = false;
+                    for (const uint32_t leader : leaders) {
+                        if (Similar(signatures.data() + size_t(leader) * m_num_perm, sig)) {
+                            edges[band].emplace_back(leader, r);
+                            matched = true;
+                            break;
+                        }
+                    }
+                    if (!matched && leaders.size() < kMaxLeaders)
+                        leaders.push_back(r);
+                }
+            }
+            s = e;
+        }
+    }
+
+    // Union by lower index: reps are in document order, so each group ends
+    // up rooted at its first document.
+    std::vector<uint32_t> parent(m);
+    std::iota(parent.begin(), parent.end(), 0u);
+    for (const auto& band_edges : edges) {
+        for (const auto& [a, b] : band_edges) {
+            const uint32_t ra = Root(parent, a);
+            const uint32_t rb = Root(parent, b);
+            if (ra != rb)
+                parent[std::max(ra, rb)] = std::min(ra, rb);
+        }
+    }
+    for (size_t r = 0; r < m; ++r)
+        canonical[reps[r]] = reps[Root(parent, uint32_t(r))];
+    for (size_t i = 0; i < n; ++i)
+        canonical[i] = canonical[canonical[i]];
+
+    return canonical;
+}
@@ -0,0 +1,52 @@
+#ifndef CHUNK_DEDUP_H
+#define CHUNK_DEDUP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CommonStructs.h"
+
+namespace Chunk
+{
+    // Duplicate and near-duplicate detection over chunk texts, run before
+    // embedding so repeated boilerplate (headers, disclaimers, quoted
+    // e-mails) is embedded and stored once.
+    //
+    // Texts are compared as sets of word shingles built from
+    // ChunkBM25::Tokenize, so case, spacing and punctuation do not matter.
+    // Identical token streams are grouped by hash first. The remaining texts
+    // get a MinHash signature, LSH banding proposes candidate pairs, and a
+    // pair is kept when the estimated Jaccard similarity reaches the
+    // threshold. Groups are closed transitively and represented by their
+    // lowest index, so the result does not depend on the thread count.
+    class ChunkDedup
+    {
+    public:
+        // Metadata key ChunkDefault::Deduplicate uses to link a duplicate to
+        // the chunk it repeats.
+        static constexpr const char* kLinkKey = "duplicate_of";
+
+        ChunkDedup(float threshold = 0.8f, size_t num_perm = 128, size_t shingle = 5, uint64_t seed = 1);
+        ~ChunkDedup() = default;
+
+        // canonical[i] == i for representatives, otherwise the index (< i) of
+        // the representative of i's group.
+        std::vector<uint32_t> Find(const std::vector<RAGLibrary::Document>& docs, int max_workers = 4) const;
+
+        inline size_t bands(void) const { return m_bands; }
+        inline size_t rows(void) const { return m_rows; }
+
+    private:
+        size_t m_num_perm;
+        size_t m_shingle;
+        size_t m_bands;
+        size_t m_rows;
+        size_t m_min_equal;             // signature slots that must agree
+        std::vector<uint64_t> m_mul;    // one multiply-shift hash per permutation
+        std::vector<uint64_t> m_add;
+
+        void Signature(const std::vector<uint64_t>& tokens, uint32_t* out) const;
+        bool Similar(const uint32_t* a, const uint32_t* b) const;
+    };
+}
+#endif
@@ -2,6 +2,7 @@
 #include "ChunkDefault.h"
 #include "RagException.h"
 #include "StringUtils.h"
+#include "Tracing.h"
 #include <cmath>
 #include <omp.h>
 #include <syncstream>
@@ -10,13 +11,37 @@
 #include <cmath>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
+#include <array>
 #include <memory>     
 #include <sstream>     
 #include <torch/torch.h>
 #include <iomanip>    
 #include <stdexcept>
+#include <filesystem>
+#include "BinaryIO.h"
 // using namespace Chunk;
 
+// Chunk store layout (native little-endian). Array sections start on
+// 64-byte boundaries so mapped rows are aligned for the SIMD kernels.
+//
+//   header    magic "PCCHUNK\0", u32 version, u32 element count,
+//             u64 chunk count, i32 chunk_size, i32 overlap,
+//             u64 offsets of the text, metadata, lexical and element sections
+//   text      u64 offsets[count + 1] into the concatenated chunk texts
+//   metadata  per chunk: u32 pair count, then key / value strings
+//   lexical   ChunkBM25::Write
+//   arrays    raw element arrays
+//   elements  per element: vendor, model, u64 dim, u64 n, u8 storage, then
+//             u64 offsets (0 = absent) of the float rows, 16-bit rows,
+//             int8 rows, int8 scales, sign codes, sign center and row norms
+namespace {
+    constexpr char kStoreMagic[8] = {'P', 'C', 'C', 'H', 'U', 'N', 'K', '\0'};
+    constexpr uint32_t kStoreVersion = 1;
+    constexpr size_t kStoreAlign = 64;
+    constexpr size_t kStoreArrays = 7;
+}
+
 Chunk::ChunkDefault::ChunkDefault(
     const int chunk_size, 
     const int overlap, 
@@ -31,7 +56,73 @@ Chunk::ChunkDefault::ChunkDefault(
     ProcessDocuments(*items_opt, max_workers);
 }  
 
+size_t Chunk::ChunkDefault::Deduplicate(float threshold, bool link, int max_workers){
+    Tracing::Span span("chunk_default::deduplicate", "ingest");
+    if (this->chunks.empty())
+        throw std::invalid_argument("Empty chunks list.");
+    if (!this->elements.empty())
+        throw std::invalid_argument("Deduplicate must run before embeddings are added.");
+
+    const auto canonical = Chunk::ChunkDedup(threshold).Find(this->chunks, max_workers);
+    size_t duplicates = 0;
+    if (link) {
+        for (size_t i = 0; i < this->chunks.size(); ++i) {
+            if (canonical[i] == i || this->chunks[i].metadata.contains(Chunk::ChunkDedup::kLinkKey))
+                continue;
+            // Links always point at an unlinked chunk, also across calls.
+            size_t target = canonical[i];
+            const auto it = this->chunks[target].metadata.find(Chunk::ChunkDedup::kLinkKey);
+            if (it != this->chunks[target].metadata.end())
+                target = std::stoull(it->second);
+            const RAGLibrary::Metadata tag{{Chunk::ChunkDedup::kLinkKey, std::to_string(target)}};
+            this->chunks[i].metadata.insert(tag.begin(), tag.end());
+            this->attributes.add(static_cast<uint32_t>(i), tag);
+            ++duplicates;
+        }
+        span.SetItems(int64_t(duplicates));
+        return duplicates;
+    }
+
+    for (size_t i = 0; i < this->chunks.size(); ++i)
+        duplicates += canonical[i] != i;
+    span.SetItems(int64_t(duplicates));
+    if (duplicates == 0)
+        return 0;
+
+    std::vector<size_t> new_index(this->chunks.size());
+    std::vector<RAGLibrary::Document> kept;
+    kept.reserve(this->chunks.size() - duplicates);
+    for (size_t i = 0; i < this->chunks.size(); ++i) {
+        if (canonical[i] == i) {
+            new_index[i] = kept.size();
+            kept.push_back(std::move(this->chunks[i]));
+        }
+    }
+    // Links from an earlier link-mode call must follow the compaction; a
+    // link to a dropped chunk moves to the representative that replaced it.
+    for (auto &chunk : kept) {
+        const auto it = chunk.metadata.find(Chunk::ChunkDedup::kLinkKey);
+        if (it == chunk.metadata.end())
+            continue;
+        const size_t target = new_index[canonical[std::stoull(it->second)]];
+        if (target == static_cast<size_t>(&chunk - kept.data()))
+            chunk.metadata.erase(it);
+        else
+            it->second = std::to_string(target);
+    }
+    this->chunks = std::move(kept);
+    this->attributes.clear();
+    for (size_t i = 0; i < this->chunks.size(); ++i)
+    {
+        this->attributes.add(static_cast<uint32_t>(i), this->chunks[i].metadata);
+    }
+    this->lexical.Build(this->chunks, max_workers);
+    return duplicates;
+}
+
 const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
+    Tracing::Span span("chunk_default::create_emb", "ingest");
+    span.SetItems(int64_t(this->chunks.size()));
     // Validation of input parameters ------------------------- 
     Chunk::to_lowercase(model);
 
@@ -47,8 +138,33 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
         throw std::invalid_argument("There is already an element of this chunk like this.");
     std::vector<RAGLibrary::Document> docs;
 
+    // Chunks linked by Deduplicate take the row of the chunk they repeat,
+    // so only the others are sent to the model.
+    std::vector<size_t> rows(this->chunks.size());
+    std::vector<RAGLibrary::Document> unique;
+    size_t next_row = 0;
+    for (size_t i = 0; i < this->chunks.size(); ++i) {
+        const auto it = this->chunks[i].metadata.find(Chunk::ChunkDedup::kLinkKey);
+        if (it == this->chunks[i].metadata.end()) {
+            rows[i] = next_row++;
+            continue;
+        }
+        const size_t target = std::stoull(it->second);
+        if (target >= i || this->chunks[target].metadata.contains(Chunk::ChunkDedup::kLinkKey))
+            throw std::runtime_error("Invalid duplicate link on chunk " + std::to_string(i) + ".");
+        rows[i] = rows[target];
+    }
+    const bool linked = next_row < this->chunks.size();
+    if (linked) {
+        unique.reserve(next_row);
+        for (const auto& chunk : this->chunks) {
+            if (!chunk.metadata.contains(Chunk::ChunkDedup::kLinkKey))
+                unique.push_back(chunk);
+        }
+    }
+
     try{
-        docs = Embeddings(this->chunks, model);
+        docs = Embeddings(linked ? unique : this->chunks, model);
     }
     catch (const std::exception& e) {
         std::cerr << "[Exception] " << e.what() << "\n";
@@ -59,12 +175,17 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
     vdb_element.dim = docs[0].embedding->size();
     vdb_element.n = this->chunks.size();
 
-    vdb_element.flatVD.clear();
-    vdb_element.flatVD.reserve(vdb_element.n * vdb_element.dim);
+    if (docs.size() != next_row)
+        throw std::runtime_error("Expected " + std::to_string(next_row) + " embeddings, got " + std::to_string(docs.size()) + ".");
     for (const auto& doc : docs) {
         if (!doc.embedding.has_value() || doc.embedding->size() != vdb_element.dim)
             throw std::runtime_error("Missing or inconsistent embedding.");
-        vdb_element.flatVD.insert(vdb_element.flatVD.end(), doc.embedding->begin(), doc.embedding->end());
+    }
+    std::vector<float> flat;
+    flat.reserve(vdb_element.n * vdb_element.dim);
+    for (const size_t row : rows) {
+        const auto& embedding = *docs[row].embedding;
+        flat.insert(flat.end(), embedding.begin(), embedding.end());
     }
 
     vdb_element.model = model;
@@ -73,13 +194,14 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
     const size_t expected_size = vdb_element.n * vdb_element.dim;
 
     
-    std::cout << "Flatten vector dimensions: <" << vdb_element.flatVD.size() << ">\n";
+    std::cout << "Flatten vector dimensions: <" << flat.size() << ">\n";
     std::cout << "dim: " << vdb_element.dim << " n: " << vdb_element.n << " → expected size: " << expected_size << "\n";
     std::cout << "Model " << vdb_element.model << ", " << vdb_element.vendor << "\n";
 
-    if (vdb_element.flatVD.size() != expected_size) {
+    if (flat.size() != expected_size) {
         throw std::runtime_error("Flattened vector has unexpected size.");
     }
+    vdb_element.flatVD = std::make_shared<const std::vector<float>>(std::move(flat));
 
     this->elements.push_back(vdb_element);
     const auto& last = this->elements.back();
@@ -87,11 +209,156 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
     std::cout << "║ ➤ Model: " << last.model << " was added to chunks                      \n";
     std::cout << "╚═════════════════════════════════════════════════════════════════════════════════════╝\n";
     
-    LogEmbeddingStats(last.model, last.vendor, last.dim, last.n, last.flatVD.size());
+    LogEmbeddingStats(last.model, last.vendor, last.dim, last.n, last.flatVD->size());
+    span.SetBytes(int64_t(last.n * last.dim * sizeof(float)));
 
     return last;
 }
 
+const Chunk::vdb_data& Chunk::ChunkDefault::AddEmb(std::string model, std::vector<float> flat, size_t dim){
+    Chunk::to_lowercase(model);
+
+    if (this->chunks.empty())
+        throw std::invalid_argument("Empty chunks list.");
+    if (dim == 0 || flat.size() != this->chunks.size() * dim)
+        throw std::invalid_argument("Expected " + std::to_string(this->chunks.size()) + " rows of " + std::to_string(dim) + " floats.");
+    if(is_this_model_used_yet(model))
+        throw std::invalid_argument("There is already an element of this chunk like this.");
+
+    Chunk::vdb_data vdb_element;
+    vdb_element.dim = dim;
+    vdb_element.n = this->chunks.size();
+    vdb_element.flatVD = std::make_shared<const std::vector<float>>(std::move(flat));
+    vdb_element.vendor = resolve_vendor_from_model(model).value_or("external");
+    vdb_element.model = std::move(model);
+
+    this->elements.push_back(std::move(vdb_element));
+    return this->elements.back();
+}
+
+const Chunk::vdb_data& Chunk::ChunkDefault::Quantize(size_t pos, Chunk::StorageType type, bool keep_float, int max_workers){
+    if (pos >= this->elements.size())
+        throw std::out_of_range("Invalid index.");
+    auto& vdb = this->elements[pos];
+    if (vdb.empty())
+        throw std::runtime_error("Element has no embeddings to quantize.");
+
+    const size_t n = vdb.n;
+    const size_t dim = vdb.dim;
+
+    // Source rows: the float copy if it is still around, otherwise the
+    // current quantized copy decoded back (lossy, but allows re-encoding).
+    std::vector<float> decoded;
+    if (vdb.f32Data() == nullptr) {
+        if (type == Chunk::StorageType::FP32 || keep_float)
+            throw std::invalid_argument("The float copy of this element was released and cannot be restored.");
+        decoded.resize(n * dim);
+        for (size_t i = 0; i < n; ++i) {
+            const float* row = vdb.rowData(i, decoded.data() + i * dim);
+            if (row != decoded.data() + i * dim)
+                std::copy(row, row + dim, decoded.begin() + i * dim);
+        }
+    }
+    const float* src = vdb.f32Data() == nullptr ? decoded.data() : vdb.f32Data();
+
+    std::vector<uint16_t> flat16;
+    std::vector<int8_t> flat8;
+    std::vector<float> scales;
+    if (type == Chunk::StorageType::FP16 || type == Chunk::StorageType::BF16)
+        flat16.resize(n * dim);
+    if (type == Chunk::StorageType::INT8) {
+        flat8.resize(n * dim);
+        scales.resize(n);
+    }
+
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+        max_threads = max_workers;
+
+#pragma omp parallel for num_threads(max_threads) schedule(static)
+    for (int i = 0; i < int(n); ++i) {
+        const float* row = src + size_t(i) * dim;
+        const size_t off = size_t(i) * dim;
+        switch (type) {
+            case Chunk::StorageType::FP16:
+                for (size_t t = 0; t < dim; ++t) flat16[off + t] = VectorUtils::float_to_half(row[t]);
+                break;
+            case Chunk::StorageType::BF16:
+                for (size_t t = 0; t < dim; ++t) flat16[off + t] = VectorUtils::float_to_bf16(row[t]);
+                break;
+            case Chunk::StorageType::INT8:
+                scales[i] = VectorUtils::quantize_i8(row, dim, flat8.data() + off);
+                break;
+            default:
+                break;
+        }
+    }
+
+    vdb.storage = type;
+    vdb.flatVD16 = std::move(flat16);
+    vdb.flatVD8 = std::move(flat8);
+    vdb.scales = std::move(scales);
+    // Mapped arrays of a loaded store are superseded by the new encoding.
+    vdb.mapped.f16 = nullptr;
+    vdb.mapped.i8 = nullptr;
+    vdb.mapped.scales = nullptr;
+    vdb.mapped.norms = nullptr;
+    if (!keep_float && type != Chunk::StorageType::FP32) {
+        vdb.flatVD.reset();
+        vdb.mapped.f32 = nullptr;
+    }
+
+    LogEmbeddingStats(vdb.model, vdb.vendor, vdb.dim, vdb.n, vdb.f32Data() ? vdb.n * vdb.dim : 0);
+    return vdb;
+}
+
+const Chunk::vdb_data& Chunk::ChunkDefault::BuildBinaryIndex(size_t pos, int max_workers){
+    if (pos >= this->elements.size())
+        throw std::out_of_range("Invalid index.");
+    auto& vdb = this->elements[pos];
+    if (vdb.empty())
+        throw std::runtime_error("Element has no embeddings to binarize.");
+
+    const size_t words = VectorUtils::binary_words(vdb.dim);
+    std::vector<uint64_t> bits(vdb.n * words);
+
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+        max_threads = max_workers;
+
+    auto row_of = [&vdb](size_t i, float* scratch) {
+        const float* flat = vdb.f32Data();
+        return flat == nullptr ? vdb.rowData(i, scratch) : flat + i * vdb.dim;
+    };
+
+    // Signs are taken against the mean row: embeddings are far from zero-mean
+    // and raw signs would be nearly identical across the store.
+    std::vector<double> sum(vdb.dim, 0.0);
+    {
+        std::vector<float> scratch(vdb.dim);
+        for (size_t i = 0; i < vdb.n; ++i) {
+            const float* row = row_of(i, scratch.data());
+            for (size_t t = 0; t < vdb.dim; ++t) sum[t] += row[t];
+        }
+    }
+    std::vector<float> center(vdb.dim);
+    for (size_t t = 0; t < vdb.dim; ++t) center[t] = float(sum[t] / double(vdb.n));
+
+#pragma omp parallel num_threads(max_threads)
+    {
+        std::vector<float> scratch(vdb.dim);
+#pragma omp for schedule(static)
+        for (int i = 0; i < int(vdb.n); ++i) {
+            VectorUtils::binarize(row_of(size_t(i), scratch.data()), vdb.dim, bits.data() + size_t(i) * words, center.data());
+        }
+    }
+    vdb.bits = std::move(bits);
+    vdb.bits_center = std::move(center);
+    vdb.mapped.bits = nullptr;
+    vdb.mapped.bits_center = nullptr;
+    return vdb;
+}
+
 std::vector<RAGLibrary::Document> Chunk::ChunkDefault::ProcessSingleDocument(RAGLibrary::Document &item)
 {
     std::vector<RAGLibrary::Document> documents;
@@ -115,6 +382,7 @@ std::vector<RAGLibrary::Document> Chunk::ChunkDefault::ProcessSingleDocument(RAG
 
 const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt, int max_workers)
 {   
+    Tracing::Span span("chunk_default::process_documents", "ingest");
     if (this->initialized_)
         throw std::invalid_argument("Chunks list already initialized.");
 
@@ -127,6 +395,9 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(s
     this->metadata = items[0].metadata;
 
     std::vector<RAGLibrary::Document> documents;
+    // One slot per input document so chunks keep input order and the
+    // metadata of the document they came from (filters match on it).
+    std::vector<std::vector<RAGLibrary::Document>> per_item(items.size());
     
     try
     {
@@ -143,13 +414,10 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(s
             auto &item = items[i];
             auto chunks = Chunk::SplitText(item.page_content, m_overlap, m_chunk_size);
 
-#pragma omp critical
+            per_item[i].reserve(chunks.size());
+            for (auto &chunk : chunks)
             {
-                documents.reserve(documents.size() + chunks.size());
-                for (auto &chunk : chunks)
-                {
-                    documents.push_back(RAGLibrary::Document({}, chunk));
-                }
+                per_item[i].push_back(RAGLibrary::Document(item.metadata, chunk));
             }
         }
     }
@@ -159,9 +427,23 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(s
         throw;
     }
 
+    for (auto &part : per_item)
+    {
+        std::move(part.begin(), part.end(), std::back_inserter(documents));
+    }
+
     this->initialized_ = true;
-    this->chunks = documents;
+    this->chunks = std::move(documents);
+    this->attributes.clear();
+    for (size_t i = 0; i < this->chunks.size(); ++i)
+    {
+        this->attributes.add(static_cast<uint32_t>(i), this->chunks[i].metadata);
+    }
+    this->lexical.Build(this->chunks, max_workers);
 
+    span.SetItems(int64_t(this->chunks.size()));
+    if (span.active())
+        span.SetBytes(Tracing::ContentBytes(items));
     return this->chunks;
 }
 void Chunk::ChunkDefault::LogEmbeddingStats(std::string model, std::string vendor , size_t dim, size_t n, size_t flatVD_size) const{
@@ -187,7 +469,8 @@ void Chunk::ChunkDefault::printVD(void) {
         << " and  overlap of: " << m_overlap 
         << " | Quantity of different embeddings: " << total_embeddings  << "\n";
         for (size_t i = 0; i < total_embeddings; ++i) {
-            LogEmbeddingStats(this->elements[i].model, this->elements[i].vendor, this->elements[i].dim, this->elements[i].n, this->elements[i].flatVD.size());
+            LogEmbeddingStats(this->elements[i].model, this->elements[i].vendor, this->elements[i].dim, this->elements[i].n,
+                              this->elements[i].f32Data() ? this->elements[i].n * this->elements[i].dim : 0);
         }
         return;
     }
@@ -213,5 +496,207 @@ size_t Chunk::ChunkDefault::quant_of_elements(void) const {
 void Chunk::ChunkDefault::clear(void) {
     chunks.clear();
     this->elements.clear();
+    this->attributes.clear();
+    this->lexical.clear();
     initialized_ = false;
 }
+
+void Chunk::ChunkDefault::Save(const std::string& path) const {
+    if (!this->initialized_)
+        throw std::runtime_error("Chunks list not initialized; nothing to save.");
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw RAGLibrary::RagException("Cannot open '" + tmp + "' for writing.");
+
+        auto write_header = [&](uint64_t text, uint64_t meta, uint64_t lex, uint64_t elems) {
+            out.write(kStoreMagic, sizeof(kStoreMagic));
+            RAGLibrary::WritePod(out, kStoreVersion);
+            RAGLibrary::WritePod(out, uint32_t(this->elements.size()));
+            RAGLibrary::WritePod(out, uint64_t(this->chunks.size()));
+            RAGLibrary::WritePod(out, int32_t(m_chunk_size));
+            RAGLibrary::WritePod(out, int32_t(m_overlap));
+            for (uint64_t off : {text, meta, lex, elems})
+                RAGLibrary::WritePod(out, off);
+        };
+        write_header(0, 0, 0, 0);
+
+        const uint64_t text_off = uint64_t(out.tellp());
+        uint64_t offset = 0;
+        RAGLibrary::WritePod(out, offset);
+        for (const auto& chunk : this->chunks) {
+            offset += chunk.page_content.size();
+            RAGLibrary::WritePod(out, offset);
+        }
+        for (const auto& chunk : this->chunks)
+            out.write(chunk.page_content.data(), std::streamsize(chunk.page_content.size()));
+
+        const uint64_t meta_off = uint64_t(out.tellp());
+        for (const auto& chunk : this->chunks) {
+            RAGLibrary::WritePod(out, uint32_t(chunk.metadata.size()));
+            for (const auto& [key, value] : chunk.metadata) {
+                RAGLibrary::WriteString(out, key);
+                RAGLibrary::WriteString(out, value);
+            }
+        }
+
+        const uint64_t lex_off = uint64_t(out.tellp());
+        this->lexical.Write(out);
+
+        auto write_array = [&](const void* data, size_t bytes) -> uint64_t {
+            if (data == nullptr) return 0;
+            RAGLibrary::WritePadding(out, kStoreAlign);
+            const uint64_t off = uint64_t(out.tellp());
+            out.write(static_cast<const char*>(data), std::streamsize(bytes));
+            return off;
+        };
+        std::vector<std::array<uint64_t, kStoreArrays>> array_offs;
+        for (const auto& vdb : this->elements) {
+            const size_t cells = vdb.n * vdb.dim;
+            // Norms of the scanned rows, so ChunkQuery need not read them all on open.
+            std::vector<float> norms(vdb.n);
+#pragma omp parallel
+            {
+                std::vector<float> scratch(vdb.dim);
+#pragma omp for schedule(static)
+                for (int i = 0; i < int(vdb.n); ++i)
+                    norms[i] = VectorUtils::norm(vdb.rowData(size_t(i), scratch.data()), vdb.dim);
+            }
+            array_offs.push_back({
+                write_array(vdb.f32Data(), cells * sizeof(float)),
+                write_array(vdb.f16Data(), cells * sizeof(uint16_t)),
+                write_array(vdb.i8Data(), cells),
+                write_array(vdb.scaleData(), vdb.n * sizeof(float)),
+                write_array(vdb.bitsData(), vdb.n * VectorUtils::binary_words(vdb.dim) * sizeof(uint64_t)),
+                write_array(vdb.centerData(), vdb.dim * sizeof(float)),
+                write_array(vdb.empty() ? nullptr : norms.data(), vdb.n * sizeof(float)),
+            });
+        }
+
+        const uint64_t elems_off = uint64_t(out.tellp());
+        for (size_t e = 0; e < this->elements.size(); ++e) {
+            const auto& vdb = this->elements[e];
+            RAGLibrary::WriteString(out, vdb.vendor);
+            RAGLibrary::WriteString(out, vdb.model);
+            RAGLibrary::WritePod(out, uint64_t(vdb.dim));
+            RAGLibrary::WritePod(out, uint64_t(vdb.n));
+            RAGLibrary::WritePod(out, uint8_t(vdb.storage));
+            for (uint64_t off : array_offs[e])
+                RAGLibrary::WritePod(out, off);
+        }
+
+        out.seekp(0);
+        write_header(text_off, meta_off, lex_off, elems_off);
+        if (!out)
+            throw RAGLibrary::RagException("Write to '" + tmp + "' failed.");
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+void Chunk::ChunkDefault::Load(const std::string& path) {
+    if (this->initialized_)
+        throw std::invalid_argument("Chunks list already initialized.");
+
+    auto file = std::make_shared<RAGLibrary::MappedFile>(path);
+    RAGLibrary::ByteReader in(file->Data(), file->Size());
+
+    if (std::memcmp(in.Take(sizeof(kStoreMagic)), kStoreMagic, sizeof(kStoreMagic)) != 0)
+        throw RAGLibrary::RagException("'" + path + "' is not a chunk store.");
+    const auto version = in.Read<uint32_t>();
+    if (version != kStoreVersion)
+        throw RAGLibrary::RagException("'" + path + "' has unsupported chunk store version " + std::to_string(version) + ".");
+    const auto n_elements = in.Read<uint32_t>();
+    const auto n_chunks = in.Read<uint64_t>();
+    const auto chunk_size = in.Read<int32_t>();
+    const auto overlap = in.Read<int32_t>();
+    const auto text_off = in.Read<uint64_t>();
+    const auto meta_off = in.Read<uint64_t>();
+    const auto lex_off = in.Read<uint64_t>();
+    const auto elems_off = in.Read<uint64_t>();
+
+    in.Seek(text_off);
+    if (n_chunks >= file->Size() / sizeof(uint64_t))
+        throw RAGLibrary::RagException("'" + path + "' is truncated or corrupt.");
+    const char* offsets = in.Take((n_chunks + 1) * sizeof(uint64_t));
+    uint64_t text_bytes = 0;
+    std::memcpy(&text_bytes, offsets + n_chunks * sizeof(uint64_t), sizeof(uint64_t));
+    const char* text = in.Take(text_bytes);
+
+    std::vector<RAGLibrary::Document> docs(n_chunks);
+    for (size_t i = 0; i < n_chunks; ++i) {
+        uint64_t begin = 0, end = 0;
+        std::memcpy(&begin, offsets + i * sizeof(uint64_t), sizeof(uint64_t));
+        std::memcpy(&end, offsets + (i + 1) * sizeof(uint64_t), sizeof(uint64_t));
+        if (begin > end || end > text_bytes)
+            throw RAGLibrary::RagException("'" + path + "' is truncated or corrupt.");
+        docs[i].page_content.assign(text + begin, end - begin);
+    }
+
+    in.Seek(meta_off);
+    for (auto& doc : docs) {
+        const auto pairs = in.Read<uint32_t>();
+        for (uint32_t p = 0; p < pairs; ++p) {
+            std::string key = in.ReadString();
+            doc.metadata[std::move(key)] = in.ReadString();
+        }
+    }
+
+    Chunk::ChunkBM25 lex;
+    in.Seek(lex_off);
+    lex.Read(in);
+
+    in.Seek(elems_off);
+    std::vector<Chunk::vdb_data> elems(n_elements);
+    for (auto& vdb : elems) {
+        vdb.vendor = in.ReadString();
+        vdb.model = in.ReadString();
+        vdb.dim = size_t(in.Read<uint64_t>());
+        vdb.n = size_t(in.Read<uint64_t>());
+        const auto storage = in.Read<uint8_t>();
+        if (storage > uint8_t(Chunk::StorageType::INT8) || vdb.n != n_chunks || vdb.dim == 0
+            || vdb.dim > file->Size() / std::max<size_t>(vdb.n, 1))
+            throw RAGLibrary::RagException("'" + path + "' is truncated or corrupt.");
+        vdb.storage = Chunk::StorageType(storage);
+
+        const size_t cells = vdb.n * vdb.dim;
+        const size_t sizes[kStoreArrays] = {
+            cells * sizeof(float), cells * sizeof(uint16_t), cells, vdb.n * sizeof(float),
+            vdb.n * VectorUtils::binary_words(vdb.dim) * sizeof(uint64_t), vdb.dim * sizeof(float), vdb.n * sizeof(float)};
+        const char* arrays[kStoreArrays] = {};
+        for (size_t a = 0; a < kStoreArrays; ++a) {
+            const auto off = in.Read<uint64_t>();
+            if (off != 0) arrays[a] = in.At(off, sizes[a]);
+        }
+        vdb.mapped.file = file;
+        vdb.mapped.f32 = reinterpret_cast<const float*>(arrays[0]);
+        vdb.mapped.f16 = reinterpret_cast<const uint16_t*>(arrays[1]);
+        vdb.mapped.i8 = reinterpret_cast<const int8_t*>(arrays[2]);
+        vdb.mapped.scales = reinterpret_cast<const float*>(arrays[3]);
+        vdb.mapped.bits = reinterpret_cast<const uint64_t*>(arrays[4]);
+        vdb.mapped.bits_center = reinterpret_cast<const float*>(arrays[5]);
+        vdb.mapped.norms = reinterpret_cast<const float*>(arrays[6]);
+
+        const bool scanned = vdb.storage == Chunk::StorageType::FP32 ? vdb.mapped.f32 != nullptr
+                           : vdb.storage == Chunk::StorageType::INT8 ? vdb.mapped.i8 && vdb.mapped.scales
+                           : vdb.mapped.f16 != nullptr;
+        if (!scanned || (vdb.mapped.bits == nullptr) != (vdb.mapped.bits_center == nullptr))
+            throw RAGLibrary::RagException("'" + path + "' is truncated or corrupt.");
+    }
+    if (lex.size() != n_chunks)
+        throw RAGLibrary::RagException("'" + path + "' is truncated or corrupt.");
+
+    m_chunk_size = chunk_size;
+    m_overlap = overlap;
+    this->chunks = std::move(docs);
+    this->elements = std::move(elems);
+    this->lexical = std::move(lex);
+    this->metadata = this->chunks.empty() ? std::map<std::string, std::string>{} : this->chunks.front().metadata;
+    this->attributes.clear();
+    for (size_t i = 0; i < this->chunks.size(); ++i)
+    {
+        this->attributes.add(static_cast<uint32_t>(i), this->chunks[i].metadata);
+    }
+    this->initialized_ = true;
+}
@@ -2,10 +2,15 @@
 #define CHUNK_DEFAULT_H
 
 #include <regex>
+#include <span>
+#include <string>
 #include <vector>
 #include <re2/re2.h>
 #include "ChunkCommons/ChunkCommons.h"
+#include "ChunkBM25/ChunkBM25.h"
+#include "ChunkDedup/ChunkDedup.h"
 #include "CommonStructs.h"
+#include "vectordb/attribute_index.h"
 
 namespace Chunk
 {
@@ -16,21 +21,51 @@ namespace Chunk
         ChunkDefault(const int chunk_size = 100, const int overlap = 20, std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4);
         ~ChunkDefault() = default;
         const std::vector<RAGLibrary::Document>& ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4);
+        // Groups duplicate and near-duplicate chunks (see ChunkDedup); runs
+        // between ProcessDocuments and the first embedding. Duplicates are
+        // dropped, or with `link` kept and tagged with the index of the chunk
+        // they repeat under ChunkDedup::kLinkKey, so CreateEmb embeds each
+        // group once. Returns the number of duplicates.
+        size_t Deduplicate(float threshold = 0.8f, bool link = false, int max_workers = 4);
         const Chunk::vdb_data& CreateEmb(std::string model = "text-embedding-ada-002"); 
+        // Stores embeddings computed elsewhere as a new element: `flat` holds one
+        // row of `dim` floats per chunk, in chunk order.
+        const Chunk::vdb_data& AddEmb(std::string model, std::vector<float> flat, size_t dim);
+        // Re-encodes element `pos` as `type`. The float copy is released unless
+        // keep_float is set, which ChunkQuery needs to re-rank quantized hits.
+        const Chunk::vdb_data& Quantize(size_t pos, Chunk::StorageType type, bool keep_float = false, int max_workers = 4);
+        // Builds the 1-bit sign codes of element `pos` used by SearchMode::Binary.
+        const Chunk::vdb_data& BuildBinaryIndex(size_t pos, int max_workers = 4);
+        // Writes the chunks, their metadata, the BM25 index and every element
+        // to a versioned binary chunk store.
+        void Save(const std::string& path) const;
+        // Opens a chunk store written by Save. Embedding arrays are mmap'd, not
+        // copied: nothing is re-chunked or re-embedded, and processes opening
+        // the same store share its pages.
+        void Load(const std::string& path);
         void LogEmbeddingStats(std::string model, std::string vendor , size_t dim, size_t n, size_t flatVD_size) const;
         void printVD(void);
         const std::vector<RAGLibrary::Document>& getChunks(void) const;
         const Chunk::vdb_data* getElement(size_t pos) const;
+        // Inverted index over chunk metadata, keyed by chunk position.
+        inline const vdb::AttributeIndex& getAttributeIndex(void) const {
+            return attributes;
+        }
+        // BM25 index over the chunk texts, built with the chunks.
+        inline const Chunk::ChunkBM25& getLexicalIndex(void) const {
+            return lexical;
+        }
         size_t quant_of_elements(void) const;
         inline bool isInitialized(void) const{
             return initialized_;
         }
-        inline const std::vector<float>& getFlatVD(size_t i) const {
+        inline std::span<const float> getFlatVD(size_t i) const {
             if (i >= elements.size())
                 throw std::out_of_range("Invalid index.");
-            if (elements[i].flatVD.empty())
+            const float* flat = elements[i].f32Data();
+            if (flat == nullptr)
                 throw std::runtime_error("flatVD is empty at index " + std::to_string(i));
-            return elements[i].flatVD;
+            return { flat, elements[i].n * elements[i].dim };
         }
         //--------------------------------------------
         void clear(void);
@@ -39,6 +74,8 @@ namespace Chunk
         std::map<std::string, std::string> metadata;
         std::vector<RAGLibrary::Document> chunks;
         std::vector<Chunk::vdb_data> elements;
+        vdb::AttributeIndex attributes;
+        Chunk::ChunkBM25 lexical;
         int m_chunk_size;
         int m_overlap;
         bool initialized_ = false;// Allow only one instance of the chunks list to be created
@@ -2,6 +2,9 @@
 #include "ChunkQuery.h"
 #include "RagException.h"
 #include "StringUtils.h"
+#include "VectorUtils.h"
+#include "TopK.h"
+#include "Tracing.h"
 #include <cstring>
 #include <iostream>
 #include <cmath>
@@ -11,7 +14,8 @@
 #include <algorithm>
 #include <memory>      // unique_ptr, make_unique
 #include <sstream>     // stringstream
-#include <torch/torch.h>
+#include <limits>
+#include <unordered_map>
 #include <iomanip>    // setprecision
 #include <stdexcept>  // std::invalid_argument
 
@@ -67,14 +71,47 @@ void Chunk::ChunkQuery::setChunks(const Chunk::ChunkDefault& chunks, size_t pos)
         m_emb_query = docs[0].embedding.value();
     }
 
+    if (vdb->empty()) throw std::runtime_error("Unable to create window");
     if (!m_chunk_embedding.empty()) m_chunk_embedding.clear();
+    // A query batch was embedded for the previous element (its model and
+    // dim); it has to be embedded again through QueryBatch.
+    m_batch_queries.clear();
+    m_batch_emb.clear();
+    m_batch_norms.clear();
     m_vdb = vdb; 
-    m_chunk_embedding.reserve(m_vdb->n);
-    for (size_t i = 0; i < m_vdb->n; ++i) {
-        const float* ptr = m_vdb->flatVD.data() + (i * m_vdb->dim);
-        m_chunk_embedding.emplace_back(ptr, m_vdb->dim); 
+    if (const float* flat = m_vdb->f32Data()) {
+        m_chunk_embedding.reserve(m_vdb->n);
+        for (size_t i = 0; i < m_vdb->n; ++i) {
+            const float* ptr = flat + (i * m_vdb->dim);
+            m_chunk_embedding.emplace_back(ptr, m_vdb->dim); 
+        }
+    }
+    // Chunk norms do not depend on the query, compute them once per store,
+    // on the representation the scan actually reads (a chunk store carries
+    // them, so opening one does not touch every row).
+    if (m_vdb->mapped.norms != nullptr) {
+        m_chunk_norms.assign(m_vdb->mapped.norms, m_vdb->mapped.norms + m_vdb->n);
+    } else {
+        m_chunk_norms.assign(m_vdb->n, 0.0f);
+        #pragma omp parallel
+        {
+            std::vector<float> scratch(m_vdb->dim);
+            #pragma omp for schedule(static)
+            for (int i = 0; i < int(m_vdb->n); ++i) {
+                m_chunk_norms[i] = VectorUtils::norm(m_vdb->rowData(size_t(i), scratch.data()), m_vdb->dim);
+            }
+        }
+    }
+    // Rescoring reads the float copy; only when it sits beside a quantized
+    // representation do its norms differ from the ones above.
+    m_f32_norms.clear();
+    if (const float* flat = m_vdb->f32Data(); flat != nullptr && m_vdb->storage != Chunk::StorageType::FP32) {
+        m_f32_norms.resize(m_vdb->n);
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < int(m_vdb->n); ++i) {
+            m_f32_norms[i] = VectorUtils::norm(flat + size_t(i) * m_vdb->dim, m_vdb->dim);
+        }
     }
-    if (m_chunk_embedding.empty()) throw std::runtime_error("Unable to create window");
     m_n_chunk =vdb->n;
     m_dim = vdb->dim;
     m_pos = pos;
@@ -100,6 +137,7 @@ void Chunk::ChunkQuery::setChunks(const Chunk::ChunkDefault& chunks, size_t pos)
 }
 
 RAGLibrary::Document Chunk::ChunkQuery::Query(std::string query, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos){
+    Tracing::Span span("chunk_query::query", "query");
     if (query.empty() || query.size()<5) {
         throw std::invalid_argument("Query string is empty.");
     }
@@ -139,8 +177,8 @@ RAGLibrary::Document Chunk::ChunkQuery::Query(RAGLibrary::Document query_doc, co
         throw std::invalid_argument("Query document is empty.");
     }
 
+    this->m_query = query_doc.page_content;
     if (pos.has_value()){
-        this->m_query = query_doc.page_content;
         if (temp_chunks != nullptr) setChunks(*temp_chunks, pos.value());
         else if(m_chunks != nullptr) setChunks(*m_chunks, pos.value());
     }
@@ -172,88 +210,334 @@ RAGLibrary::Document Chunk::ChunkQuery::Query(RAGLibrary::Document query_doc, co
     m_n = 1;
     return this->m_query_doc;
 }
-std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
-    // Validation of input parameters -----------------------------------------------------------------------
+void Chunk::ChunkQuery::PrepareRetrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
     if (m_emb_query.empty()) throw std::runtime_error("Query not yet initialized.");
     if (threshold < -1.0f || threshold > 1.0f) throw std::invalid_argument("Threshold out of bound [-1,1].");
-    if (m_vdb->flatVD.empty()) throw std::runtime_error("Embeddings not found.");
     if (pos.has_value()){
         if (temp_chunks != nullptr) setChunks(*temp_chunks, pos.value());
         else if(m_chunks != nullptr) setChunks(*m_chunks, pos.value());
         else throw std::invalid_argument("Position was provided, but no chunk context (temp_chunks or m_chunks) was set.");
     }
+    if (m_vdb == nullptr || m_vdb->empty()) throw std::runtime_error("Embeddings not found.");
+    if (m_emb_query.size() != m_dim) throw std::runtime_error("Query embedding dimension does not match the chunk embeddings.");
+}
 
-    // Temporary vector (text, score, index)
-    std::vector<std::tuple<std::string, float, int>> scored_hits;
-    auto query_tensor = torch::from_blob(
-        const_cast<float*>(m_emb_query.data()),
-        {int64_t(m_emb_query.size())}, torch::kFloat32
-    );
-    // auto query_tensor = torch::tensor(m_emb_query, torch::kFloat32); -> ?
+void Chunk::ChunkQuery::setSearchMode(SearchMode mode, size_t candidates) {
+    if (candidates == 0) throw std::invalid_argument("candidates must be >= 1.");
+    m_mode = mode;
+    m_candidates = candidates;
+}
+
+std::optional<std::vector<size_t>> Chunk::ChunkQuery::FilteredRows(void) const {
+    if (m_filter.empty()) return std::nullopt;
+    if (m_chunks == nullptr) throw std::runtime_error("A filter needs the ChunkDefault the embeddings belong to.");
+    std::vector<size_t> rows;
+    m_chunks->getAttributeIndex().match(m_filter).for_each([&](uint32_t row) {
+        if (row < m_n_chunk) rows.push_back(row);
+    });
+    return rows;
+}
+
+std::vector<Chunk::ScoredIndex> Chunk::ChunkQuery::Rescore(const std::vector<ScoredIndex>& candidates, size_t k, float threshold) const {
+    // Exact cosine from the float copy when it is kept, otherwise from the
+    // stored representation.
+    const float* query = m_emb_query.data();
+    const float norm_q = VectorUtils::norm(query, m_dim);
+    const float* flat = m_vdb->f32Data();
+    const float* norms = m_f32_norms.empty() ? m_chunk_norms.data() : m_f32_norms.data();
+
+    std::vector<ScoredIndex> scored;
+    scored.reserve(candidates.size());
+    for (const auto& [index, approx] : candidates) {
+        float sim;
+        if (flat != nullptr) {
+            const float* row = flat + index * m_dim;
+            sim = VectorUtils::cosine(query, norm_q, row, norms[index], m_dim);
+        } else {
+            const float denom = norm_q * norms[index];
+            sim = denom > 0.0f ? m_vdb->dotRow(query, index) / denom : 0.0f;
+        }
+        if (sim >= threshold) scored.emplace_back(index, sim);
+    }
+    std::sort(scored.begin(), scored.end(), [](const ScoredIndex& a, const ScoredIndex& b) {
+        return a.second > b.second || (a.second == b.second && a.first < b.first);
+    });
+    if (scored.size() > k) scored.resize(k);
+    return scored;
+}
+
+std::vector<Chunk::ScoredIndex> Chunk::ChunkQuery::RetrieveBinary(size_t k, float threshold, const std::optional<std::vector<size_t>>& rows) {
+    if (m_vdb->bitsData() == nullptr)
+        throw std::runtime_error("No binary index for these embeddings; call ChunkDefault.BuildBinaryIndex first.");
+
+    const size_t words = VectorUtils::binary_words(m_dim);
+    std::vector<uint64_t> code(words);
+    VectorUtils::binarize(m_emb_query.data(), m_dim, code.data(), m_vdb->centerData());
+    const uint64_t* bits = m_vdb->bitsData();
+    const size_t depth = k <= std::numeric_limits<size_t>::max() / m_candidates ? k * m_candidates : k;
+
+    const size_t count = rows ? rows->size() : m_n_chunk;
+
+    // Ranked by negated Hamming distance so TopK keeps the closest codes.
+    VectorUtils::TopK<size_t> best(depth);
+    #pragma omp parallel
+    {
+        VectorUtils::TopK<size_t> local(depth);
+        #pragma omp for nowait schedule(static)
+        for (int j = 0; j < int(count); ++j) {
+            const size_t i = rows ? (*rows)[j] : size_t(j);
+            const float score = -float(VectorUtils::hamming(code.data(), bits + i * words, words));
+            if (score > local.threshold()) {
+                local.push(i, score);
+            }
+        }
+        #pragma omp critical
+        best.merge(local);
+    }
+    return Rescore(best.sorted(), k, threshold);
+}
+
+std::vector<Chunk::ScoredIndex> Chunk::ChunkQuery::Retrieve(size_t k, float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
+    Tracing::Span span("chunk_query::retrieve", "query");
+    PrepareRetrieve(threshold, temp_chunks, pos);
+    // With a filter only the matching rows are scanned.
+    const auto rows = FilteredRows();
+    const size_t count = rows ? rows->size() : m_n_chunk;
+    span.SetItems(int64_t(count));
+    if (m_mode == SearchMode::Binary) {
+        m_hits = RetrieveBinary(k, threshold, rows);
+        quant_retrieve_list = m_hits.size();
+        return m_hits;
+    }
+
+    const float* query = m_emb_query.data();
+    const float norm_q = VectorUtils::norm(query, m_dim);
+    const bool quantized = m_vdb->storage != Chunk::StorageType::FP32;
+    const bool rerank = quantized && m_rerank > 0 && m_vdb->f32Data() != nullptr;
+    const size_t depth = rerank && k <= std::numeric_limits<size_t>::max() / m_rerank ? k * m_rerank : k;
+    // Quantized scores are approximate; when they are re-ranked the threshold
+    // is applied to the exact scores instead.
+    const float scan_threshold = rerank ? -1.0f : threshold;
+    VectorUtils::TopK<size_t> best(depth);
+
+    // Each thread keeps its own bounded heap, so the scan never materializes
+    // more than k candidates per thread; heaps are merged once at the end.
+    #pragma omp parallel
+    {
+        VectorUtils::TopK<size_t> local(depth);
+        #pragma omp for nowait schedule(static)
+        for (int j = 0; j < int(count); ++j) {
+            const size_t i = rows ? (*rows)[j] : size_t(j);
+            const float dot = quantized ? m_vdb->dotRow(query, i)
+                                        : VectorUtils::dot(query, m_chunk_embedding[i].data(), m_dim);
+            const float denom = norm_q * m_chunk_norms[i];
+            const float sim = denom > 0.0f ? dot / denom : 0.0f;
+            if (sim >= scan_threshold && sim > local.threshold()) {
+                local.push(i, sim);
+            }
+        }
+        #pragma omp critical
+        best.merge(local);
+    }
 
-    float norm_q = torch::norm(query_tensor).item<float>();
+    m_hits = best.sorted();
+    if (rerank) {
+        m_hits = Rescore(m_hits, k, threshold);
+    }
+    quant_retrieve_list = m_hits.size();
+    return m_hits;
+}
+
+std::vector<Chunk::ScoredIndex> Chunk::ChunkQuery::RetrieveHybrid(size_t k, Fusion fusion, float weight, size_t depth) {
+    Tracing::Span span("chunk_query::retrieve_hybrid", "query");
+    constexpr float kRrf = 60.0f;
+    if (m_query.empty()) throw std::runtime_error("Query not yet initialized.");
+    if (weight < 0.0f || weight > 1.0f) throw std::invalid_argument("Fusion weight out of bound [0,1].");
+    if (m_chunks == nullptr) throw std::runtime_error("Hybrid retrieval needs the ChunkDefault the embeddings belong to.");
+    if (depth == 0) depth = k <= std::numeric_limits<size_t>::max() / 4 ? std::max<size_t>(4 * k, 50) : k;
+
+    const auto dense = Retrieve(depth, -1.0f);
+    std::optional<vdb::Bitmap> allowed;
+    if (!m_filter.empty()) allowed = m_chunks->getAttributeIndex().match(m_filter);
+    const auto lexical = m_chunks->getLexicalIndex().Search(m_query, depth, allowed ? &*allowed : nullptr);
+
+    std::unordered_map<size_t, float> fused;
+    fused.reserve(dense.size() + lexical.size());
+    auto accumulate = [&](const std::vector<ScoredIndex>& hits, float w) {
+        if (hits.empty()) return;
+        if (fusion == Fusion::RRF) {
+            for (size_t r = 0; r < hits.size(); ++r) fused[hits[r].first] += 1.0f / (kRrf + float(r + 1));
+            return;
+        }
+        // Lists are sorted, so the extremes are the ends.
+        const float hi = hits.front().second;
+        const float lo = hits.back().second;
+        for (const auto& [index, score] : hits) {
+            fused[index] += w * (hi > lo ? (score - lo) / (hi - lo) : 1.0f);
+        }
+    };
+    accumulate(dense, weight);
+    accumulate(lexical, 1.0f - weight);
+
+    VectorUtils::TopK<size_t> best(k);
+    for (const auto& [index, score] : fused) best.push(index, score);
+    m_hits = best.sorted();
+    quant_retrieve_list = m_hits.size();
+    return m_hits;
+}
+
+std::vector<RAGLibrary::Document> Chunk::ChunkQuery::QueryBatch(const std::vector<std::string>& queries, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
+    Tracing::Span span("chunk_query::query_batch", "query");
+    span.SetItems(int64_t(queries.size()));
+    if (queries.empty()) {
+        throw std::invalid_argument("Query batch is empty.");
+    }
+    if (pos.has_value()){
+        if (temp_chunks != nullptr) setChunks(*temp_chunks, pos.value());
+        else if(m_chunks != nullptr) setChunks(*m_chunks, pos.value());
+        else throw std::invalid_argument("Position was provided, but no chunk context (temp_chunks or m_chunks) was set.");
+    }
+    if (m_vdb == nullptr) {
+        throw std::runtime_error("No chunk embeddings selected; call setChunks first.");
+    }
+
+    std::vector<RAGLibrary::Document> list;
+    list.reserve(queries.size());
+    for (const auto& q : queries) {
+        if (q.empty()) throw std::invalid_argument("Query string is empty.");
+        list.emplace_back(RAGLibrary::Metadata{}, q);
+    }
+
+    // One embedding request for the whole batch instead of one per query.
+    auto results = Chunk::Embeddings(list, m_vdb->model);
+    if (results.size() != queries.size()) {
+        throw std::runtime_error("Embedding batch size mismatch.");
+    }
+
+    m_batch_queries = queries;
+    m_batch_emb.assign(queries.size() * m_dim, 0.0f);
+    m_batch_norms.assign(queries.size(), 0.0f);
+    for (size_t q = 0; q < results.size(); ++q) {
+        const auto& emb = results[q].embedding;
+        if (!emb.has_value() || emb->size() != m_dim) {
+            throw std::runtime_error("Missing or inconsistent embedding in query batch.");
+        }
+        std::copy(emb->begin(), emb->end(), m_batch_emb.begin() + q * m_dim);
+        m_batch_norms[q] = VectorUtils::norm(emb->data(), m_dim);
+        results[q].metadata["model"] = m_vdb->model;
+    }
+    m_n = queries.size();
+    return results;
+}
+
+std::vector<std::vector<Chunk::ScoredIndex>> Chunk::ChunkQuery::RetrieveBatch(size_t k, float threshold) {
+    Tracing::Span span("chunk_query::retrieve_batch", "query");
+    span.SetItems(int64_t(m_batch_queries.size()));
+    if (m_batch_queries.empty()) throw std::runtime_error("Query batch not yet initialized.");
+    if (threshold < -1.0f || threshold > 1.0f) throw std::invalid_argument("Threshold out of bound [-1,1].");
+    if (m_vdb == nullptr || m_vdb->empty()) throw std::runtime_error("Embeddings not found.");
+    if (m_batch_emb.size() != m_batch_queries.size() * m_dim) throw std::runtime_error("Query batch dimension does not match the chunk embeddings.");
+
+    // Tile sizes: a block of store rows is scored against a block of queries
+    // with one matrix product, so the store is streamed from memory once for
+    // the whole batch while the query block stays in cache.
+    constexpr size_t kRowTile = 64;
+    constexpr size_t kQueryTile = 32;
+
+    const size_t n_queries = m_batch_queries.size();
+    // With a filter the tiles are built from the matching rows only.
+    const auto filtered = FilteredRows();
+    const size_t n_rows = filtered ? filtered->size() : m_n_chunk;
+    const size_t n_tiles = (n_rows + kRowTile - 1) / kRowTile;
+    // Quantized or filtered rows are gathered one tile at a time into a
+    // per-thread buffer, so only the rows needed are streamed from memory.
+    const bool quantized = m_vdb->storage != Chunk::StorageType::FP32;
+    const bool gather = quantized || filtered.has_value();
+    const float* store = m_vdb->f32Data();
+    const float* queries = m_batch_emb.data();
+
+    std::vector<VectorUtils::TopK<size_t>> best(n_queries, VectorUtils::TopK<size_t>(k));
 
     #pragma omp parallel
     {
-        std::vector<std::tuple<std::string, float, int>> local_hits;
-        #pragma omp for nowait
-        for (int i = 0; i < int(m_chunk_embedding.size()); ++i) {
-            auto& emb = m_chunk_embedding[i];
-            auto chunk_tensor = torch::from_blob(
-                const_cast<float*>(emb.data()),
-                {int64_t(emb.size())}, torch::kFloat32
-            );
-
-            float norm_c = torch::norm(chunk_tensor).item<float>();
-            float dot_p = torch::dot(query_tensor, chunk_tensor).item<float>();
-            float sim = dot_p / (norm_q * norm_c);
-
-            if (sim >= threshold) {// armazena (conteúdo, similaridade, índice original)
-                local_hits.emplace_back(
-                    //const auto& doc = (*this->chunks_list)[i];
-                    //std::cout << doc.page_content << std::endl;,
-                    (*this->m_chunks_list)[i].page_content,
-                    sim,
-                    i
-                );
+        std::vector<VectorUtils::TopK<size_t>> local(n_queries, VectorUtils::TopK<size_t>(k));
+        std::vector<float> scores(kRowTile * kQueryTile);
+        std::vector<float> decoded(gather ? kRowTile * m_dim : 0);
+        auto row_at = [&](size_t j) { return filtered ? (*filtered)[j] : j; };
+
+        #pragma omp for nowait schedule(static)
+        for (int tile = 0; tile < int(n_tiles); ++tile) {
+            const size_t row0 = size_t(tile) * kRowTile;
+            const size_t rows = std::min(kRowTile, n_rows - row0);
+            const float* block = store + row0 * m_dim;
+            if (gather) {
+                for (size_t r = 0; r < rows; ++r) {
+                    float* dst = decoded.data() + r * m_dim;
+                    const float* src = m_vdb->rowData(row_at(row0 + r), dst);
+                    if (src != dst) std::copy_n(src, m_dim, dst);
+                }
+                block = decoded.data();
+            }
+            for (size_t q0 = 0; q0 < n_queries; q0 += kQueryTile) {
+                const size_t cols = std::min(kQueryTile, n_queries - q0);
+                VectorUtils::gemm_nt(block, rows, queries + q0 * m_dim, cols, m_dim, scores.data());
+                for (size_t r = 0; r < rows; ++r) {
+                    const size_t row = row_at(row0 + r);
+                    const float norm_c = m_chunk_norms[row];
+                    for (size_t c = 0; c < cols; ++c) {
+                        const float denom = norm_c * m_batch_norms[q0 + c];
+                        const float sim = denom > 0.0f ? scores[r * cols + c] / denom : 0.0f;
+                        if (sim >= threshold) {
+                            local[q0 + c].push(row, sim);
+                        }
+                    }
+                }
             }
         }
         #pragma omp critical
-        scored_hits.insert(
-            scored_hits.end(),
-            local_hits.begin(),
-            local_hits.end()
-        );
-    }
-
-    std::sort(
-        scored_hits.begin(),
-        scored_hits.end(),
-        [](auto &a, auto &b) {
-            return std::get<1>(a) > std::get<1>(b);
+        for (size_t q = 0; q < n_queries; ++q) {
+            best[q].merge(local[q]);
         }
-    );
+    }
+
+    std::vector<std::vector<ScoredIndex>> out;
+    out.reserve(n_queries);
+    for (auto& heap : best) {
+        out.push_back(heap.sorted());
+    }
+    return out;
+}
+
+std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
+    // Legacy form: every chunk above the threshold, with its text copied.
+    auto hits = Retrieve(std::numeric_limits<size_t>::max(), threshold, temp_chunks, pos);
+
+    std::vector<std::tuple<std::string, float, int>> scored_hits;
+    scored_hits.reserve(hits.size());
+    for (const auto& [index, score] : hits) {
+        scored_hits.emplace_back((*this->m_chunks_list)[index].page_content, score, int(index));
+    }
 
     m_retrieve_list   = std::move(scored_hits);
-    quant_retrieve_list = int(m_retrieve_list.size()); //int quant_retrieve_list = static_cast<int>(m_retrieve_list.size());
+    quant_retrieve_list = m_retrieve_list.size();
     return m_retrieve_list;
 }
 
 
 std::string Chunk::ChunkQuery::StrQ(int index) {
+    const int n = static_cast<int>(m_hits.size());
     if (index == -1) {
-        index = quant_retrieve_list; 
+        index = n; 
     }
-    const int n = static_cast<int>(m_retrieve_list.size());
-    if (index < 0 || index >= n) {
+    if (index < 0 || index > n) {
         throw std::out_of_range("Index is out of bounds in the retrieved chunks list.");
     }
     std::ostringstream relevant_context;
     for (int i = 0; i < index; ++i) {
-        const auto& [txt_i, score_i, idx_i] = m_retrieve_list[i];
+        const auto& [idx_i, score_i] = m_hits[i];
         relevant_context
             << i << ". Score [" << score_i << "] "
-            << txt_i << "\n";
+            << getChunkText(idx_i) << "\n";
     }
     std::ostringstream ss;
     ss << "### Question:\n"
@@ -278,6 +562,14 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkQuery::getChunksList() cons
     return *m_chunks_list;
 }
 
+const std::string& Chunk::ChunkQuery::getChunkText(size_t index) const {
+    const auto& chunks = getChunksList();
+    if (index >= chunks.size()) {
+        throw std::out_of_range("Chunk index out of range.");
+    }
+    return chunks[index].page_content;
+}
+
 std::string Chunk::ChunkQuery::getMod(void) const {
     return { this->m_vdb->model };
 }
@@ -3,12 +3,29 @@
 #include <tuple>
 #include <string>
 #include <vector>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include "CommonStructs.h"
 #include "ChunkCommons/ChunkCommons.h"
 #include "ChunkDefault/ChunkDefault.h"
 
 namespace Chunk {
 
+    // (chunk index, cosine score) pair returned by the top-k retrieval path.
+    using ScoredIndex = std::pair<size_t, float>;
+
+    // Exact: cosine over every stored row.
+    // Binary: Hamming scan over the sign codes (ChunkDefault::BuildBinaryIndex),
+    // then cosine re-ranking of the best k * candidates of them.
+    enum class SearchMode { Exact, Binary };
+
+    // How RetrieveHybrid merges the vector and BM25 rankings.
+    // RRF: sum of 1 / (60 + rank) over both lists (scale free).
+    // Weighted: weight * cosine + (1 - weight) * BM25, each min-max
+    // normalized over its own candidates.
+    enum class Fusion { RRF, Weighted };
+
     class ChunkQuery {
     public:
         ChunkQuery(
@@ -20,8 +37,14 @@ namespace Chunk {
         );
         ~ChunkQuery() = default;     
         std::vector<std::tuple<std::string, float, int>> Retrieve(float threshold = 0.5, const Chunk::ChunkDefault* temp_chunks= nullptr, std::optional<size_t> pos = std::nullopt);  
+        std::vector<ScoredIndex> Retrieve(size_t k, float threshold, const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt);
         RAGLibrary::Document Query(RAGLibrary::Document query_doc = {}, const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt); 
         RAGLibrary::Document Query(std::string query = "", const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt);
+        std::vector<RAGLibrary::Document> QueryBatch(const std::vector<std::string>& queries, const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt);
+        std::vector<std::vector<ScoredIndex>> RetrieveBatch(size_t k, float threshold = -1.0f);
+        // Vector and BM25 retrieval of the current query, `depth` candidates
+        // each (0: max(4k, 50)), fused into a single top-k.
+        std::vector<ScoredIndex> RetrieveHybrid(size_t k, Fusion fusion = Fusion::RRF, float weight = 0.5f, size_t depth = 0);
         std::vector<std::tuple<std::string, float, int>> getRetrieveList(void) const;
         const std::vector<RAGLibrary::Document>& getChunksList(void) const; 
         std::tuple<size_t, size_t, size_t> getPar(void) const;
@@ -32,7 +55,19 @@ namespace Chunk {
         std::string getMod(void) const;
         void setChunks(const Chunk::ChunkDefault& chunks, size_t pos);
         std::vector<float> getEmbedQuery(void) const;
+        const std::string& getChunkText(size_t index) const;
         std::string StrQ(int index = -1); 
+        // Quantized stores only: the k * factor best hits of the quantized scan
+        // are re-scored against the float copy, when one was kept. 0 disables.
+        inline void setRerank(size_t factor) { m_rerank = factor; }
+        inline size_t getRerank(void) const { return m_rerank; }
+        void setSearchMode(SearchMode mode, size_t candidates = 10);
+        inline SearchMode getSearchMode(void) const { return m_mode; }
+        // Restricts retrieval to chunks whose metadata holds every key/value
+        // pair, resolved through ChunkDefault's attribute index.
+        inline void setFilter(std::unordered_map<std::string, std::string> filter) { m_filter = std::move(filter); }
+        inline void clearFilter(void) { m_filter.clear(); }
+        inline const std::unordered_map<std::string, std::string>& getFilter(void) const { return m_filter; }
     private:
         RAGLibrary::Document m_query_doc;
         std::vector<float> m_emb_query;
@@ -44,6 +79,7 @@ namespace Chunk {
         size_t m_n = 0;
 
         std::vector<std::tuple<std::string, float, int>> m_retrieve_list; 
+        std::vector<ScoredIndex> m_hits;
         size_t quant_retrieve_list = 0;
 
         const std::vector<RAGLibrary::Document>* m_chunks_list = nullptr;
@@ -51,6 +87,20 @@ namespace Chunk {
         const Chunk::vdb_data* m_vdb = nullptr;
         
         std::vector<std::span<const float>> m_chunk_embedding;    
+        std::vector<float> m_chunk_norms;   // norms of the scanned representation
+        std::vector<float> m_f32_norms;     // norms of the float copy kept beside a quantized one
+        size_t m_rerank = 0;
+        SearchMode m_mode = SearchMode::Exact;
+        size_t m_candidates = 10;
+        std::unordered_map<std::string, std::string> m_filter;
+
+        std::vector<std::string> m_batch_queries;
+        std::vector<float> m_batch_emb;     // m_batch_queries.size() x m_dim, row-major
+        std::vector<float> m_batch_norms;
+        void PrepareRetrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos);
+        std::vector<ScoredIndex> RetrieveBinary(size_t k, float threshold, const std::optional<std::vector<size_t>>& rows);
+        std::optional<std::vector<size_t>> FilteredRows(void) const;
+        std::vector<ScoredIndex> Rescore(const std::vector<ScoredIndex>& candidates, size_t k, float threshold) const;
         inline RAGLibrary::Document validateEmbeddingResult(const std::vector<RAGLibrary::Document>& results) {
             if (results.empty() || !results[0].embedding.has_value()) {
                 throw std::runtime_error("Embedding not present in result.");
@@ -2,31 +2,87 @@
 #include "ChunkSimilarity.h"
 #include "RagException.h"
 #include "StringUtils.h"
+#include "Tracing.h"
+#include "VectorUtils.h"
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
+#include <limits>
 #include <omp.h>
-#include <syncstream>
 
 using namespace Chunk;
 
+namespace
+{
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    inline bool IsTerminator(char c)
+    {
+        return c == '.' || c == '!' || c == '?';
+    }
+
+    // Closing characters that stay with the sentence they end.
+    inline bool IsCloser(char c)
+    {
+        return IsTerminator(c) || c == '"' || c == '\'' || c == ')' || c == ']';
+    }
+
+    // Moves `pos` (< text.size()) back onto the first byte of a UTF-8
+    // sequence without reaching `lo`.
+    inline size_t CharStart(std::string_view text, size_t pos, size_t lo)
+    {
+        size_t p = pos;
+        while (p > lo + 1 && (static_cast<unsigned char>(text[p]) & 0xC0) == 0x80)
+            --p;
+        return (static_cast<unsigned char>(text[p]) & 0xC0) == 0x80 ? pos : p;
+    }
+
+    // Linearly interpolated percentile of `values` (reordered in place).
+    float Percentile(std::vector<float> &values, float percentile)
+    {
+        const double rank = std::clamp(double(percentile), 0.0, 100.0) / 100.0 * double(values.size() - 1);
+        const size_t lo = size_t(rank);
+        std::nth_element(values.begin(), values.begin() + lo, values.end());
+        const float low = values[lo];
+        if (lo + 1 >= values.size())
+            return low;
+        const float high = *std::min_element(values.begin() + lo + 1, values.end());
+        return low + float(rank - double(lo)) * (high - low);
+    }
+}
+
 ChunkSimilarity::ChunkSimilarity(
     const int chunk_size,
     const int overlap,
     std::string embedding_model,
-    const std::string &openai_api_key)
-    : m_chunk_size(chunk_size), m_overlap(overlap), m_embedding_model(to_lowercase(embedding_model))
+    const std::string &openai_api_key,
+    const float breakpoint_percentile)
+    : m_chunk_size(chunk_size), m_overlap(overlap), m_embedding_model(to_lowercase(embedding_model)),
+      m_openai_api_key(openai_api_key), m_breakpoint_percentile(breakpoint_percentile)
 {
     ValidateModel();
 }
 
 void ChunkSimilarity::ValidateModel()
 {
+    if (m_chunk_size <= 0 || m_overlap < 0)
+    {
+        throw RAGLibrary::RagException("The chunk size must be positive and the overlap non-negative.");
+    }
+
     if (m_overlap >= m_chunk_size)
     {
         throw RAGLibrary::RagException("The overlap value must be smaller than the chunk size.");
     }
 
+    if (!(m_breakpoint_percentile >= 0.0f && m_breakpoint_percentile <= 100.0f))
+    {
+        throw RAGLibrary::RagException("The breakpoint percentile must be in [0, 100].");
+    }
+
     if(!Chunk::resolve_vendor(this->m_embedding_model)) 
         throw RAGLibrary::RagException("Invalid model.");
 
@@ -36,41 +92,122 @@ std::vector<std::vector<float>> ChunkSimilarity::GenerateEmbeddings(const std::v
 {
     std::vector<std::vector<float>> results;
     if(this->m_embedding_model=="huggingface")
-        results = Chunk::EmbeddingHuggingFaceTransformers(chunks);
+        results = Chunk::EmbeddingModelPooled(chunks, "sentence-transformers/all-MiniLM-L6-v2");
     else if(this->m_embedding_model=="openai")
         results = Chunk::EmbeddingOpeanAI(chunks, m_openai_api_key);
+    else
+        throw RAGLibrary::RagException("Embedding vendor '" + m_embedding_model + "' is not supported by ChunkSimilarity.");
     return results;
 }
 
-std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessSingleDocument(const RAGLibrary::Document &item)
+std::vector<ChunkSimilarity::Span> ChunkSimilarity::SplitSentences(std::string_view text) const
 {
-    std::vector<RAGLibrary::Document> documents;
-    try
+    const size_t n = text.size();
+    const size_t limit = size_t(m_chunk_size);
+    const size_t step = size_t(m_chunk_size - m_overlap);
+
+    std::vector<Span> spans;
+    auto push = [&](size_t b, size_t e)
     {
-        auto chunks = Chunk::SplitText(item.page_content, m_overlap, m_chunk_size);
-        auto embeddings = GenerateEmbeddings(chunks);
-        auto embeddingsTensor = Chunk::toTensor(embeddings);
-        auto similarity_matrix = torch::inner(embeddingsTensor, embeddingsTensor);
-        auto sorted_indices = torch::argsort(-similarity_matrix.sum(1));
-
-        documents.reserve(documents.size() + chunks.size());
-        for (int i = 0; i < sorted_indices.size(0); i++)
+        while (b < e && IsSpace(text[b]))
+            ++b;
+        while (e > b && IsSpace(text[e - 1]))
+            --e;
+        if (b == e)
+            return;
+        if (e - b <= limit)
         {
-            auto j = sorted_indices[i].item<int64_t>();
-            documents.push_back(RAGLibrary::Document(item.metadata, chunks[j]));
+            spans.emplace_back(b, e);
+            return;
+        }
+        for (size_t s = b;;)
+        {
+            const size_t end = e - s <= limit ? e : CharStart(text, s + limit, s);
+            spans.emplace_back(s, end);
+            if (end == e)
+                break;
+            s = CharStart(text, s + step, s);
+        }
+    };
+
+    // A sentence ends after a run of terminators (and closing quotes or
+    // brackets) that is followed by whitespace, or at a blank line.
+    size_t begin = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const char c = text[i];
+        if (IsTerminator(c))
+        {
+            size_t end = i + 1;
+            while (end < n && IsCloser(text[end]))
+                ++end;
+            if (end == n || IsSpace(text[end]))
+            {
+                push(begin, end);
+                begin = end;
+            }
+            i = end - 1;
+        }
+        else if (c == '\n')
+        {
+            size_t j = i + 1;
+            while (j < n && (text[j] == ' ' || text[j] == '\t' || text[j] == '\r'))
+                ++j;
+            if (j < n && text[j] == '\n')
+            {
+                push(begin, i);
+                begin = j;
+                i = j - 1;
+            }
         }
     }
-    catch (const std::exception &e)
+    push(begin, n);
+    return spans;
+}
+
+std::vector<ChunkSimilarity::Span> ChunkSimilarity::MergeSentences(const std::vector<Span> &sentences, const std::vector<float> &distances) const
+{
+    std::vector<Span> groups;
+    const size_t m = sentences.size();
+    if (m == 0)
+        return groups;
+    if (distances.size() + 1 != m)
+        throw RAGLibrary::RagException("Expected one distance per pair of neighbouring sentences.");
+
+    float threshold = std::numeric_limits<float>::infinity();
+    if (!distances.empty())
     {
-        std::cerr << e.what() << std::endl;
-        throw;
+        std::vector<float> sorted(distances);
+        threshold = Percentile(sorted, m_breakpoint_percentile);
     }
 
-    return documents;
+    const size_t limit = size_t(m_chunk_size);
+    size_t first = 0;
+    for (size_t i = 1; i < m; ++i)
+    {
+        const bool breakpoint = distances[i - 1] > threshold;
+        const bool too_long = sentences[i].second - sentences[first].first > limit;
+        if (breakpoint || too_long)
+        {
+            groups.emplace_back(first, i);
+            first = i;
+        }
+    }
+    groups.emplace_back(first, m);
+    return groups;
+}
+
+std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessSingleDocument(const RAGLibrary::Document &item)
+{
+    return ProcessDocuments({item}, 1);
 }
 
 std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers)
 {
+    Tracing::Span span("chunk_similarity::process", "ingest");
+    span.SetItems(int64_t(items.size()));
+    if (span.active())
+        span.SetBytes(Tracing::ContentBytes(items));
     std::vector<RAGLibrary::Document> documents;
     try
     {
@@ -81,15 +218,81 @@ std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessDocuments(const std::v
         }
 
         omp_set_num_threads(max_threads);
-#pragma omp parallel for
-        for (int i = 0; i < items.size(); i++)
+
+        const size_t n = items.size();
+        std::vector<std::vector<Span>> sentences(n);
+#pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < n; ++i)
+        {
+            sentences[i] = SplitSentences(items[i].page_content);
+        }
+
+        // Every sentence of the batch goes to the embedding model at once.
+        std::vector<size_t> offsets(n + 1, 0);
+        for (size_t i = 0; i < n; ++i)
+            offsets[i + 1] = offsets[i] + sentences[i].size();
+        std::vector<std::string> texts;
+        texts.reserve(offsets[n]);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const std::string &content = items[i].page_content;
+            for (const auto &[b, e] : sentences[i])
+                texts.emplace_back(content, b, e - b);
+        }
+
+        std::vector<std::vector<float>> embeddings;
+        if (!texts.empty())
+            embeddings = GenerateEmbeddings(texts);
+        if (embeddings.size() != texts.size())
+            throw RAGLibrary::RagException("The embedding model returned " + std::to_string(embeddings.size()) +
+                                           " vectors for " + std::to_string(texts.size()) + " sentences.");
+        std::vector<std::string>().swap(texts);
+
+        std::vector<float> norms(embeddings.size());
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < embeddings.size(); ++k)
+        {
+            norms[k] = VectorUtils::norm(embeddings[k].data(), embeddings[k].size());
+        }
+
+        // Only neighbouring sentences are compared: O(n) dot products.
+        std::vector<std::vector<Span>> groups(n);
+        bool mismatch = false;
+#pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < n; ++i)
+        {
+            const size_t base = offsets[i];
+            const size_t m = sentences[i].size();
+            std::vector<float> distances(m > 0 ? m - 1 : 0);
+            for (size_t j = 0; j + 1 < m; ++j)
+            {
+                const auto &a = embeddings[base + j];
+                const auto &b = embeddings[base + j + 1];
+                if (a.size() != b.size())
+                {
+#pragma omp atomic write
+                    mismatch = true;
+                    break;
+                }
+                distances[j] = 1.0f - VectorUtils::cosine(a.data(), norms[base + j], b.data(), norms[base + j + 1], a.size());
+            }
+            groups[i] = MergeSentences(sentences[i], distances);
+        }
+        if (mismatch)
+            throw RAGLibrary::RagException("The embedding model returned vectors of different sizes.");
+
+        size_t total = 0;
+        for (const auto &g : groups)
+            total += g.size();
+        documents.reserve(total);
+        for (size_t i = 0; i < n; ++i)
         {
-            auto &item = items[i];
-            auto docs = ProcessSingleDocument(item);
-#pragma omp critical
+            const auto &item = items[i];
+            for (const auto &[first, last] : groups[i])
             {
-                documents.reserve(documents.size() + docs.size());
-                documents.insert(documents.end(), docs.begin(), docs.end());
+                const size_t b = sentences[i][first].first;
+                const size_t e = sentences[i][last - 1].second;
+                documents.push_back(RAGLibrary::Document(item.metadata, item.page_content.substr(b, e - b)));
             }
         }
     }
@@ -4,24 +4,43 @@
 #include "ChunkCommons/ChunkCommons.h"
 #include "CommonStructs.h"
 
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace Chunk
 {
 
+    // Semantic chunker: documents are split into sentences, every sentence of
+    // the batch is embedded in one call, and a chunk ends where the cosine
+    // distance between neighbouring sentences is above the document's
+    // `breakpoint_percentile`, or where the next sentence would push it past
+    // `chunk_size` characters. Sentences longer than `chunk_size` are split
+    // into windows overlapping by `overlap`.
     class ChunkSimilarity
     {
 
     public:
+        // Byte range [first, second) of a sentence in the document text.
+        using Span = std::pair<size_t, size_t>;
+
         ~ChunkSimilarity() = default;
         ChunkSimilarity(const int chunk_size = 100,
                         const int overlap = 20,
                         std::string embedding_model = "openai",
-                        const std::string &openai_api_key = "");
+                        const std::string &openai_api_key = "",
+                        const float breakpoint_percentile = 90.0f);
 
         std::vector<RAGLibrary::Document> ProcessSingleDocument(const RAGLibrary::Document &item);
         std::vector<RAGLibrary::Document> ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers = 4);
 
+        // Sentence spans of `text`, trimmed, none longer than chunk_size.
+        std::vector<Span> SplitSentences(std::string_view text) const;
+        // Groups consecutive sentences into chunks: {first, last + 1} sentence
+        // indices. `distances[i]` is the cosine distance between sentences i
+        // and i + 1.
+        std::vector<Span> MergeSentences(const std::vector<Span> &sentences, const std::vector<float> &distances) const;
+
     protected:
         void ValidateModel();
         std::vector<std::vector<float>> GenerateEmbeddings(const std::vector<std::string> &chunks);
@@ -31,6 +50,7 @@ namespace Chunk
         int m_overlap;
         std::string m_embedding_model;
         std::string m_openai_api_key;
+        float m_breakpoint_percentile;
     };
 
 }
@@ -0,0 +1,522 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <unicode/bytestream.h>
+#include <unicode/normalizer2.h>
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
+
+#include "RagException.h"
+#include "CleaningOps.h"
+
+using namespace CleanData;
+
+namespace
+{
+    // RE2's \s: \v is not included.
+    inline bool isReSpace(unsigned char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+    }
+
+    inline bool isWord(unsigned char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+    }
+
+    inline bool inRange(unsigned char c, unsigned char lo, unsigned char hi)
+    {
+        return c >= lo && c <= hi;
+    }
+
+    // Length of the well-formed UTF-8 sequence at `p` (lead byte >= 0x80),
+    // or 0 when it is truncated, overlong, a surrogate or above U+10FFFF.
+    size_t utf8Sequence(const unsigned char *p, size_t avail)
+    {
+        const unsigned char c = p[0];
+        if (inRange(c, 0xC2, 0xDF))
+            return avail >= 2 && inRange(p[1], 0x80, 0xBF) ? 2 : 0;
+        if (inRange(c, 0xE0, 0xEF))
+        {
+            if (avail < 3 || !inRange(p[2], 0x80, 0xBF))
+                return 0;
+            const unsigned char lo = c == 0xE0 ? 0xA0 : 0x80;
+            const unsigned char hi = c == 0xED ? 0x9F : 0xBF;
+            return inRange(p[1], lo, hi) ? 3 : 0;
+        }
+        if (inRange(c, 0xF0, 0xF4))
+        {
+            if (avail < 4 || !inRange(p[2], 0x80, 0xBF) || !inRange(p[3], 0x80, 0xBF))
+                return 0;
+            const unsigned char lo = c == 0xF0 ? 0x90 : 0x80;
+            const unsigned char hi = c == 0xF4 ? 0x8F : 0xBF;
+            return inRange(p[1], lo, hi) ? 4 : 0;
+        }
+        return 0;
+    }
+
+#if defined(__AVX2__)
+    inline __m256i load32(const unsigned char *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    // 0xFF where the byte is in RE2's \s.
+    inline __m256i spaceBytes(__m256i v)
+    {
+        // \t \n \f \r are 9, 10, 12 and 13: v - 9 <= 4, minus \v (11).
+        const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(9));
+        const __m256i ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(11)),
+                                                _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d));
+        return _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    }
+
+    // 0xFF where the byte is >= 0x80.
+    inline __m256i highBytes(__m256i v)
+    {
+        return _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+    }
+
+    // 0xFF where the byte is ASCII control (< 0x20 or 0x7F) or >= 0x80.
+    inline __m256i controlOrHighBytes(__m256i v)
+    {
+        return _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7F)));
+    }
+#endif
+
+    struct SpaceClass
+    {
+        static bool Byte(unsigned char c) { return isReSpace(c); }
+#if defined(__AVX2__)
+        static __m256i Block(__m256i v) { return spaceBytes(v); }
+#endif
+    };
+
+    struct HighClass
+    {
+        static bool Byte(unsigned char c) { return c >= 0x80; }
+#if defined(__AVX2__)
+        static __m256i Block(__m256i v) { return highBytes(v); }
+#endif
+    };
+
+    // Replaces every run of `Class` bytes with one space. Each block is
+    // rewritten with one blend up to the first class byte that continues a
+    // run; that byte is dropped and the next block starts right after it.
+    template <typename Class>
+    void collapseRuns(std::string_view in, std::string &out)
+    {
+        const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+        const size_t n = in.size();
+        out.resize(n);
+        char *o = out.data();
+        size_t i = 0, k = 0;
+        bool prev = false;
+#if defined(__AVX2__)
+        const __m256i space = _mm256_set1_epi8(' ');
+        while (i + 32 <= n)
+        {
+            const __m256i v = load32(p + i);
+            const __m256i mask = Class::Block(v);
+            const uint32_t bits = uint32_t(_mm256_movemask_epi8(mask));
+            const uint32_t repeats = bits & ((bits << 1) | uint32_t(prev));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + k), _mm256_blendv_epi8(v, space, mask));
+            if (repeats == 0)
+            {
+                i += 32;
+                k += 32;
+                prev = (bits >> 31) != 0;
+                continue;
+            }
+            const unsigned j = unsigned(__builtin_ctz(repeats));
+            i += j + 1;
+            k += j;
+            prev = true;
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            const bool cls = Class::Byte(p[i]);
+            if (!cls)
+                o[k++] = char(p[i]);
+            else if (!prev)
+                o[k++] = ' ';
+            prev = cls;
+        }
+        out.resize(k);
+    }
+
+    bool isAscii(std::string_view in)
+    {
+        const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 32 <= in.size(); i += 32)
+        {
+            if (_mm256_movemask_epi8(load32(p + i)) != 0)
+                return false;
+        }
+#endif
+        for (; i < in.size(); ++i)
+        {
+            if (p[i] >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    const icu::Normalizer2 &nfkc()
+    {
+        static const icu::Normalizer2 *instance = []
+        {
+            UErrorCode status = U_ZERO_ERROR;
+            const icu::Normalizer2 *n = icu::Normalizer2::getNFKCInstance(status);
+            if (U_FAILURE(status))
+                throw RAGLibrary::RagException(std::format("CleaningOps: NFKC data unavailable: {}", u_errorName(status)));
+            return n;
+        }();
+        return *instance;
+    }
+
+    // Zero-width (non-)joiners are Cf but carry meaning in several scripts
+    // and in emoji sequences.
+    bool isStrippedControl(UChar32 c)
+    {
+        if (c == 0x200C || c == 0x200D)
+            return false;
+        const int8_t type = u_charType(c);
+        return type == U_CONTROL_CHAR || type == U_FORMAT_CHAR;
+    }
+
+    // Length of the hyphen ending right before `end`: '-', U+00AD (soft
+    // hyphen) or U+2010.
+    size_t hyphenBefore(std::string_view s, size_t end)
+    {
+        if (end >= 1 && s[end - 1] == '-')
+            return 1;
+        if (end >= 2 && s.compare(end - 2, 2, "\xC2\xAD") == 0)
+            return 2;
+        if (end >= 3 && s.compare(end - 3, 3, "\xE2\x80\x90") == 0)
+            return 3;
+        return 0;
+    }
+
+    // Length of the line break at `i`: \n, \r, \r\n or U+2028.
+    size_t lineBreakAt(std::string_view s, size_t i)
+    {
+        if (s[i] == '\n')
+            return 1;
+        if (s[i] == '\r')
+            return i + 1 < s.size() && s[i + 1] == '\n' ? 2 : 1;
+        if (s.compare(i, 3, "\xE2\x80\xA8") == 0)
+            return 3;
+        return 0;
+    }
+
+    // Position of the next \n, \r or 0xE2 (lead byte of U+2028) from `i`.
+    size_t nextBreakCandidate(std::string_view s, size_t i)
+    {
+        const auto *p = reinterpret_cast<const unsigned char *>(s.data());
+#if defined(__AVX2__)
+        for (; i + 32 <= s.size(); i += 32)
+        {
+            const __m256i v = load32(p + i);
+            const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                                                                 _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))),
+                                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(char(0xE2))));
+            if (const uint32_t bits = uint32_t(_mm256_movemask_epi8(hit)); bits != 0)
+                return i + size_t(__builtin_ctz(bits));
+        }
+#endif
+        for (; i < s.size(); ++i)
+        {
+            if (p[i] == '\n' || p[i] == '\r' || p[i] == 0xE2)
+                return i;
+        }
+        return std::string_view::npos;
+    }
+
+    size_t skipBlanksBack(std::string_view s, size_t end)
+    {
+        while (end > 0 && (s[end - 1] == ' ' || s[end - 1] == '\t'))
+            --end;
+        return end;
+    }
+
+    size_t skipBlanks(std::string_view s, size_t i)
+    {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t'))
+            ++i;
+        return i;
+    }
+}
+
+void CleaningOps::CollapseWhitespace(std::string_view in, std::string& out)
+{
+    collapseRuns<SpaceClass>(in, out);
+}
+
+void CleaningOps::StripNonAscii(std::string_view in, std::string& out)
+{
+    collapseRuns<HighClass>(in, out);
+}
+
+void CleaningOps::TrimSymbols(std::string_view in, std::string& out)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+    const auto *end = p + in.size();
+    const auto *first = std::find_if(p, end, isWord);
+    if (first == end)
+    {
+        out.clear();
+        return;
+    }
+    const auto *last = std::find_if(std::make_reverse_iterator(end), std::make_reverse_iterator(first), isWord).base();
+    out.assign(reinterpret_cast<const char *>(first), size_t(last - first));
+}
+
+void CleaningOps::Nfkc(std::string_view in, std::string& out)
+{
+    // ASCII is NFKC-stable, which is the common case for most corpora.
+    if (isAscii(in))
+    {
+        out.assign(in);
+        return;
+    }
+    out.clear();
+    out.reserve(in.size());
+    icu::StringByteSink<std::string> sink(&out);
+    UErrorCode status = U_ZERO_ERROR;
+    nfkc().normalizeUTF8(0, icu::StringPiece(in.data(), int32_t(in.size())), sink, nullptr, status);
+    if (U_FAILURE(status))
+        throw RAGLibrary::RagException(std::format("CleaningOps: NFKC normalization failed: {}", u_errorName(status)));
+}
+
+void CleaningOps::StripControl(std::string_view in, std::string& out)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+    const int32_t n = int32_t(in.size());
+    out.resize(in.size());
+    char *o = out.data();
+    size_t k = 0;
+    int32_t i = 0;
+    while (i < n)
+    {
+#if defined(__AVX2__)
+        // Printable ASCII is copied a block at a time, up to the first byte
+        // that needs a look.
+        if (i + 32 <= n)
+        {
+            const __m256i v = load32(p + i);
+            const uint32_t stop = uint32_t(_mm256_movemask_epi8(controlOrHighBytes(v)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + k), v);
+            const int32_t j = stop == 0 ? 32 : int32_t(__builtin_ctz(stop));
+            i += j;
+            k += size_t(j);
+            if (j == 32)
+                continue;
+        }
+#endif
+        const unsigned char c = p[i];
+        if (c < 0x80)
+        {
+            if (c >= 0x20 ? c != 0x7F : (c == '\t' || c == '\n' || c == '\r'))
+                o[k++] = char(c);
+            ++i;
+            continue;
+        }
+        const int32_t start = i;
+        UChar32 cp;
+        U8_NEXT(p, i, n, cp);
+        if (cp < 0)
+        {
+            // U+FFFD is three bytes and may outgrow a one-byte error.
+            out.resize(out.size() + 2);
+            o = out.data();
+            std::memcpy(o + k, "\xEF\xBF\xBD", 3);
+            k += 3;
+        }
+        else if (!isStrippedControl(cp))
+        {
+            std::memcpy(o + k, p + start, size_t(i - start));
+            k += size_t(i - start);
+        }
+    }
+    out.resize(k);
+}
+
+void CleaningOps::Dehyphenate(std::string_view in, std::string& out)
+{
+    out.clear();
+    out.reserve(in.size());
+    const auto *p = reinterpret_cast<const uint8_t *>(in.data());
+    const int32_t n = int32_t(in.size());
+    size_t copied = 0;
+    // Line breaks are rarer than hyphens, so the scan is for the break and
+    // the hyphen is looked for behind it.
+    for (size_t i = nextBreakCandidate(in, 0); i != std::string_view::npos; i = nextBreakCandidate(in, i + 1))
+    {
+        const size_t b = lineBreakAt(in, i);
+        if (b == 0)
+            continue;
+        const size_t hyphen_end = skipBlanksBack(in, i);
+        const size_t h = hyphenBefore(in, hyphen_end);
+        if (h == 0 || hyphen_end - h <= copied)
+            continue;
+
+        // The word before the hyphen has to end in a letter ...
+        int32_t before = int32_t(hyphen_end - h);
+        UChar32 prev;
+        U8_PREV(p, 0, before, prev);
+        if (prev < 0 || !u_isalpha(prev))
+            continue;
+
+        // ... and go on after the break in lower case.
+        int32_t after = int32_t(skipBlanks(in, i + b));
+        const int32_t start = after;
+        if (after >= n)
+            continue;
+        UChar32 next;
+        U8_NEXT(p, after, n, next);
+        if (next < 0 || !u_isalpha(next) || u_isupper(next))
+            continue;
+
+        out.append(in, copied, hyphen_end - h - copied);
+        copied = size_t(start);
+    }
+    out.append(in, copied, std::string_view::npos);
+}
+
+CleaningOps::Op CleaningOps::Find(std::string_view name)
+{
+    static constexpr std::pair<std::string_view, Op> ops[] = {
+        {"collapse_whitespace", CollapseWhitespace},
+        {"strip_non_ascii", StripNonAscii},
+        {"trim_symbols", TrimSymbols},
+        {"nfkc", Nfkc},
+        {"strip_control", StripControl},
+        {"dehyphenate", Dehyphenate},
+    };
+    for (const auto &[op_name, op] : ops)
+    {
+        if (op_name == name)
+            return op;
+    }
+    return nullptr;
+}
+
+// The fused default pattern is (?:^\W+|\W+$)|(?:\s+)|(?:[^\x00-\x7F]+). With
+// valid UTF-8 every non-ASCII character is \W, so it drops everything before
+// the first and after the last ASCII word character and, in between, turns
+// each run of \s and each run of non-ASCII characters into one space (a
+// non-ASCII run next to a space run gives two spaces, as with RE2). The
+// final trim then has nothing left to remove.
+bool CleaningOps::CleanDefault(std::string_view in, std::string& out)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(in.data());
+    const size_t n = in.size();
+
+    // Leading \W run; validated on the way since RE2 stops at malformed bytes.
+    size_t s = 0;
+    while (s < n && !isWord(p[s]))
+    {
+        if (p[s] < 0x80)
+        {
+            ++s;
+            continue;
+        }
+        const size_t len = utf8Sequence(p + s, n - s);
+        if (len == 0)
+            return false;
+        s += len;
+    }
+    out.clear();
+    if (s == n)
+        return true;
+
+    size_t t = n;
+    while (!isWord(p[t - 1]))
+        --t;
+    for (size_t i = t; i < n;)
+    {
+        if (p[i] < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        const size_t len = utf8Sequence(p + i, n - i);
+        if (len == 0)
+            return false;
+        i += len;
+    }
+
+    out.resize(t - s);
+    char *o = out.data();
+    size_t i = s, k = 0;
+    // 0: after a copied byte, 1: inside a \s run, 2: inside a non-ASCII run.
+    int prev = 0;
+    auto step = [&]() -> bool
+    {
+        const unsigned char c = p[i];
+        if (isReSpace(c))
+        {
+            if (prev != 1)
+                o[k++] = ' ';
+            prev = 1;
+            ++i;
+        }
+        else if (c >= 0x80)
+        {
+            const size_t len = utf8Sequence(p + i, t - i);
+            if (len == 0)
+                return false;
+            if (prev != 2)
+                o[k++] = ' ';
+            prev = 2;
+            i += len;
+        }
+        else
+        {
+            o[k++] = char(c);
+            prev = 0;
+            ++i;
+        }
+        return true;
+    };
+#if defined(__AVX2__)
+    // Each block is blended up to its first byte that needs the scalar step:
+    // a non-ASCII byte or a \s byte continuing a run.
+    const __m256i space = _mm256_set1_epi8(' ');
+    while (i + 32 <= t)
+    {
+        const __m256i v = load32(p + i);
+        const __m256i ws = spaceBytes(v);
+        const uint32_t ws_bits = uint32_t(_mm256_movemask_epi8(ws));
+        const uint32_t stop = uint32_t(_mm256_movemask_epi8(v)) | (ws_bits & ((ws_bits << 1) | uint32_t(prev == 1)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + k), _mm256_blendv_epi8(v, space, ws));
+        const unsigned j = stop == 0 ? 32 : unsigned(__builtin_ctz(stop));
+        if (j > 0)
+        {
+            i += j;
+            k += j;
+            prev = ((ws_bits >> (j - 1)) & 1) != 0 ? 1 : 0;
+        }
+        if (j < 32 && !step())
+            return false;
+    }
+#endif
+    while (i < t)
+    {
+        if (!step())
+            return false;
+    }
+    out.resize(k);
+    return true;
+}
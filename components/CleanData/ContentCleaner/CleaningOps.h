@@ -0,0 +1,43 @@
+#ifndef CLEANING_OPS_H
+#define CLEANING_OPS_H
+
+#include <string>
+#include <string_view>
+
+namespace CleanData::CleaningOps
+{
+    // A cleaning step that rewrites `in` into `out` (never aliased). Ops are
+    // selected in a pattern list as "op:<name>", see Find().
+    using Op = void (*)(std::string_view in, std::string& out);
+
+    // Byte-class ops, drop-in replacements for the matching default regexes
+    // (runs are replaced by one space, the way ContentCleaner rewrites).
+    //   collapse_whitespace  \s+             -> " "   (\t \n \f \r and space)
+    //   strip_non_ascii      [^\x00-\x7F]+   -> " "   (any byte >= 0x80)
+    //   trim_symbols         ^\W+|\W+$       -> ""    (ASCII word chars only)
+    void CollapseWhitespace(std::string_view in, std::string& out);
+    void StripNonAscii(std::string_view in, std::string& out);
+    void TrimSymbols(std::string_view in, std::string& out);
+
+    // Unicode-aware ops built on ICU.
+    //   nfkc           NFKC normalization (ligatures, full-width forms, ...);
+    //                  malformed bytes are passed through
+    //   strip_control  drops Cc and Cf characters except \t, \n, \r and
+    //                  the zero-width joiners; malformed bytes become U+FFFD
+    //   dehyphenate    joins "exam-\nple" (also U+00AD, U+2010 and U+2028)
+    //                  when the next line goes on with a lower-case letter
+    void Nfkc(std::string_view in, std::string& out);
+    void StripControl(std::string_view in, std::string& out);
+    void Dehyphenate(std::string_view in, std::string& out);
+
+    // The op registered under `name` (without the "op:" prefix), or nullptr.
+    Op Find(std::string_view name);
+
+    // Exactly what the fused default patterns of ContentCleaner produce,
+    // trimmed, without going through RE2. Returns false, leaving `out`
+    // unspecified, when `in` is not valid UTF-8; RE2 treats malformed
+    // sequences its own way, so the caller has to fall back to it.
+    bool CleanDefault(std::string_view in, std::string& out);
+}
+
+#endif
@@ -1,10 +1,12 @@
 #include <omp.h>
 #include <re2/re2.h>
+#include <algorithm>
 #include <format>
 #include <memory>
 
 #include "RagException.h"
 #include "ContentCleaner.h"
+#include "Tracing.h"
 
 using namespace CleanData;
 #include <string_view>
@@ -12,16 +14,18 @@ constexpr std::string_view extraSpaces = "\\s+";
 constexpr std::string_view nonAsciiCharacters = "[^\\x00-\\x7F]+";
 constexpr std::string_view symbolsBeginningOrEndOfLines = "^\\W+|\\W+$";
 
-static void trim(std::string& text)
+static bool isSpace(unsigned char ch)
 {
-    auto isNoSpace = [](unsigned char ch)
-    {
-        return !std::isspace(ch);
-    };
-    // remove whitespace from the beginning of the string
-    text.erase(text.begin(), std::find_if(text.begin(), text.end(), isNoSpace));
-    // remove whitespace from the end of the string
-    text.erase(std::find_if(text.rbegin(), text.rend(), isNoSpace).base(), text.end());
+    return std::isspace(ch) != 0;
+}
+
+// Length of the UTF-8 sequence starting with `lead` (1 for stray bytes).
+static size_t utf8Length(unsigned char lead)
+{
+    if (lead >= 0xF0) return 4;
+    if (lead >= 0xE0) return 3;
+    if (lead >= 0xC0) return 2;
+    return 1;
 }
 
 ContentCleaner::ContentCleaner(const std::vector<std::string>& default_patterns)
@@ -29,20 +33,31 @@ ContentCleaner::ContentCleaner(const std::vector<std::string>& default_patterns)
 {
     if (m_default_patterns.empty())
     {
-       m_default_patterns = std::vector<std::string>{
+        // The anchored pattern goes first so that, in the fused pass, it
+        // claims a leading or trailing run before the single-class patterns.
+        m_default_patterns = std::vector<std::string>{
+            std::string(symbolsBeginningOrEndOfLines),
             std::string(extraSpaces),
-            std::string(nonAsciiCharacters),
-            std::string(symbolsBeginningOrEndOfLines)
+            std::string(nonAsciiCharacters)
         };
     }
     ValidatePatterns(m_default_patterns);
+    m_default_pipeline = Compile({});
 }
 
 void ContentCleaner::ValidatePatterns(const std::vector<std::string>& patterns)
 {
     for(auto& pattern : patterns)
     {
-        re2::RE2 re2(pattern);
+        if (pattern.starts_with(kOpPrefix))
+        {
+            if (CleaningOps::Find(std::string_view(pattern).substr(kOpPrefix.size())) == nullptr)
+            {
+                throw RAGLibrary::RagException(std::format("ContentCleaner: unknown cleaning op: {}", pattern));
+            }
+            continue;
+        }
+        re2::RE2 re2(pattern, re2::RE2::Quiet);
         if(!re2.ok())
         {
             throw RAGLibrary::RagException(std::format("IsRegularPattern: {} error: {}", pattern.c_str(), re2.error().c_str()));
@@ -50,30 +65,144 @@ void ContentCleaner::ValidatePatterns(const std::vector<std::string>& patterns)
     }
 }
 
-std::string ContentCleaner::CleanContent(const std::string& text, const std::vector<std::string>& custom_patterns)
+std::shared_ptr<const ContentCleaner::Pipeline> ContentCleaner::Compile(const std::vector<std::string>& custom_patterns)
 {
-    ValidatePatterns(custom_patterns);
-    std::vector<std::shared_ptr<re2::RE2>> regexs;
-    regexs.reserve(m_default_patterns.size() + custom_patterns.size());
-
-    auto appendRegex = [&regexs](const std::string& pattern)
+    auto pipeline = std::make_shared<Pipeline>();
+    std::vector<std::string_view> regexes;
+    auto append = [&](const std::string& pattern)
     {
-        regexs.push_back(std::make_shared<re2::RE2>(pattern));
+        if (pattern.starts_with(kOpPrefix))
+            pipeline->ops.push_back(CleaningOps::Find(std::string_view(pattern).substr(kOpPrefix.size())));
+        else
+            regexes.push_back(pattern);
     };
+    std::for_each(m_default_patterns.begin(), m_default_patterns.end(), append);
+    std::for_each(custom_patterns.begin(), custom_patterns.end(), append);
+    if (regexes.empty())
+        return pipeline;
+
+    std::string fused;
+    for (const auto& pattern : regexes)
+    {
+        if (!fused.empty())
+            fused += '|';
+        fused += "(?:";
+        fused += pattern;
+        fused += ")";
+    }
+
+    re2::RE2::Options options;
+    options.set_log_errors(false);
+    options.set_never_capture(true);
+    options.set_max_mem(int64_t(64) << 20);
+    pipeline->regex = std::make_shared<const re2::RE2>(fused, options);
+    if (!pipeline->regex->ok())
+        throw RAGLibrary::RagException(std::format("ContentCleaner: cannot combine patterns: {}", pipeline->regex->error()));
+    // Still compiled: the kernel hands malformed UTF-8 back to RE2.
+    pipeline->default_kernel = regexes == std::vector<std::string_view>{
+        symbolsBeginningOrEndOfLines, extraSpaces, nonAsciiCharacters};
+    return pipeline;
+}
+
+std::shared_ptr<const ContentCleaner::Pipeline> ContentCleaner::GetPipeline(const std::vector<std::string>& custom_patterns)
+{
+    if (custom_patterns.empty())
+        return m_default_pipeline;
+
+    std::string key;
+    for (const auto& pattern : custom_patterns)
+    {
+        key += pattern;
+        key += '\0';
+    }
+    {
+        std::lock_guard lock(m_cache_mutex);
+        auto it = m_custom_pipeline.find(key);
+        if (it != m_custom_pipeline.end())
+            return it->second;
+    }
 
-    std::for_each(m_default_patterns.begin(), m_default_patterns.end(), appendRegex);
-    std::for_each(custom_patterns.begin(), custom_patterns.end(), appendRegex);
+    // Compiled outside the lock; a concurrent miss on the same set just
+    // compiles it twice.
+    ValidatePatterns(custom_patterns);
+    auto pipeline = Compile(custom_patterns);
 
-    std::string replacedText = text;
+    std::lock_guard lock(m_cache_mutex);
+    if (m_custom_pipeline.size() >= kMaxCachedPatternSets)
+        m_custom_pipeline.clear();
+    return m_custom_pipeline.try_emplace(std::move(key), std::move(pipeline)).first->second;
+}
 
-    for(auto& regex : regexs)
+// Same matching rules as RE2::GlobalReplace with a " " rewrite, but one pass
+// for every pattern and straight into `out`.
+void ContentCleaner::ReplaceAll(std::string_view text, const re2::RE2& regex, std::string& out)
+{
+    out.clear();
+    out.reserve(text.size());
+    re2::StringPiece input(text.data(), text.size());
+    re2::StringPiece match;
+    size_t pos = 0;
+    size_t last_end = std::string_view::npos;
+    while (pos <= text.size())
     {
-        re2::RE2::GlobalReplace(&replacedText, *regex, " ");
+        if (!regex.Match(input, pos, text.size(), re2::RE2::UNANCHORED, &match, 1))
+            break;
+        const size_t begin = size_t(match.data() - text.data());
+        const size_t end = begin + match.size();
+        out.append(text, pos, begin - pos);
+        if (match.empty())
+        {
+            // No empty match right where the previous one ended; otherwise
+            // the rewrite is inserted and the next character copied through.
+            if (begin != last_end)
+                out += ' ';
+            if (begin == text.size())
+                break;
+            const size_t step = std::min(utf8Length(static_cast<unsigned char>(text[begin])), text.size() - begin);
+            out.append(text, begin, step);
+            pos = begin + step;
+        }
+        else
+        {
+            out += ' ';
+            pos = end;
+            last_end = end;
+        }
     }
+    if (pos < text.size())
+        out.append(text, pos, std::string_view::npos);
+}
 
-    trim(replacedText);
+std::string ContentCleaner::Clean(std::string_view text, const Pipeline& pipeline)
+{
+    // Per-thread scratch, so a worker reuses its buffers across documents.
+    // Each step reads one buffer and writes the other.
+    thread_local std::string buffers[2];
+    size_t next = 0;
+    std::string_view current = text;
+    for (const auto op : pipeline.ops)
+    {
+        op(current, buffers[next]);
+        current = buffers[next];
+        next ^= 1;
+    }
 
-    return replacedText;
+    if (pipeline.default_kernel && CleaningOps::CleanDefault(current, buffers[next]))
+        return buffers[next];
+    if (pipeline.regex)
+    {
+        ReplaceAll(current, *pipeline.regex, buffers[next]);
+        current = buffers[next];
+    }
+
+    const auto first = std::find_if_not(current.begin(), current.end(), isSpace);
+    const auto last = std::find_if_not(current.rbegin(), std::make_reverse_iterator(first), isSpace).base();
+    return std::string(first, last);
+}
+
+std::string ContentCleaner::CleanContent(const std::string& text, const std::vector<std::string>& custom_patterns)
+{
+    return Clean(text, *GetPipeline(custom_patterns));
 }
 
 RAGLibrary::Document ContentCleaner::ProcessDocument(const RAGLibrary::Document& doc, const std::vector<std::string>& custom_patterns)
@@ -91,6 +220,10 @@ RAGLibrary::Document ContentCleaner::ProcessDocument(const RAGLibrary::Document&
 
 std::vector<RAGLibrary::Document> ContentCleaner::ProcessDocuments(const std::vector<RAGLibrary::Document>& docs, const std::vector<std::string>& custom_patterns, int max_workers)
 {
+    Tracing::Span span("cleaner::process_documents", "ingest");
+    span.SetItems(int64_t(docs.size()));
+    if (span.active())
+        span.SetBytes(Tracing::ContentBytes(docs));
     std::vector<RAGLibrary::Document> documents(docs.size());
     int max_threads = omp_get_max_threads();
     if (max_workers > 0 && max_workers < max_threads)
@@ -98,11 +231,14 @@ std::vector<RAGLibrary::Document> ContentCleaner::ProcessDocuments(const std::ve
         max_threads = max_workers;
     }
 
+    // Resolved once, not per document and thread.
+    const auto pipeline = GetPipeline(custom_patterns);
+
     omp_set_num_threads(max_threads);
-    #pragma omp parallel for
+    #pragma omp parallel for schedule(dynamic, 4)
     for (size_t i = 0; i < docs.size(); i++)
     {
-        documents[i] = ProcessDocument(docs[i], custom_patterns);
+        documents[i] = RAGLibrary::Document(docs[i].metadata, Clean(docs[i].page_content, *pipeline));
     }
 
     return documents;
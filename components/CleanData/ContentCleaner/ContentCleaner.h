@@ -1,25 +1,70 @@
 #ifndef CONTENT_CLEANER_H
 #define CONTENT_CLEANER_H
 
-#include <vector>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <re2/re2.h>
 
 #include "CommonStructs.h"
+#include "CleaningOps.h"
 
 namespace CleanData
 {
+    // Replaces every match of the cleaning patterns with a space and trims
+    // the result.
+    //
+    // All patterns are fused into one alternation and applied in a single
+    // left-to-right pass: at each position the earliest listed pattern that
+    // matches wins, and replaced text is not matched again. The default
+    // patterns are compiled once at construction; each distinct list of
+    // custom patterns is compiled on first use and cached.
+    //
+    // Entries of the form "op:<name>" select a built-in operation from
+    // CleaningOps instead of a regex (e.g. "op:nfkc", "op:dehyphenate").
+    // Ops run in list order before the regex pass. When the regexes are
+    // exactly the default patterns, the pass is done by a vectorized kernel
+    // instead of RE2, with the same output.
     class ContentCleaner
     {
         public:
             ContentCleaner(const std::vector<std::string>& default_patterns = {});
             ~ContentCleaner() = default;
+            ContentCleaner(const ContentCleaner&) = delete;
+            ContentCleaner& operator=(const ContentCleaner&) = delete;
             RAGLibrary::Document ProcessDocument(const RAGLibrary::Document& doc, const std::vector<std::string>& custom_patterns = {});
             std::vector<RAGLibrary::Document> ProcessDocuments(const std::vector<RAGLibrary::Document>& docs, const std::vector<std::string>& custom_patterns = {}, int max_workers = 4);
         protected:
             std::string CleanContent(const std::string& text, const std::vector<std::string>& custom_patterns = {});
             void ValidatePatterns(const std::vector<std::string>& patterns);
         private:
+            static constexpr size_t kMaxCachedPatternSets = 64;
+
+            static constexpr std::string_view kOpPrefix = "op:";
+
+            // A compiled pattern list: the ops in order, then the fused regex
+            // of the remaining patterns (null when there are none).
+            struct Pipeline
+            {
+                std::vector<CleaningOps::Op> ops;
+                std::shared_ptr<const re2::RE2> regex;
+                bool default_kernel = false;
+            };
+
             std::vector<std::string> m_default_patterns;
+            std::shared_ptr<const Pipeline> m_default_pipeline;
+
+            std::mutex m_cache_mutex;
+            std::unordered_map<std::string, std::shared_ptr<const Pipeline>> m_custom_pipeline;
+
+            std::shared_ptr<const Pipeline> Compile(const std::vector<std::string>& custom_patterns);
+            std::shared_ptr<const Pipeline> GetPipeline(const std::vector<std::string>& custom_patterns);
+            static void ReplaceAll(std::string_view text, const re2::RE2& regex, std::string& out);
+            static std::string Clean(std::string_view text, const Pipeline& pipeline);
     };
 
 }
@@ -1,4 +1,5 @@
 #include "BaseLoader.h"
+#include "Tracing.h"
 
 #include <chrono>
 #include <algorithm>
@@ -56,6 +57,14 @@ namespace DataLoader
                 {
                     if(auto value = elem.threadQueue.pop())
                     {
+                        Tracing::Span span("loader::extract", "ingest");
+                        if (span.active())
+                        {
+                            std::error_code ec;
+                            const auto size = fs::file_size(value->targetIdentifier, ec);
+                            if (!ec)
+                                span.SetBytes(int64_t(size));
+                        }
                         callback(*value);
                         elem.threadRemainingWork--;
                     }
@@ -11,6 +11,16 @@
 
 namespace MetadataExtractor
 {
+    // Where an extracted value was found: bytes [begin, end) of
+    // pageContent[page].
+    struct MetadataSpan
+    {
+        std::string name;
+        size_t page;
+        size_t begin;
+        size_t end;
+    };
+
     struct Document
     {
         Document(const std::vector<std::string>& _pageContent, const std::vector<std::pair<std::string, std::string>>& _metadata = {}) :
@@ -30,6 +40,8 @@ namespace MetadataExtractor
 
         std::vector<std::string> pageContent;
         std::vector<std::pair<std::string, std::string>> metadata;
+        // Filled by extractors that know match positions (regex); empty otherwise.
+        std::vector<MetadataSpan> spans;
     };
     using ThreadSafeQueueDocument = RAGLibrary::ThreadSafeQueue<Document>;
 }
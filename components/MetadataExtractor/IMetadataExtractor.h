@@ -14,7 +14,7 @@ namespace MetadataExtractor
         virtual ~IMetadataExtractor() = default;
 
         virtual Document ProcessDocument(Document doc) = 0;
-        virtual std::vector<Document> ProcessDocuments(std::vector<Document> docs, const int& maxWorkers) = 0;
+        virtual std::vector<Document> ProcessDocuments(const std::vector<Document>& docs, const int& maxWorkers) = 0;
     };
     using IMetadataExtractorPtr = std::shared_ptr<IMetadataExtractor>;
 }
@@ -1,51 +1,26 @@
 #include "MetadataExtractor.h"
 
 #include <algorithm>
+#include <thread>
 #include <vector>
-#include <future>
-#include <atomic>
-#include <semaphore>
-#include <mutex>
-#include <chrono>
 
 #include "Document.h"
+#include "ThreadPool.h"
 
 namespace MetadataExtractor
 {
-    std::vector<Document> MetadataExtractor::ProcessDocuments(std::vector<Document> docs, const int& maxWorkers)
+    RAGLibrary::ThreadPool &MetadataExtractor::SharedPool()
     {
-        std::vector<std::pair<std::shared_ptr<std::future<void>>, ThreadSafeQueueDocument>> threadPool(maxWorkers);
-        std::atomic_bool killThread{false}; 
-        std::binary_semaphore threadYield{0};
-        std::mutex mutex;
-        std::vector<Document> returnDocuments;
-        
-        for(auto& thread : threadPool)
-        {
-            thread.first = std::make_shared<std::future<void>>(std::async(std::launch::async, [this, &thread, &killThread, &threadYield, &returnDocuments, &mutex](){
-                while(!killThread)
-                {
-                    if(auto value = thread.second.pop())
-                    {
-                        std::scoped_lock lock(mutex);
-                        returnDocuments.push_back(ProcessDocument(*value));
-                    }
-                    threadYield.try_acquire_for(std::chrono::milliseconds(10));
-                }
-            }));
-        }
-
-        for(auto index = 0; index < docs.size(); ++index)
-        {
-            threadPool[index % threadPool.size()].second.push(docs[index]);
-        }
+        static RAGLibrary::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
 
-        std::for_each(threadPool.begin(), threadPool.end(), [this](auto& thread){
-            while(thread.second.size() != 0);
-        });
-        killThread = true;
-        threadYield.release();
-        
+    std::vector<Document> MetadataExtractor::ProcessDocuments(const std::vector<Document>& docs, const int& maxWorkers)
+    {
+        std::vector<Document> returnDocuments(docs);
+        SharedPool().ParallelFor(0, returnDocuments.size(), [this, &returnDocuments](std::size_t index){
+            returnDocuments[index] = ProcessDocument(std::move(returnDocuments[index]));
+        }, 1, std::size_t(std::max(maxWorkers, 1)));
         return returnDocuments;
     }
 
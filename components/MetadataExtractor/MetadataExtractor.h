@@ -6,6 +6,11 @@
 #include "Document.h"
 #include "IMetadataExtractor.h"
 
+namespace RAGLibrary
+{
+    class ThreadPool;
+}
+
 namespace MetadataExtractor
 {
     class MetadataExtractor : public IMetadataExtractor
@@ -15,7 +20,14 @@ namespace MetadataExtractor
         virtual ~MetadataExtractor() = default;
 
         Document ProcessDocument(Document doc) override = 0;
-        std::vector<Document> ProcessDocuments(std::vector<Document> docs, const int& maxWorkers) override;
+        // Runs ProcessDocument on up to maxWorkers threads of a shared pool;
+        // results keep the order of `docs` and the first exception is rethrown.
+        std::vector<Document> ProcessDocuments(const std::vector<Document>& docs, const int& maxWorkers) override;
+
+    protected:
+        // Shared by every extractor for the life of the process; maxWorkers
+        // caps how many of its threads one call occupies.
+        static RAGLibrary::ThreadPool &SharedPool();
     };
 }
 #endif
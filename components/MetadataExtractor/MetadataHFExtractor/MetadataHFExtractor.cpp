@@ -2,9 +2,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 
 #include "nlohmann/json.hpp"
+#include "RagException.h"
+#include "ThreadPool.h"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -27,14 +32,25 @@ static std::wstring to_wstring_utf16(const std::string &utf8)
 
 namespace MetadataHFExtractor
 {
-    MetadataHFExtractor::MetadataHFExtractor()
+    MetadataHFExtractor::MetadataHFExtractor(size_t maxLength, size_t stride, size_t batchSize, size_t intraOpThreads)
+        : m_maxLength(maxLength), m_stride(stride), m_batchSize(batchSize),
+          m_intraOpThreads(intraOpThreads ? intraOpThreads : std::max(1u, std::thread::hardware_concurrency()))
     {
+        if (m_maxLength <= m_stride + 2)
+        {
+            throw RAGLibrary::RagException("maxLength must be greater than stride + 2.");
+        }
+        if (m_batchSize == 0)
+        {
+            throw RAGLibrary::RagException("batchSize must be positive.");
+        }
     }
 
     void MetadataHFExtractor::InitializeNERModel()
     {
         m_env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "NER");
         m_sessionOptions.SetInterOpNumThreads(1);
+        m_sessionOptions.SetIntraOpNumThreads(int(m_intraOpThreads));
 
         #ifdef _WIN32
         std::wstring wpath = to_wstring_utf16(modelPath);
@@ -45,57 +61,78 @@ namespace MetadataHFExtractor
 
         auto blob = RAGLibrary::FileReader(tokenizerPath);
         m_tokenizer = tokenizers::Tokenizer::FromBlobJSON(blob);
+        m_clsId = m_tokenizer->TokenToId("[CLS]");
+        m_sepId = m_tokenizer->TokenToId("[SEP]");
         ReadingFromLabelMap(labelMapPath);
 
         std::cout << "Model loaded successfully!" << std::endl;
     }
 
-    std::vector<std::pair<std::string, std::string>> MetadataHFExtractor::ExtractMetadata(const std::vector<std::string> &text)
+    MetadataHFExtractor::Entities MetadataHFExtractor::ExtractMetadata(const std::vector<std::string> &text)
     {
-        Ort::AllocatorWithDefaultOptions allocator;
-        std::string fullText;
-        for (auto elem : text)
+        return std::move(ExtractMetadataBatch({text}).front());
+    }
+
+    std::vector<MetadataHFExtractor::Entities> MetadataHFExtractor::ExtractMetadataBatch(const std::vector<std::vector<std::string>> &texts, int maxWorkers)
+    {
+        if (!m_session || !m_tokenizer)
         {
-            fullText += elem + " ";
+            throw RAGLibrary::RagException("InitializeNERModel must be called before extracting metadata.");
         }
-        auto tmpIds = m_tokenizer->Encode(fullText);
 
-        std::vector<int64_t> inputIds(tmpIds.size(), 0);
-        std::vector<int64_t> attentionMask(tmpIds.size(), 0);
-        for (auto index = 0; index < inputIds.size(); ++index)
+        // Every page is a sequence of its own.
+        std::vector<size_t> owner;
+        std::vector<std::string> pages;
+        for (size_t i = 0; i < texts.size(); ++i)
         {
-            inputIds[index] = tmpIds[index];
-            inputIds[index] > 0 ? attentionMask[index] = 1 : attentionMask[index] = 0;
+            for (const auto &page : texts[i])
+            {
+                if (!page.empty())
+                {
+                    owner.push_back(i);
+                    pages.push_back(page);
+                }
+            }
         }
 
-        std::vector<int64_t> tokenTypeIds(tmpIds.size(), 0);
-        std::vector<int64_t> inputShape{1, static_cast<int64_t>(tmpIds.size())};
-
-        Ort::Value attentionTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), attentionMask.data(), attentionMask.size(), inputShape.data(), inputShape.size());
-        Ort::Value inputTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), inputIds.data(), inputIds.size(), inputShape.data(), inputShape.size());
-        Ort::Value tokenTypeTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), tokenTypeIds.data(), tokenTypeIds.size(), inputShape.data(), inputShape.size());
-
-        const char *inputNames[] = {"input_ids", "attention_mask", "token_type_ids"};
-        std::vector<Ort::Value> inputTensors;
-        inputTensors.emplace_back(std::move(inputTensor));
-        inputTensors.emplace_back(std::move(attentionTensor));
-        inputTensors.emplace_back(std::move(tokenTypeTensor));
-
-        const char *outputNames[] = {"logits"};
-        auto outputTensors = m_session->Run(Ort::RunOptions(nullptr), inputNames, inputTensors.data(), 3, outputNames, 1);
+        std::vector<std::vector<int32_t>> ids;
+        std::vector<std::vector<bool>> continuation(pages.size());
+        {
+            std::scoped_lock lock(m_tokenizerMutex);
+            ids = m_tokenizer->EncodeBatch(pages);
+            for (size_t k = 0; k < ids.size(); ++k)
+            {
+                auto &seq = ids[k];
+                if (!seq.empty() && seq.front() == m_clsId)
+                    seq.erase(seq.begin());
+                if (!seq.empty() && seq.back() == m_sepId)
+                    seq.pop_back();
+                continuation[k].resize(seq.size());
+                for (size_t t = 0; t < seq.size(); ++t)
+                    continuation[k][t] = m_tokenizer->IdToToken(seq[t]).starts_with("##");
+            }
+        }
 
-        auto logits = outputTensors[0].GetTensorMutableData<float>();
-        auto outputSize = outputTensors[0].GetTensorTypeAndShapeInfo().GetElementCount();
-        size_t seqLength = inputIds.size();
-        size_t numLabels = m_labelMap.size();
-        auto returnVec = ProcessLogits(logits, seqLength, numLabels, m_labelMap);
+        std::vector<Window> windows;
+        std::vector<std::vector<int>> labels(ids.size());
+        for (size_t k = 0; k < ids.size(); ++k)
+        {
+            auto seqWindows = MakeWindows(k, ids[k].size());
+            windows.insert(windows.end(), seqWindows.begin(), seqWindows.end());
+            labels[k].assign(ids[k].size(), -1);
+        }
+        RunWindows(ids, windows, labels, maxWorkers);
 
-        std::vector<std::pair<std::string, std::string>> returnValues;
-        for (auto index = 0; index < tmpIds.size(); ++index)
+        std::vector<Entities> results(texts.size());
+        std::scoped_lock lock(m_tokenizerMutex);
+        for (size_t k = 0; k < ids.size(); ++k)
         {
-            returnValues.emplace_back(m_tokenizer->IdToToken(tmpIds[index]), returnVec[index]);
+            for (const auto &[entityIds, type] : MergeEntities(ids[k], continuation[k], labels[k]))
+            {
+                results[owner[k]].emplace_back(m_tokenizer->Decode(entityIds), type);
+            }
         }
-        return returnValues;
+        return results;
     }
 
     ::MetadataExtractor::Document MetadataHFExtractor::ProcessDocument(::MetadataExtractor::Document doc)
@@ -104,6 +141,23 @@ namespace MetadataHFExtractor
         return doc;
     }
 
+    std::vector<::MetadataExtractor::Document> MetadataHFExtractor::ProcessDocuments(const std::vector<::MetadataExtractor::Document> &docs, const int &maxWorkers)
+    {
+        std::vector<std::vector<std::string>> texts;
+        texts.reserve(docs.size());
+        for (const auto &doc : docs)
+        {
+            texts.push_back(doc.pageContent);
+        }
+        auto entities = ExtractMetadataBatch(texts, maxWorkers);
+        std::vector<::MetadataExtractor::Document> returnDocuments(docs);
+        for (size_t i = 0; i < returnDocuments.size(); ++i)
+        {
+            returnDocuments[i].metadata = std::move(entities[i]);
+        }
+        return returnDocuments;
+    }
+
     void MetadataHFExtractor::ReadingFromLabelMap(const std::string &filePath)
     {
         std::ifstream labelMapFile(filePath);
@@ -122,42 +176,158 @@ namespace MetadataHFExtractor
         }
     }
 
-    std::vector<float> MetadataHFExtractor::SoftMax(const std::vector<float> &logits)
+    std::vector<MetadataHFExtractor::Window> MetadataHFExtractor::MakeWindows(size_t seq, size_t length) const
     {
-        if (logits.empty()) 
+        const size_t specials = size_t(m_clsId >= 0) + size_t(m_sepId >= 0);
+        const size_t width = m_maxLength - specials;
+        const size_t step = width - m_stride;
+
+        // Neighbouring windows split their overlap in the middle.
+        std::vector<Window> windows;
+        for (size_t begin = 0; begin < length; begin += step)
         {
-            return {};
+            const size_t end = std::min(begin + width, length);
+            windows.push_back({seq, begin, end,
+                               begin == 0 ? 0 : begin + m_stride / 2,
+                               end == length ? length : begin + step + m_stride / 2});
+            if (end == length)
+                break;
         }
-    
-        std::vector<float> probabilities(logits.size());
-        float max_logit = logits[0];
-        for (float v : logits) max_logit = std::max(max_logit, v);
-        float sum_exp = 0.0;
-        for (size_t i = 0; i < logits.size(); i++) 
+        return windows;
+    }
+
+    void MetadataHFExtractor::RunWindows(const std::vector<std::vector<int32_t>> &ids, const std::vector<Window> &windows,
+                                         std::vector<std::vector<int>> &labels, int maxWorkers)
+    {
+        if (windows.empty())
+            return;
+
+        // Longest windows first, so that each batch pads little.
+        std::vector<size_t> order(windows.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         { return windows[a].end - windows[a].begin > windows[b].end - windows[b].begin; });
+
+        const bool cls = m_clsId >= 0;
+        const bool sep = m_sepId >= 0;
+        const size_t batches = (order.size() + m_batchSize - 1) / m_batchSize;
+
+        // One batch per task on the extractors' shared pool; the calling
+        // thread takes batches too, so at most maxWorkers run at once. Each
+        // run has its own m_intraOpThreads, so fewer run together when those
+        // would oversubscribe the cores.
+        const size_t fit = std::max<size_t>(1, std::max(1u, std::thread::hardware_concurrency()) / m_intraOpThreads);
+        const size_t workers = std::min(size_t(std::max(maxWorkers, 1)), fit);
+        auto work = [&](size_t batch)
         {
-            float logit = logits[i] - max_logit;
-            float exp_logit = std::exp(logit);
-            sum_exp += exp_logit;
-            probabilities[i] = exp_logit;
-        }
-        for (size_t i = 0; i < probabilities.size(); i++) probabilities[i] /= sum_exp;
-        return probabilities;
+            Ort::AllocatorWithDefaultOptions allocator;
+            const size_t first = batch * m_batchSize;
+            const size_t count = std::min(m_batchSize, order.size() - first);
+            const size_t seqLength = windows[order[first]].end - windows[order[first]].begin + cls + sep;
+
+            std::vector<int64_t> inputIds(count * seqLength, 0);
+            std::vector<int64_t> attentionMask(count * seqLength, 0);
+            std::vector<int64_t> tokenTypeIds(count * seqLength, 0);
+            for (size_t r = 0; r < count; ++r)
+            {
+                const Window &w = windows[order[first + r]];
+                int64_t *row = inputIds.data() + r * seqLength;
+                size_t pos = 0;
+                if (cls)
+                    row[pos++] = m_clsId;
+                for (size_t t = w.begin; t < w.end; ++t)
+                    row[pos++] = ids[w.seq][t];
+                if (sep)
+                    row[pos++] = m_sepId;
+                std::fill_n(attentionMask.data() + r * seqLength, pos, 1);
+            }
+            std::vector<int64_t> inputShape{int64_t(count), int64_t(seqLength)};
+
+            Ort::Value attentionTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), attentionMask.data(), attentionMask.size(), inputShape.data(), inputShape.size());
+            Ort::Value inputTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), inputIds.data(), inputIds.size(), inputShape.data(), inputShape.size());
+            Ort::Value tokenTypeTensor = Ort::Value::CreateTensor<int64_t>(allocator.GetInfo(), tokenTypeIds.data(), tokenTypeIds.size(), inputShape.data(), inputShape.size());
+
+            const char *inputNames[] = {"input_ids", "attention_mask", "token_type_ids"};
+            std::vector<Ort::Value> inputTensors;
+            inputTensors.emplace_back(std::move(inputTensor));
+            inputTensors.emplace_back(std::move(attentionTensor));
+            inputTensors.emplace_back(std::move(tokenTypeTensor));
+
+            const char *outputNames[] = {"logits"};
+            auto outputTensors = m_session->Run(Ort::RunOptions(nullptr), inputNames, inputTensors.data(), 3, outputNames, 1);
+
+            const float *logits = outputTensors[0].GetTensorData<float>();
+            const auto shape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
+            if (shape.size() != 3 || size_t(shape[0]) != count || size_t(shape[1]) != seqLength)
+            {
+                throw RAGLibrary::RagException("Unexpected logits shape from the NER model.");
+            }
+            const size_t numLabels = size_t(shape[2]);
+
+            for (size_t r = 0; r < count; ++r)
+            {
+                const Window &w = windows[order[first + r]];
+                const float *rowLogits = logits + (r * seqLength + cls) * numLabels;
+                for (size_t t = w.ownBegin; t < w.ownEnd; ++t)
+                {
+                    labels[w.seq][t] = ArgMax(rowLogits + (t - w.begin) * numLabels, numLabels);
+                }
+            }
+        };
+
+        SharedPool().ParallelFor(0, batches, work, 1, workers);
     }
 
-    std::vector<std::string> MetadataHFExtractor::ProcessLogits(float *logits, size_t seqLength, size_t numLabels, const std::map<int, std::string> &labelMap)
+    std::vector<std::pair<std::vector<int32_t>, std::string>> MetadataHFExtractor::MergeEntities(const std::vector<int32_t> &ids,
+                                                                                               const std::vector<bool> &continuation,
+                                                                                               const std::vector<int> &labels) const
     {
-        std::vector<std::string> returnValues;
-        for (int tokenIdx = 0; tokenIdx < seqLength; ++tokenIdx)
+        // A word is labelled by its first sub-token. "B-X" always opens an
+        // entity, "I-X" (or a bare "X") extends the previous one when it has
+        // the same type; "O" closes it.
+        std::vector<std::pair<std::vector<int32_t>, std::string>> entities;
+        std::vector<int32_t> current;
+        std::string type;
+        auto flush = [&]()
         {
-            std::vector<float> tokenLogits(logits + tokenIdx * numLabels, logits + (tokenIdx + 1) * numLabels);
-            std::vector<float> probabilities = SoftMax(tokenLogits);
+            if (!current.empty())
+                entities.emplace_back(std::move(current), type);
+            current.clear();
+        };
+
+        for (size_t t = 0; t < ids.size(); ++t)
+        {
+            if (continuation[t] && t > 0)
+            {
+                if (!current.empty())
+                    current.push_back(ids[t]);
+                continue;
+            }
 
-            int labelId = std::distance(probabilities.begin(), std::max_element(probabilities.begin(), probabilities.end()));
+            const auto it = m_labelMap.find(labels[t]);
+            const std::string_view label = it == m_labelMap.end() ? std::string_view("O") : std::string_view(it->second);
+            if (label.empty() || label == "O")
+            {
+                flush();
+                continue;
+            }
 
-            std::string tokenLabel = m_labelMap.at(labelId);
-            returnValues.emplace_back(tokenLabel);
+            const bool prefixed = label.size() > 2 && label[1] == '-';
+            const std::string_view entityType = prefixed ? label.substr(2) : label;
+            if ((prefixed && label[0] == 'B') || entityType != type)
+            {
+                flush();
+                type = entityType;
+            }
+            current.push_back(ids[t]);
         }
-        return returnValues;
+        flush();
+        return entities;
+    }
+
+    int MetadataHFExtractor::ArgMax(const float *logits, size_t numLabels)
+    {
+        return int(std::max_element(logits, logits + numLabels) - logits);
     }
 
 }
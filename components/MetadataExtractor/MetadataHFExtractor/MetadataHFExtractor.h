@@ -9,32 +9,72 @@
 #include "FileUtilsLocal.h"
 #include "Document.h"
 
+#include <mutex>
+
 namespace MetadataHFExtractor
 {
     const std::string modelPath = "models/dbmdz/bert-large-cased-finetuned-conll03-english/model.onnx";
     const std::string tokenizerPath = "models/dbmdz/bert-large-cased-finetuned-conll03-english/tokenizer/tokenizer.json";
     const std::string labelMapPath = "models/dbmdz/bert-large-cased-finetuned-conll03-english/label_map.json";
 
+    // Token classification over windows of at most `maxLength` tokens
+    // (special tokens included) that overlap by `stride` tokens; each token
+    // takes its label from the window where it sits furthest from an edge.
+    // Windows of all texts are run `batchSize` at a time, and the labelled
+    // tokens are merged into (entity, type) pairs following the B-/I- tags.
+    // Each model run uses `intraOpThreads` threads (0: one per hardware
+    // thread), and batches only run in parallel while their threads fit in
+    // the hardware.
+    // Once InitializeNERModel has run, extraction may be called concurrently.
     class MetadataHFExtractor : public IMetadataHFExtractor
     {
     public:
-        MetadataHFExtractor();
+        using Entities = std::vector<std::pair<std::string, std::string>>;
+
+        MetadataHFExtractor(size_t maxLength = 512, size_t stride = 128, size_t batchSize = 8, size_t intraOpThreads = 0);
         ~MetadataHFExtractor() = default;
 
         void InitializeNERModel() final;
-        std::vector<std::pair<std::string, std::string>> ExtractMetadata(const std::vector<std::string> &text) final;
+        Entities ExtractMetadata(const std::vector<std::string> &text) final;
+        // Entities of each text list; windows of all lists share batches and
+        // up to `maxWorkers` batches run at once.
+        std::vector<Entities> ExtractMetadataBatch(const std::vector<std::vector<std::string>> &texts, int maxWorkers = 1);
         ::MetadataExtractor::Document ProcessDocument(::MetadataExtractor::Document doc) final;
+        std::vector<::MetadataExtractor::Document> ProcessDocuments(const std::vector<::MetadataExtractor::Document> &docs, const int &maxWorkers) final;
 
     private:
+        // Token range [begin, end) of a sequence fed to the model; only the
+        // labels of [ownBegin, ownEnd) are kept.
+        struct Window
+        {
+            size_t seq;
+            size_t begin;
+            size_t end;
+            size_t ownBegin;
+            size_t ownEnd;
+        };
+
         std::shared_ptr<Ort::Env> m_env;
         Ort::SessionOptions m_sessionOptions;
         std::shared_ptr<Ort::Session> m_session;
         std::unique_ptr<tokenizers::Tokenizer> m_tokenizer;
+        std::mutex m_tokenizerMutex; // tokenizers_cpp handles are not reentrant
         std::map<int, std::string> m_labelMap;
+        int32_t m_clsId = -1;
+        int32_t m_sepId = -1;
+        size_t m_maxLength;
+        size_t m_stride;
+        size_t m_batchSize;
+        size_t m_intraOpThreads;
 
         void ReadingFromLabelMap(const std::string &filePath);
-        std::vector<float> SoftMax(const std::vector<float> &logits);
-        std::vector<std::string> ProcessLogits(float *logits, size_t seqLength, size_t numLabels, const std::map<int, std::string> &labelMap);
+        std::vector<Window> MakeWindows(size_t seq, size_t length) const;
+        void RunWindows(const std::vector<std::vector<int32_t>> &ids, const std::vector<Window> &windows,
+                        std::vector<std::vector<int>> &labels, int maxWorkers);
+        std::vector<std::pair<std::vector<int32_t>, std::string>> MergeEntities(const std::vector<int32_t> &ids,
+                                                                               const std::vector<bool> &continuation,
+                                                                               const std::vector<int> &labels) const;
+        static int ArgMax(const float *logits, size_t numLabels);
     };
 }
 #endif
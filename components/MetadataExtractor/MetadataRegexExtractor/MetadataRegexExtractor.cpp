@@ -1,13 +1,24 @@
 #include "MetadataRegexExtractor.h"
 
 #include <algorithm>
-#include <future>
-#include <atomic>
-#include <semaphore>
-#include <mutex>
+#include <numeric>
+
+#include "RagException.h"
 
 namespace MetadataRegexExtractor
 {
+    namespace
+    {
+        // Offset of the character after the one starting at `pos`.
+        size_t NextChar(std::string_view text, size_t pos)
+        {
+            ++pos;
+            while (pos < text.size() && (static_cast<unsigned char>(text[pos]) & 0xC0) == 0x80)
+                ++pos;
+            return pos;
+        }
+    }
+
     MetadataRegexExtractor::MetadataRegexExtractor()
     {
         m_patterns["ProperName"] = std::make_shared<RE2>("[A-Z][a-z]+(?:\\s[A-Z][a-z]+)*");
@@ -15,26 +26,117 @@ namespace MetadataRegexExtractor
         m_patterns["Number"] = std::make_shared<RE2>("\\b\\d+\\b");
         m_patterns["Email"] = std::make_shared<RE2>("\\b[A-Za-z0-9._%+-]+@[A-Za-z0-9.-]+\\.[A-Za-z]{2,}\\b");
         m_patterns["URL"] = std::make_shared<RE2>("\\bhttps?://[^\\s]+\\b");
+        m_compiled = Compile(m_patterns);
     }
 
     void MetadataRegexExtractor::AddPattern(const std::string& name, const std::string& pattern)
     {
-        m_patterns[name] = std::make_shared<RE2>(pattern);
+        RE2::Options options;
+        options.set_log_errors(false);
+        auto regex = std::make_shared<RE2>(pattern, options);
+        if (!regex->ok())
+        {
+            throw RAGLibrary::RagException("Invalid pattern '" + name + "': " + regex->error());
+        }
+
+        std::scoped_lock lock(m_mutex);
+        auto patterns = m_patterns;
+        patterns[name] = regex;
+        m_compiled = Compile(patterns);
+        m_patterns = std::move(patterns);
     }
 
-    ::MetadataExtractor::Document MetadataRegexExtractor::ProcessDocument(::MetadataExtractor::Document doc)
+    std::shared_ptr<const MetadataRegexExtractor::Compiled> MetadataRegexExtractor::Compile(const std::map<std::string, RE2Ptr>& patterns)
+    {
+        auto compiled = std::make_shared<Compiled>();
+        compiled->set = std::make_unique<RE2::Set>(RE2::Options(), RE2::UNANCHORED);
+        for (const auto& [name, regex] : patterns)
+        {
+            std::string error;
+            if (compiled->set->Add(regex->pattern(), &error) < 0)
+            {
+                throw RAGLibrary::RagException("Invalid pattern '" + name + "': " + error);
+            }
+            compiled->names.push_back(name);
+            compiled->regexes.push_back(regex);
+        }
+        if (!compiled->set->Compile())
+        {
+            throw RAGLibrary::RagException("Failed to compile the metadata patterns.");
+        }
+        return compiled;
+    }
+
+    std::shared_ptr<const MetadataRegexExtractor::Compiled> MetadataRegexExtractor::Snapshot() const
+    {
+        std::scoped_lock lock(m_mutex);
+        return m_compiled;
+    }
+
+    std::vector<MetadataRegexExtractor::Match> MetadataRegexExtractor::FindMatches(std::string_view text) const
     {
-        for(auto index = 0; index < doc.pageContent.size(); ++index)
+        return FindMatches(*Snapshot(), text);
+    }
+
+    std::vector<MetadataRegexExtractor::Match> MetadataRegexExtractor::FindMatches(const Compiled& compiled, std::string_view text)
+    {
+        std::vector<Match> matches;
+        if (compiled.regexes.empty())
+        {
+            return matches;
+        }
+
+        // One pass over the text for all patterns; if the set gives up (DFA
+        // out of memory) every pattern is searched.
+        std::vector<int> hits;
+        RE2::Set::ErrorInfo info{};
+        if (!compiled.set->Match(text, &hits, &info) && info.kind != RE2::Set::kNoError)
+        {
+            hits.resize(compiled.regexes.size());
+            std::iota(hits.begin(), hits.end(), 0);
+        }
+        std::sort(hits.begin(), hits.end());
+
+        const re2::StringPiece input(text.data(), text.size());
+        re2::StringPiece match;
+        for (const int hit : hits)
         {
-            std::for_each(m_patterns.begin(), m_patterns.end(), [this, &doc, index](std::pair<std::string, RE2Ptr> pair){
-                if(RE2::FullMatch(doc.pageContent[index], *pair.second))
+            const RE2& regex = *compiled.regexes[hit];
+            size_t pos = 0;
+            while (pos <= text.size() && regex.Match(input, pos, text.size(), RE2::UNANCHORED, &match, 1))
+            {
+                const size_t begin = size_t(match.data() - text.data());
+                const size_t end = begin + match.size();
+                if (end > begin)
                 {
-                    doc.metadata.emplace_back(doc.pageContent[index], pair.first);
+                    matches.push_back({compiled.names[hit], begin, end});
+                    pos = end;
                 }
-            });
+                else
+                {
+                    pos = NextChar(text, end);
+                }
+            }
+        }
+
+        std::stable_sort(matches.begin(), matches.end(), [](const Match& a, const Match& b)
+                         { return a.begin < b.begin; });
+        return matches;
+    }
+
+    ::MetadataExtractor::Document MetadataRegexExtractor::ProcessDocument(::MetadataExtractor::Document doc)
+    {
+        const auto compiled = Snapshot();
+        for (size_t p = 0; p < doc.pageContent.size(); ++p)
+        {
+            const auto& page = doc.pageContent[p];
+            for (auto& match : FindMatches(*compiled, page))
+            {
+                doc.metadata.emplace_back(page.substr(match.begin, match.end - match.begin), match.name);
+                doc.spans.push_back({std::move(match.name), p, match.begin, match.end});
+            }
         }
         return doc;
     }
-    
 
-}
\ No newline at end of file
+}
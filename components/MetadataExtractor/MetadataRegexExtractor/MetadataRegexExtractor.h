@@ -3,27 +3,64 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
 
 #include "../MetadataExtractor.h"
 #include "IMetadataRegexExtractor.h"
 
 #include "../Document.h"
 #include "re2/re2.h"
+#include "re2/set.h"
 
 namespace MetadataRegexExtractor
 {
     using RE2Ptr = std::shared_ptr<RE2>;
+
+    // Finds the spans of every registered pattern inside each page. A single
+    // RE2::Set scan tells which patterns occur in a page at all; only those
+    // are then searched for their match offsets.
     class MetadataRegexExtractor : public ::MetadataExtractor::MetadataExtractor, public IMetadataRegexExtractor
     {
     public:
+        // Match of pattern `name` at bytes [begin, end) of the searched text.
+        struct Match
+        {
+            std::string name;
+            size_t begin;
+            size_t end;
+        };
+
         MetadataRegexExtractor();
         ~MetadataRegexExtractor() override = default;
 
+        // Replaces any pattern registered under `name`; throws RagException
+        // if `pattern` does not compile.
         void AddPattern(const std::string& name, const std::string& pattern) override;
+        // Matches in `text`, ordered by offset, then by pattern name.
+        std::vector<Match> FindMatches(std::string_view text) const;
+        // Appends a (matched text, pattern name) pair per match of each page,
+        // and its page and byte offsets to `spans`.
         ::MetadataExtractor::Document ProcessDocument(::MetadataExtractor::Document doc) override;
 
     private:
+        // Immutable snapshot of the patterns; AddPattern swaps in a new one so
+        // documents already being processed keep a consistent set.
+        struct Compiled
+        {
+            std::vector<std::string> names;
+            std::vector<RE2Ptr> regexes;
+            std::unique_ptr<RE2::Set> set;
+        };
+
         std::map<std::string, RE2Ptr> m_patterns;
+        std::shared_ptr<const Compiled> m_compiled;
+        mutable std::mutex m_mutex;
+
+        static std::shared_ptr<const Compiled> Compile(const std::map<std::string, RE2Ptr>& patterns);
+        std::shared_ptr<const Compiled> Snapshot() const;
+        static std::vector<Match> FindMatches(const Compiled& compiled, std::string_view text);
     };
 }
 #endif
@@ -0,0 +1,247 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vdb {
+
+/**
+ * Bitmap
+ * ------
+ * Compressed set of 32-bit ids in the roaring layout: ids are grouped by
+ * their high 16 bits and each group is a sorted array of the low halves
+ * while it holds at most 4096 of them, or a 65536-bit bitset beyond that.
+ * Sequential ids (the usual label order) append in O(1).
+ */
+class Bitmap {
+    static constexpr std::uint32_t kArrayMax = 4096;
+    static constexpr std::size_t   kWords    = 65536 / 64;
+
+    struct Container {
+        std::vector<std::uint16_t> array;   // sorted, while sparse
+        std::vector<std::uint64_t> bits;    // kWords words, once dense
+        std::uint32_t              card = 0;
+
+        bool dense() const noexcept { return !bits.empty(); }
+
+        bool contains(std::uint16_t v) const noexcept {
+            if (dense()) return (bits[v >> 6] >> (v & 63)) & 1u;
+            return std::binary_search(array.begin(), array.end(), v);
+        }
+
+        void add(std::uint16_t v) {
+            if (dense()) {
+                std::uint64_t& w = bits[v >> 6];
+                const std::uint64_t m = std::uint64_t(1) << (v & 63);
+                if (!(w & m)) { w |= m; ++card; }
+                return;
+            }
+            if (array.empty() || array.back() < v) {
+                array.push_back(v);
+            } else {
+                auto it = std::lower_bound(array.begin(), array.end(), v);
+                if (*it == v) return;
+                array.insert(it, v);
+            }
+            if (++card > kArrayMax) to_dense();
+        }
+
+        void remove(std::uint16_t v) {
+            if (dense()) {
+                std::uint64_t& w = bits[v >> 6];
+                const std::uint64_t m = std::uint64_t(1) << (v & 63);
+                if (w & m) { w &= ~m; --card; }
+                if (card <= kArrayMax / 2) to_array();
+                return;
+            }
+            auto it = std::lower_bound(array.begin(), array.end(), v);
+            if (it != array.end() && *it == v) { array.erase(it); --card; }
+        }
+
+        void to_dense() {
+            bits.assign(kWords, 0);
+            for (std::uint16_t v : array) bits[v >> 6] |= std::uint64_t(1) << (v & 63);
+            std::vector<std::uint16_t>().swap(array);
+        }
+
+        void to_array() {
+            array.clear();
+            array.reserve(card);
+            for (std::size_t w = 0; w < kWords; ++w)
+                for (std::uint64_t x = bits[w]; x; x &= x - 1)
+                    array.push_back(std::uint16_t(w * 64 + std::countr_zero(x)));
+            std::vector<std::uint64_t>().swap(bits);
+        }
+
+        template <class F>
+        void for_each(std::uint32_t high, F&& f) const {
+            if (!dense()) {
+                for (std::uint16_t v : array) f(high | v);
+                return;
+            }
+            for (std::size_t w = 0; w < kWords; ++w)
+                for (std::uint64_t x = bits[w]; x; x &= x - 1)
+                    f(high | std::uint32_t(w * 64 + std::countr_zero(x)));
+        }
+
+        static Container intersect(const Container& a, const Container& b) {
+            Container out;
+            if (a.dense() && b.dense()) {
+                out.bits.resize(kWords);
+                for (std::size_t w = 0; w < kWords; ++w) {
+                    out.bits[w] = a.bits[w] & b.bits[w];
+                    out.card += std::uint32_t(std::popcount(out.bits[w]));
+                }
+                if (out.card <= kArrayMax) out.to_array();
+                return out;
+            }
+            if (a.dense() || b.dense()) {
+                const Container& sparse = a.dense() ? b : a;
+                const Container& full   = a.dense() ? a : b;
+                for (std::uint16_t v : sparse.array)
+                    if (full.contains(v)) out.array.push_back(v);
+            } else {
+                std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                      std::back_inserter(out.array));
+            }
+            out.card = std::uint32_t(out.array.size());
+            return out;
+        }
+    };
+
+public:
+    void add(std::uint32_t id) {
+        const std::uint16_t key = std::uint16_t(id >> 16);
+        if (chunks_.empty() || chunks_.back().first < key) {
+            chunks_.emplace_back(key, Container{});
+            chunks_.back().second.add(std::uint16_t(id));
+            return;
+        }
+        auto it = find(key);
+        if (it == chunks_.end() || it->first != key)
+            it = chunks_.emplace(it, key, Container{});
+        it->second.add(std::uint16_t(id));
+    }
+
+    void remove(std::uint32_t id) {
+        auto it = find(std::uint16_t(id >> 16));
+        if (it == chunks_.end() || it->first != std::uint16_t(id >> 16)) return;
+        it->second.remove(std::uint16_t(id));
+        if (it->second.card == 0) chunks_.erase(it);
+    }
+
+    bool contains(std::uint32_t id) const noexcept {
+        const std::uint16_t key = std::uint16_t(id >> 16);
+        auto it = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                                   [](const auto& c, std::uint16_t k) { return c.first < k; });
+        return it != chunks_.end() && it->first == key && it->second.contains(std::uint16_t(id));
+    }
+
+    std::size_t cardinality() const noexcept {
+        std::size_t n = 0;
+        for (const auto& [key, c] : chunks_) n += c.card;
+        return n;
+    }
+
+    bool empty() const noexcept { return chunks_.empty(); }
+
+    // Calls f(id) for every member in increasing order.
+    template <class F>
+    void for_each(F&& f) const {
+        for (const auto& [key, c] : chunks_) c.for_each(std::uint32_t(key) << 16, f);
+    }
+
+    std::vector<std::uint32_t> to_vector() const {
+        std::vector<std::uint32_t> out;
+        out.reserve(cardinality());
+        for_each([&](std::uint32_t id) { out.push_back(id); });
+        return out;
+    }
+
+    static Bitmap intersect(const Bitmap& a, const Bitmap& b) {
+        Bitmap out;
+        auto i = a.chunks_.begin();
+        auto j = b.chunks_.begin();
+        while (i != a.chunks_.end() && j != b.chunks_.end()) {
+            if (i->first < j->first) { ++i; continue; }
+            if (j->first < i->first) { ++j; continue; }
+            Container c = Container::intersect(i->second, j->second);
+            if (c.card) out.chunks_.emplace_back(i->first, std::move(c));
+            ++i;
+            ++j;
+        }
+        return out;
+    }
+
+private:
+    using Chunks = std::vector<std::pair<std::uint16_t, Container>>;
+    Chunks chunks_;   // sorted by key
+
+    Chunks::iterator find(std::uint16_t key) {
+        return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                                [](const auto& c, std::uint16_t k) { return c.first < k; });
+    }
+};
+
+/**
+ * AttributeIndex
+ * --------------
+ * Inverted index from metadata "key = value" pairs to the ids carrying them,
+ * so a filter resolves to the exact set of admissible ids before any vector
+ * is scored. Not synchronized: owners guard it with their own locks.
+ */
+class AttributeIndex {
+public:
+    template <class Map>
+    void add(std::uint32_t id, const Map& metadata) {
+        for (const auto& [key, value] : metadata) postings_[term(key, value)].add(id);
+    }
+
+    template <class Map>
+    void remove(std::uint32_t id, const Map& metadata) {
+        for (const auto& [key, value] : metadata) {
+            auto it = postings_.find(term(key, value));
+            if (it == postings_.end()) continue;
+            it->second.remove(id);
+            if (it->second.empty()) postings_.erase(it);
+        }
+    }
+
+    void clear() { postings_.clear(); }
+
+    // Ids carrying every pair of `filter`, intersected from the rarest term up.
+    Bitmap match(const std::unordered_map<std::string, std::string>& filter) const {
+        std::vector<const Bitmap*> lists;
+        lists.reserve(filter.size());
+        for (const auto& [key, value] : filter) {
+            auto it = postings_.find(term(key, value));
+            if (it == postings_.end()) return {};
+            lists.push_back(&it->second);
+        }
+        if (lists.empty()) return {};
+        std::sort(lists.begin(), lists.end(), [](const Bitmap* a, const Bitmap* b) {
+            return a->cardinality() < b->cardinality();
+        });
+        Bitmap out = *lists.front();
+        for (std::size_t i = 1; i < lists.size() && !out.empty(); ++i)
+            out = Bitmap::intersect(out, *lists[i]);
+        return out;
+    }
+
+private:
+    std::unordered_map<std::string, Bitmap> postings_;
+
+    static std::string term(const std::string& key, const std::string& value) {
+        std::string t;
+        t.reserve(key.size() + 1 + value.size());
+        t.append(key).push_back('\x1f');
+        t.append(value);
+        return t;
+    }
+};
+
+} // namespace vdb
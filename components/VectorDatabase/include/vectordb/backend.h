@@ -2,9 +2,11 @@
 #include <cstdint>
 #include <memory>
 #include <span>
+#include <string>
 #include <vector>
 
 #include "CommonStructs.h"
+#include "vectordb/exceptions.h"
 
 namespace vdb {
 
@@ -23,9 +25,24 @@ public:
            query(std::span<const float> embedding, std::size_t k,
                  const std::unordered_map<std::string,std::string>* filter=nullptr) = 0;
 
-    
+    // Optional capabilities; backends without local storage keep the defaults.
+    // Documents are identified by their "id" metadata entry.
+    virtual std::size_t erase(const std::vector<std::string>& ids) {
+        (void)ids;
+        throw NotSupported("erase is not supported by this backend");
+    }
+    virtual void save(const std::string& path) {
+        (void)path;
+        throw NotSupported("save is not supported by this backend");
+    }
+
     virtual void close() {}
 protected:
+    // "id" given to a document inserted without one. The prefix keeps these
+    // apart from caller ids, so an id-less document at label 5 never
+    // replaces or tombstones the caller's document "5", nor the reverse.
+    static std::string auto_id(std::uint64_t label) { return "__auto:" + std::to_string(label); }
+
     std::uint32_t dim_;
 };
 
@@ -0,0 +1,27 @@
+#pragma once
+#include "vectordb/exceptions.h"
+
+#include <string>
+
+namespace vdb {
+
+// Distance of the in-process backends (cfg "metric"); scores are distances,
+// lower is closer: 1 - cos for COSINE, 1 - dot for IP and squared L2 for L2.
+enum class Metric { Cosine, L2, IP };
+
+inline Metric parse_metric(const std::string& name, const std::string& backend) {
+    if (name == "COSINE") return Metric::Cosine;
+    if (name == "L2")     return Metric::L2;
+    if (name == "IP")     return Metric::IP;
+    throw InvalidConfiguration(backend + ": unknown metric '" + name + "'");
+}
+
+inline const char* metric_name(Metric metric) {
+    switch (metric) {
+        case Metric::L2: return "L2";
+        case Metric::IP: return "IP";
+        default:         return "COSINE";
+    }
+}
+
+} // namespace vdb
@@ -8,4 +8,5 @@ struct BackendClosed       : VStoreError { using VStoreError::VStoreError; };
 struct DimensionMismatch   : VStoreError { using VStoreError::VStoreError; };
 struct QueryError          : VStoreError { using VStoreError::VStoreError; };
 struct InsertionError      : VStoreError { using VStoreError::VStoreError; };
+struct NotSupported        : VStoreError { using VStoreError::VStoreError; };
 } // namespace vdb
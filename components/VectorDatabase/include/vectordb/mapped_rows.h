@@ -0,0 +1,81 @@
+#pragma once
+#include "vectordb/exceptions.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "MappedFile.h"
+
+namespace vdb {
+
+// Full-precision rows of `dim` floats kept in a file and read through a
+// read-only mapping. The file is grown geometrically ahead of the rows, so
+// the mapping is only replaced when that spare capacity runs out rather than
+// on every append; close() cuts the padding off again.
+// Not synchronised: callers hold their backend lock exclusively for
+// open / append / close and at least shared for row().
+class MappedRows {
+public:
+    // Opens `path`, creating it when missing; every whole row in the file
+    // counts as stored.
+    void open(const std::string& path, std::size_t dim) {
+        path_      = path;
+        row_bytes_ = dim * sizeof(float);
+        if (!std::filesystem::exists(path_))
+            std::ofstream(path_, std::ios::binary | std::ios::trunc);
+        rows_ = capacity_ = std::filesystem::file_size(path_) / row_bytes_;
+        map();
+    }
+
+    bool is_open() const noexcept { return !path_.empty(); }
+    std::size_t rows() const noexcept { return rows_; }
+
+    const float* row(std::size_t i) const noexcept {
+        return reinterpret_cast<const float*>(file_.Data()) + i * (row_bytes_ / sizeof(float));
+    }
+
+    void append(const float* x, std::size_t n) {
+        if (n == 0) return;
+        if (rows_ + n > capacity_) {
+            const std::size_t capacity = std::max({rows_ + n, 2 * capacity_, kMinRows});
+            file_.Close();
+            std::filesystem::resize_file(path_, capacity * row_bytes_);
+            capacity_ = capacity;
+            map();
+        }
+        std::fstream out(path_, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(std::streamoff(rows_ * row_bytes_));
+        out.write(reinterpret_cast<const char*>(x), std::streamsize(n * row_bytes_));
+        if (!out) throw InsertionError("vectordb: cannot append to '" + path_ + "'");
+        rows_ += n;
+    }
+
+    // Unmaps and trims the file to the stored rows.
+    void close() {
+        if (path_.empty()) return;
+        file_.Close();
+        if (capacity_ != rows_) std::filesystem::resize_file(path_, rows_ * row_bytes_);
+        path_.clear();
+        rows_ = capacity_ = 0;
+    }
+
+private:
+    static constexpr std::size_t kMinRows = 1024;
+
+    std::string            path_;
+    std::size_t            row_bytes_ = 0;
+    std::size_t            rows_      = 0;
+    std::size_t            capacity_  = 0;
+    RAGLibrary::MappedFile file_;
+
+    void map() {
+        if (capacity_ == 0) return;
+        file_.Open(path_);
+        file_.AdviseRandom();
+    }
+};
+
+} // namespace vdb
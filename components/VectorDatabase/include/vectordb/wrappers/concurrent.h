@@ -4,14 +4,17 @@
  * -----------------------
  * A thin, thread-pool façade around any VectorBackend.
  *
- *  • Inserts are serialised (they mutate state).
- *  • Queries can run in parallel as long as the wrapped backend
- *    is thread-safe for `query()`; otherwise we serialise them too.
- *
- * Build-only dependency: <future> / <thread> (no Boost/TBB needed).
+ *  • Inserts, erases, saves and close take the lock exclusively.
+ *  • Queries share it as long as the wrapped backend is thread-safe for
+ *    `query()`; otherwise they take it exclusively too.
+ *  • `query_many` and `query_async` run on a fixed pool of `maxWorkers`
+ *    threads; batches are scheduled in chunks, not one task per query.
  */
+#include <exception>
+#include <functional>
 #include <future>
-#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <span>
 #include <thread>
 #include <unordered_map>
@@ -19,19 +22,24 @@
 
 #include "vectordb/backend.h"
 #include "CommonStructs.h"
+#include "ThreadPool.h"
 
 
 namespace vdb::wrappers {
 
 class ConcurrentSearchWrapper final : public VectorBackend {
 public:
+    /** `maxWorkers` value for one pool thread per hardware thread. */
+    static constexpr std::size_t auto_workers = static_cast<std::size_t>(-1);
+
     /** 
      * @param backend          Ownership is transferred (unique_ptr)
-     * @param maxWorkers       #threads in the internal pool (0 → hw concurrency)
+     * @param maxWorkers       #threads in the internal pool (0 → a single
+     *                         thread, auto_workers → hw concurrency)
      * @param backendThreadSafe If false we serialise every call to query()
      */
     explicit ConcurrentSearchWrapper(VectorBackendPtr backend,
-                                     std::size_t      maxWorkers        = std::thread::hardware_concurrency(),
+                                     std::size_t      maxWorkers        = auto_workers,
                                      bool             backendThreadSafe = true);
 
     ~ConcurrentSearchWrapper() override;
@@ -50,13 +58,35 @@ public:
                const std::unordered_map<std::string, std::string>* filter    = nullptr,
                bool                                              raiseOnErr = false);
 
+    using Filter   = std::unordered_map<std::string, std::string>;
+    using Callback = std::function<void(std::vector<QueryResult>, std::exception_ptr)>;
+
+    /** Queues one query on the pool; the embedding and filter are owned by the task. */
+    std::future<std::vector<QueryResult>>
+    query_async(std::vector<float>    embedding,
+                std::size_t           k      = 5,
+                std::optional<Filter> filter = std::nullopt);
+
+    /** As above, but hands the results (or the exception) to `done` on a pool thread. */
+    void query_async(std::vector<float>    embedding,
+                     std::size_t           k,
+                     std::optional<Filter> filter,
+                     Callback              done);
+
+    std::size_t erase(const std::vector<std::string>& ids) override;
+    void save(const std::string& path) override;
+
     void close() override;
 
 private:
-    VectorBackendPtr backend_;
-    std::size_t      workers_;
-    bool             backendThreadSafe_;
-    std::mutex       mtx_;        // protects non-thread-safe back-ends
+    std::vector<QueryResult> query_locked(std::span<const float> emb, std::size_t k,
+                                          const Filter* filter);
+
+    VectorBackendPtr        backend_;
+    std::size_t             workers_;
+    bool                    backendThreadSafe_;
+    std::shared_mutex       mtx_;
+    RAGLibrary::ThreadPool  pool_;   // last: joined before the backend and lock go away
 };
 
 }  // namespace vdb::wrappers
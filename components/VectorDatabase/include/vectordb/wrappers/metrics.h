@@ -3,16 +3,23 @@
  * MetricsWrapper
  * --------------
  * Collects usage statistics (count, errors, latency) for any
- * `VectorBackend`. Fully thread-safe.
+ * `VectorBackend`. Fully thread-safe and lock-free on the call path.
  *
- *  • Does not add external dependencies – only uses the STL.
- *  • Expose metrics via `snapshot()` (C++ map) or
- *    `snapshot_json()` (JSON string using nlohmann/json).
- *  • If you want Prometheus support, it's easy to plug in later (see TODO in .cpp).
+ *  • Every thread records into one of `kShards` cache-line aligned shards
+ *    with relaxed atomic adds; shards are only summed when read.
+ *  • Latencies go into a log-linear histogram (16 sub-buckets per power
+ *    of two of nanoseconds, ≤ 6.25 % bucket width), so tail percentiles
+ *    are available, not only min/avg/max.
+ *  • Expose metrics via `snapshot()` (C++ map), `snapshot_json()` or
+ *    `prometheus()` (text exposition format, metric names prefixed with
+ *    the wrapper's namespace).
  */
 
-#include <chrono>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -22,14 +29,28 @@
 
 namespace vdb::wrappers {
 
+enum class Method : std::uint8_t { Insert, Query, Erase, Save, Close, Count };
+
+const char* method_name(Method m) noexcept;
+
+/** Aggregated view of one method; times are in seconds. */
 struct CallStats {
+    static constexpr std::size_t kSubBuckets = 16;
+    static constexpr std::size_t kBuckets    = 41 * kSubBuckets;   // up to 2^44 ns
+
     std::uint64_t calls   = 0;
     std::uint64_t errors  = 0;
-    double        total   = 0.0;         
+    double        total   = 0.0;
     double        min_t   = std::numeric_limits<double>::infinity();
     double        max_t   = 0.0;
+    std::vector<std::uint64_t> buckets;   // kBuckets counts, see bucket_of()
 
-    void observe(double elapsed, bool ok) noexcept;
+    /** Latency at quantile q in [0, 1], interpolated within its bucket. */
+    double quantile(double q) const noexcept;
+
+    static std::size_t   bucket_of(std::uint64_t ns) noexcept;
+    static std::uint64_t bucket_lower(std::size_t b) noexcept;   // in ns
+    static std::uint64_t bucket_upper(std::size_t b) noexcept;   // exclusive, in ns
 };
 
 
@@ -45,23 +66,42 @@ public:
           std::size_t                         k,
           const std::unordered_map<std::string,std::string>* filter = nullptr) override;
 
+    std::size_t erase(const std::vector<std::string>& ids) override;
+    void save(const std::string& path) override;
+
     void close() override;
 
+    /** Keyed by method name; methods never called are omitted. */
     [[nodiscard]]
     std::unordered_map<std::string, CallStats> snapshot() const;
 
     [[nodiscard]] std::string snapshot_json(int indent = 2) const;
 
+    [[nodiscard]] std::string prometheus() const;
+
     void reset();
 
 private:
+    static constexpr std::size_t kShards  = 8;
+    static constexpr std::size_t kMethods = std::size_t(Method::Count);
+
+    struct alignas(64) Counters {
+        std::atomic<std::uint64_t> calls{0}, errors{0}, total_ns{0};
+        std::atomic<std::uint64_t> min_ns{std::numeric_limits<std::uint64_t>::max()}, max_ns{0};
+        std::array<std::atomic<std::uint64_t>, CallStats::kBuckets> buckets{};
+
+        void observe(std::uint64_t ns, bool ok) noexcept;
+    };
+    struct Shard { std::array<Counters, kMethods> methods; };
+
     template<typename F, typename... Args>
-    auto measure(const std::string& method, F&& fn, Args&&... args);
+    auto measure(Method method, F&& fn, Args&&... args);
+
+    CallStats collect(Method m) const;
 
     VectorBackendPtr                                       backend_;
-    mutable std::mutex                                     mtx_;
-    std::unordered_map<std::string, CallStats>             stats_;
-    const std::string                                      ns_;     
+    std::unique_ptr<Shard[]>                               shards_;
+    const std::string                                      ns_;
 };
 
 }  // namespace vdb::wrappers
@@ -8,20 +8,36 @@
 #include "vectordb/backend.h"
 #include "vectordb/registry.h"
 
-#include <cstring>
+#include <span>
 
 namespace py = pybind11;
 using namespace vdb;
 
-static std::vector<float> to_vecf(const py::handle& obj) {
+// Float32 view of a 1-D embedding. NumPy arrays are read in place and must
+// already be contiguous float32 (no silent casts); other sequences are
+// converted into `owned`.
+struct EmbeddingArg {
+    py::array              array;
+    std::vector<float>     owned;
+    std::span<const float> view;
+};
+
+static EmbeddingArg to_embedding(const py::handle& obj) {
+    EmbeddingArg e;
     if (py::isinstance<py::array>(obj)) {
-        py::array arr = py::cast<py::array>(obj);
-        if (arr.ndim() != 1) throw std::runtime_error("The embedding should be 1D.");
-        std::vector<float> v(arr.size());
-        std::memcpy(v.data(), arr.data(), arr.size() * sizeof(float));
-        return v;
+        e.array = py::reinterpret_borrow<py::array>(obj);
+        if (e.array.ndim() != 1)
+            throw py::value_error("The embedding should be 1D.");
+        if (!e.array.dtype().is(py::dtype::of<float>()))
+            throw py::type_error("The embedding should be float32, got " + std::string(py::str(e.array.dtype())) + ".");
+        if (!(e.array.flags() & py::array::c_style))
+            throw py::value_error("The embedding should be C-contiguous.");
+        e.view = {static_cast<const float*>(e.array.data()), static_cast<std::size_t>(e.array.size())};
+        return e;
     }
-    return py::cast<std::vector<float>>(obj);
+    e.owned = py::cast<std::vector<float>>(obj);
+    e.view  = e.owned;
+    return e;
 }
 
 PYBIND11_MODULE(vectordb, m) {
@@ -49,6 +65,14 @@ PYBIND11_MODULE(vectordb, m) {
     py::class_<QueryResult>(m, "QueryResult")
         .def_readonly("doc",   &QueryResult::doc)    
         .def_readonly("score", &QueryResult::score)
+        .def_property_readonly("embedding", [](py::object self) -> py::object {
+            // Read-only view kept alive by the result, instead of a list copy.
+            const auto& r = self.cast<const QueryResult&>();
+            if (!r.doc.embedding) return py::none();
+            py::array_t<float> a(r.doc.embedding->size(), r.doc.embedding->data(), self);
+            a.attr("setflags")(false);
+            return a;
+        }, "The stored embedding as a float32 numpy view, or None.")
         .def("__repr__", [](const QueryResult& r){
             return "<QueryResult score=" + std::to_string(r.score) + ">";
         });
@@ -62,13 +86,14 @@ PYBIND11_MODULE(vectordb, m) {
             } else {
                 docs.push_back(py::cast<Document>(py_docs));
             }
+            py::gil_scoped_release release;
             self.insert(docs);
         }, py::arg("docs"), "Inserts one or a list of Documents..")
         .def("query", [](VectorBackend& self,
                          py::object embedding,
                          std::size_t k,
                          py::object filt_obj){
-            auto emb = to_vecf(embedding);
+            auto emb = to_embedding(embedding);
 
             std::unordered_map<std::string,std::string> filt;
             const std::unordered_map<std::string,std::string>* pf = nullptr;
@@ -76,9 +101,16 @@ PYBIND11_MODULE(vectordb, m) {
                 filt = py::cast<std::unordered_map<std::string,std::string>>(filt_obj);
                 pf = &filt;
             }
-            return self.query(emb, k, pf);
+            py::gil_scoped_release release;
+            return self.query(emb.view, k, pf);
         }, py::arg("embedding"), py::arg("k") = 5, py::arg("filter") = py::none(),
            "Executes a KNN search and returns a list of QueryResult.")
+        .def("erase", &VectorBackend::erase, py::arg("ids"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Deletes documents by their \"id\" metadata; returns how many were removed.")
+        .def("save", &VectorBackend::save, py::arg("path") = "",
+             py::call_guard<py::gil_scoped_release>(),
+             "Persists the index (backends with local storage only).")
         .def("is_open", &VectorBackend::is_open)
         .def("close",   &VectorBackend::close)
         .def("__repr__", [](const VectorBackend&){
@@ -88,6 +120,7 @@ PYBIND11_MODULE(vectordb, m) {
     m.def("make_backend",
           [](const std::string& name, const std::string& json_cfg){
               auto cfg = nlohmann::json::parse(json_cfg);
+              py::gil_scoped_release release;   // loading a saved index can take a while
               return Registry::instance().make(name, cfg);
           },
           py::arg("name"), py::arg("json_cfg"),
@@ -0,0 +1,416 @@
+// components/VectorDatabase/src/backends/binary_backend.cpp
+#include "vectordb/attribute_index.h"
+#include "vectordb/backend.h"
+#include "vectordb/distance.h"
+#include "vectordb/mapped_rows.h"
+#include "vectordb/registry.h"
+#include "vectordb/exceptions.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CommonStructs.h"
+#include "Tracing.h"
+#include "Quantize.h"
+#include "TopK.h"
+#include "VectorUtils.h"
+
+namespace vdb {
+
+/**
+ * BinaryVectorBackend
+ * -------------------
+ * Brute-force first stage over 1-bit sign codes (dim / 8 bytes per vector).
+ *
+ *  • Codes are the signs of each vector minus the mean of the first inserted
+ *    batch, which is frozen from then on (and persisted).
+ *  • A query is binarized the same way and every stored code is scored by
+ *    Hamming distance with a popcount kernel, in parallel for large stores.
+ *  • The `candidates * k` closest codes are re-ranked exactly against the
+ *    full-precision rows: in memory, or memory-mapped from "<path>.vectors"
+ *    when cfg "path" is set, so only the codes need to stay resident.
+ *  • Deletes are tombstones; re-inserting an existing "id" replaces it.
+ *    Documents without one get "__auto:<label>".
+ *  • Filters resolve through an inverted attribute index. When at most
+ *    cfg "prefilter_ratio" of the documents match, those rows are scored
+ *    exactly and the Hamming pass is skipped.
+ *
+ * Sign codes only capture direction, so the prefilter suits COSINE and IP;
+ * with L2 it ranks by angle and relies on the re-rank depth.
+ * Scores are distances: 1 - cos for COSINE, 1 - dot for IP, squared L2 for L2.
+ */
+class BinaryVectorBackend final : public VectorBackend {
+    using label_t = std::uint32_t;
+
+    static constexpr std::size_t kParallelMin = 16384;   // rows below which the scan stays serial
+    static constexpr char kMagic[8] = {'P', 'C', 'B', 'I', 'N', 'V', '0', '1'};
+
+public:
+    explicit BinaryVectorBackend(const nlohmann::json& cfg)
+        : VectorBackend(cfg.at("dim").get<std::uint32_t>())
+        , metric_(parse_metric(cfg.value("metric", "COSINE"), "binary"))   // "COSINE" | "L2" | "IP"
+        , candidates_(cfg.value("candidates", 10))
+        , prefilter_ratio_(cfg.value("prefilter_ratio", 0.02))
+        , path_(cfg.value("path", ""))
+        , words_(VectorUtils::binary_words(dim_))
+    {
+        if (candidates_ == 0)
+            throw InvalidConfiguration("binary: candidates must be >= 1");
+        if (prefilter_ratio_ < 0.0 || prefilter_ratio_ > 1.0)
+            throw InvalidConfiguration("binary: prefilter_ratio must be in [0, 1]");
+
+        if (!path_.empty()) {
+            vec_path_ = path_ + ".vectors";
+            if (std::filesystem::exists(path_)) {
+                load(path_);
+            } else {
+                std::ofstream(vec_path_, std::ios::binary | std::ios::trunc);
+            }
+            vecs_.open(vec_path_, dim_);
+        }
+    }
+
+    ~BinaryVectorBackend() override = default;
+
+    bool is_open() const noexcept override { return open_.load(); }
+
+    void insert(std::span<const RAGLibrary::Document> docs) override {
+        Tracing::Span span("binary::insert", "vdb");
+        span.SetItems(std::int64_t(docs.size()));
+        if (!is_open()) throw BackendClosed("Binary backend closed");
+
+        for (const auto& d : docs) {
+            if (!d.embedding.has_value())
+                throw InsertionError("Document missing embedding data");
+            if (d.dim() != dim_)
+                throw DimensionMismatch("Dimension mismatch on insert");
+        }
+        if (docs.empty()) return;
+
+        std::vector<float> batch(docs.size() * dim_);
+        for (std::size_t i = 0; i < docs.size(); ++i) {
+            float* row = batch.data() + i * dim_;
+            std::copy(docs[i].embedding->begin(), docs[i].embedding->end(), row);
+            prepare(row);
+        }
+
+        std::unique_lock lk(rw_);
+        if (center_.empty()) {
+            center_.assign(dim_, 0.0f);
+            for (std::size_t i = 0; i < docs.size(); ++i)
+                for (std::size_t t = 0; t < dim_; ++t) center_[t] += batch[i * dim_ + t];
+            for (auto& c : center_) c /= float(docs.size());
+        }
+        std::vector<std::uint64_t> codes(docs.size() * words_);
+        #pragma omp parallel for schedule(static) if (docs.size() > 1024)
+        for (std::int64_t i = 0; i < std::int64_t(docs.size()); ++i) {
+            VectorUtils::binarize(batch.data() + std::size_t(i) * dim_, dim_,
+                                  codes.data() + std::size_t(i) * words_, center_.data());
+        }
+
+        for (const auto& d : docs)
+            add_document(d);
+        codes_.insert(codes_.end(), codes.begin(), codes.end());
+
+        if (vec_path_.empty())
+            vectors_.insert(vectors_.end(), batch.begin(), batch.end());
+        else
+            vecs_.append(batch.data(), docs.size());
+    }
+
+    std::vector<QueryResult>
+    query(std::span<const float> embedding,
+          std::size_t k,
+          const std::unordered_map<std::string, std::string>* filter) override {
+        Tracing::Span span("binary::query", "vdb");
+        if (!is_open()) throw BackendClosed("Binary backend closed");
+        if (embedding.size() != dim_)
+            throw DimensionMismatch("Dimension mismatch on query");
+
+        std::vector<float> q(embedding.begin(), embedding.end());
+        prepare(q.data());
+
+        std::shared_lock lk(rw_);
+        std::vector<QueryResult> out;
+        const std::size_t n = docs_.size();
+        if (k == 0 || n == 0) return out;
+
+        std::optional<Bitmap> allowed;
+        if (filter && !filter->empty()) {
+            allowed = attrs_.match(*filter);
+            if (allowed->empty()) return out;
+        }
+        const Bitmap* mask = allowed ? &*allowed : nullptr;
+
+        const std::size_t depth = k <= std::numeric_limits<std::size_t>::max() / candidates_ ? k * candidates_ : k;
+        std::vector<std::pair<label_t, float>> cand;
+        if (allowed && double(allowed->cardinality()) <= std::max(double(depth), prefilter_ratio_ * double(id_to_label_.size()))) {
+            // Few enough matches to score them all exactly.
+            VectorUtils::TopK<label_t> exact(k);
+            allowed->for_each([&](label_t l) {
+                if (deleted_[l]) return;
+                const float score = -distance(q.data(), row(l));
+                if (score > exact.threshold()) exact.push(l, score);
+            });
+            cand = exact.sorted();
+        } else {
+            std::vector<std::uint64_t> code(words_);
+            VectorUtils::binarize(q.data(), dim_, code.data(), center_.data());
+
+            // Ranked by negated Hamming distance so TopK keeps the closest codes.
+            VectorUtils::TopK<label_t> best(depth);
+            #pragma omp parallel if (n >= kParallelMin)
+            {
+                VectorUtils::TopK<label_t> local(depth);
+                #pragma omp for nowait schedule(static)
+                for (std::int64_t i = 0; i < std::int64_t(n); ++i) {
+                    const float score = -float(VectorUtils::hamming(code.data(), codes_.data() + std::size_t(i) * words_, words_));
+                    if (score > local.threshold() && admissible(label_t(i), mask))
+                        local.push(label_t(i), score);
+                }
+                #pragma omp critical
+                best.merge(local);
+            }
+
+            cand = best.sorted();
+            for (auto& [l, score] : cand)
+                score = -distance(q.data(), row(l));
+            std::sort(cand.begin(), cand.end(), [](const auto& a, const auto& b) {
+                return a.second > b.second || (a.second == b.second && a.first < b.first);
+            });
+            if (cand.size() > k) cand.resize(k);
+        }
+
+        out.reserve(cand.size());
+        for (const auto& [l, score] : cand) {
+            RAGLibrary::Document doc = docs_[l];
+            doc.embedding = std::vector<float>(row(l), row(l) + dim_);
+            out.push_back(QueryResult{std::move(doc), -score});
+        }
+        return out;
+    }
+
+    std::size_t erase(const std::vector<std::string>& ids) override {
+        if (!is_open()) throw BackendClosed("Binary backend closed");
+        std::unique_lock lk(rw_);
+        std::size_t erased = 0;
+        for (const auto& id : ids) {
+            auto it = id_to_label_.find(id);
+            if (it == id_to_label_.end()) continue;
+            deleted_[it->second] = 1;
+            attrs_.remove(it->second, docs_[it->second].metadata);
+            id_to_label_.erase(it);
+            ++erased;
+        }
+        return erased;
+    }
+
+    void save(const std::string& path) override {
+        if (!is_open()) throw BackendClosed("Binary backend closed");
+        std::lock_guard save_lk(save_mtx_);
+        std::shared_lock lk(rw_);
+        write_file(path.empty() ? path_ : path);
+    }
+
+    void close() override {
+        if (!open_.exchange(false)) return;
+        std::lock_guard save_lk(save_mtx_);
+        std::unique_lock lk(rw_);
+        if (!path_.empty()) write_file(path_);
+        vecs_.close();
+    }
+
+private:
+    // ---- configuration ---------------------------------------------------
+    Metric      metric_;
+    std::size_t candidates_;
+    double      prefilter_ratio_;
+    std::string path_, vec_path_;
+    std::size_t words_;
+    std::atomic_bool open_{true};
+
+    // Writers (insert / erase / close) are exclusive, queries shared.
+    mutable std::shared_mutex rw_;
+    // Serialises save / close, which share the "<path>.tmp" file; taken
+    // before rw_.
+    std::mutex save_mtx_;
+
+    // ---- storage (indexed by label) ----------------------------------------
+    std::vector<float>                       center_;    // dim, empty until the first insert
+    std::vector<std::uint64_t>               codes_;     // n x words_
+    std::vector<float>                       vectors_;   // n x dim, only without cfg "path"
+    MappedRows                               vecs_;      // n x dim, with cfg "path"
+    std::vector<RAGLibrary::Document>        docs_;      // page + metadata only
+    std::vector<std::uint8_t>                deleted_;
+    std::unordered_map<std::string, label_t> id_to_label_;
+    AttributeIndex                           attrs_;     // live documents only
+
+    // ---- helpers -------------------------------------------------------------
+    void prepare(float* v) const {
+        if (metric_ != Metric::Cosine) return;
+        const float n = VectorUtils::norm(v, dim_);
+        if (n > 0.0f)
+            for (std::size_t i = 0; i < dim_; ++i) v[i] /= n;
+    }
+
+    float distance(const float* a, const float* b) const {
+        if (metric_ == Metric::L2) return VectorUtils::l2sq(a, b, dim_);
+        return 1.0f - VectorUtils::dot(a, b, dim_);
+    }
+
+    const float* row(label_t l) const {
+        return vec_path_.empty() ? vectors_.data() + std::size_t(l) * dim_ : vecs_.row(l);
+    }
+
+    bool admissible(label_t l, const Bitmap* allowed) const {
+        return !deleted_[l] && (!allowed || allowed->contains(l));
+    }
+
+    // Caller holds rw_ exclusively.
+    void add_document(const RAGLibrary::Document& d) {
+        const label_t l = label_t(docs_.size());
+        docs_.emplace_back(d.metadata, d.page_content);
+        deleted_.push_back(0);
+        const std::string id = docs_[l].metadata.try_emplace("id", auto_id(l)).first->second;
+        auto [pos, inserted] = id_to_label_.try_emplace(id, l);
+        if (!inserted) {
+            // Upsert: the previous version becomes a tombstone.
+            deleted_[pos->second] = 1;
+            attrs_.remove(pos->second, docs_[pos->second].metadata);
+            pos->second = l;
+        }
+        attrs_.add(l, docs_[l].metadata);
+    }
+
+    // ---- persistence -------------------------------------------------------
+    template <class T>
+    static void put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    template <class T>
+    static void get(std::ifstream& in, T& v) { in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+    static void put_str(std::ofstream& out, const std::string& s) {
+        put(out, std::uint64_t(s.size()));
+        out.write(s.data(), std::streamsize(s.size()));
+    }
+
+    static std::string get_str(std::ifstream& in) {
+        std::uint64_t n = 0;
+        get(in, n);
+        std::string s(n, '\0');
+        in.read(s.data(), std::streamsize(n));
+        return s;
+    }
+
+    // Caller holds rw_. Rows already live in "<path>.vectors" when saving to
+    // the configured path; any other target gets them inline.
+    void write_file(const std::string& path) const {
+        if (path.empty()) throw InvalidConfiguration("binary: no path to save to");
+        const bool inline_rows = vec_path_.empty() || path != path_;
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) throw VStoreError("binary: cannot open '" + tmp + "' for writing");
+
+            out.write(kMagic, sizeof(kMagic));
+            put(out, std::uint32_t(dim_));
+            put_str(out, metric_name(metric_));
+            put(out, std::uint64_t(docs_.size()));
+            put(out, std::uint8_t(!center_.empty()));
+            out.write(reinterpret_cast<const char*>(center_.data()), std::streamsize(center_.size() * sizeof(float)));
+            out.write(reinterpret_cast<const char*>(codes_.data()), std::streamsize(codes_.size() * sizeof(std::uint64_t)));
+            put(out, std::uint8_t(inline_rows));
+            if (inline_rows && !docs_.empty())
+                out.write(reinterpret_cast<const char*>(row(0)), std::streamsize(docs_.size() * dim_ * sizeof(float)));
+            for (std::size_t l = 0; l < docs_.size(); ++l) {
+                put(out, deleted_[l]);
+                put_str(out, docs_[l].page_content);
+                put(out, std::uint64_t(docs_[l].metadata.size()));
+                for (const auto& [k, v] : docs_[l].metadata) {
+                    put_str(out, k);
+                    put_str(out, v);
+                }
+            }
+            if (!out) throw VStoreError("binary: write to '" + tmp + "' failed");
+        }
+        std::filesystem::rename(tmp, path);
+    }
+
+    void load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        in.read(magic, sizeof(magic));
+        if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+            throw InvalidConfiguration("binary: '" + path + "' is not a binary index file");
+
+        std::uint32_t dim = 0;
+        std::uint64_t count = 0;
+        std::uint8_t  inline_rows = 0;
+        get(in, dim);
+        if (dim != dim_) throw DimensionMismatch("binary: index file dimension differs from cfg");
+        metric_ = parse_metric(get_str(in), "binary");
+        get(in, count);
+        std::uint8_t has_center = 0;
+        get(in, has_center);
+        if (has_center) {
+            center_.resize(dim_);
+            in.read(reinterpret_cast<char*>(center_.data()), std::streamsize(dim_ * sizeof(float)));
+        }
+        codes_.resize(count * words_);
+        in.read(reinterpret_cast<char*>(codes_.data()), std::streamsize(codes_.size() * sizeof(std::uint64_t)));
+        get(in, inline_rows);
+
+        // Rows appended after the last save belong to documents that were
+        // never persisted; drop them so row i stays label i.
+        const std::uintmax_t bytes = count * dim_ * sizeof(float);
+        if (inline_rows) {
+            std::vector<float> rows(count * dim_);
+            in.read(reinterpret_cast<char*>(rows.data()), std::streamsize(bytes));
+            std::ofstream(vec_path_, std::ios::binary | std::ios::trunc)
+                .write(reinterpret_cast<const char*>(rows.data()), std::streamsize(bytes));
+        } else if (!std::filesystem::exists(vec_path_) || std::filesystem::file_size(vec_path_) < bytes) {
+            throw VStoreError("binary: '" + vec_path_ + "' is missing rows of '" + path + "'");
+        } else {
+            std::filesystem::resize_file(vec_path_, bytes);
+        }
+
+        docs_.resize(count);
+        deleted_.resize(count);
+        for (std::size_t l = 0; l < count; ++l) {
+            get(in, deleted_[l]);
+            docs_[l].page_content = get_str(in);
+            std::uint64_t nmeta = 0;
+            get(in, nmeta);
+            for (std::uint64_t i = 0; i < nmeta; ++i) {
+                std::string k = get_str(in);
+                docs_[l].metadata[k] = get_str(in);
+            }
+            if (deleted_[l]) continue;
+            id_to_label_[docs_[l].metadata["id"]] = label_t(l);
+            attrs_.add(label_t(l), docs_[l].metadata);
+        }
+        if (!in) throw VStoreError("binary: '" + path + "' is truncated");
+    }
+};
+
+static AutoRegister<BinaryVectorBackend> _auto_register_binary("binary");
+
+void force_link_binary_backend() {
+    (void)_auto_register_binary;
+}
+} // namespace vdb
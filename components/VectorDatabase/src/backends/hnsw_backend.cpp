@@ -0,0 +1,669 @@
+// components/VectorDatabase/src/backends/hnsw_backend.cpp
+#include "vectordb/attribute_index.h"
+#include "vectordb/backend.h"
+#include "vectordb/distance.h"
+#include "vectordb/registry.h"
+#include "vectordb/exceptions.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CommonStructs.h"
+#include "Tracing.h"
+#include "VectorUtils.h"
+
+namespace vdb {
+
+/**
+ * HnswVectorBackend
+ * -----------------
+ * In-process Hierarchical Navigable Small World graph (Malkov & Yashunin).
+ *
+ *  • Inserts may run concurrently: each node owns a mutex guarding its
+ *    neighbour lists and a thread never holds more than one of them.
+ *  • Queries only take the per-node lock while copying a neighbour list.
+ *  • Capacity grows geometrically under an exclusive lock.
+ *  • Deletes are tombstones: the node stays in the graph for navigation
+ *    but is never returned. Re-inserting an existing "id" replaces it;
+ *    documents without one get "__auto:<label>".
+ *  • `save()` / cfg "path" persist the whole index to a single file.
+ *  • Filters resolve through an inverted attribute index. A selective
+ *    filter (at most cfg "prefilter_ratio" of the live documents) is
+ *    answered exactly over the matching nodes; a broad one walks the graph
+ *    with a widened beam, admitting only matching nodes.
+ *
+ * Scores follow the Redis backend: they are distances (lower is closer),
+ * i.e. 1 - cos for COSINE, 1 - dot for IP and squared L2 for L2.
+ */
+class HnswVectorBackend final : public VectorBackend {
+    using label_t = std::uint32_t;
+    using DistLabel = std::pair<float, label_t>;
+    using MaxHeap = std::priority_queue<DistLabel>;
+    using MinHeap = std::priority_queue<DistLabel, std::vector<DistLabel>, std::greater<DistLabel>>;
+
+    static constexpr label_t kNone = std::numeric_limits<label_t>::max();
+    static constexpr char kMagic[8] = {'P', 'C', 'H', 'N', 'S', 'W', '0', '1'};
+
+public:
+    explicit HnswVectorBackend(const nlohmann::json& cfg)
+        : VectorBackend(cfg.at("dim").get<std::uint32_t>())
+        , metric_(parse_metric(cfg.value("metric", "COSINE"), "hnsw"))   // "COSINE" | "L2" | "IP"
+        , M_(cfg.value("M", 16))
+        , ef_construction_(cfg.value("ef_construction", 200))
+        , ef_search_(cfg.value("ef_search", 64))
+        , prefilter_ratio_(cfg.value("prefilter_ratio", 0.02))
+        , path_(cfg.value("path", ""))
+        , rng_(cfg.value("seed", 100))
+    {
+        if (prefilter_ratio_ < 0.0 || prefilter_ratio_ > 1.0)
+            throw InvalidConfiguration("hnsw: prefilter_ratio must be in [0, 1]");
+        if (M_ < 2)
+            throw InvalidConfiguration("hnsw: M must be >= 2");
+        maxM_  = M_;
+        maxM0_ = 2 * M_;
+        level_mult_ = 1.0 / std::log(double(M_));
+
+        if (!path_.empty() && std::filesystem::exists(path_)) {
+            load(path_);
+        } else {
+            grow(std::max<std::size_t>(cfg.value("capacity", 1024), 1));
+        }
+    }
+
+    ~HnswVectorBackend() override = default;
+
+    bool is_open() const noexcept override { return open_.load(); }
+
+    void insert(std::span<const RAGLibrary::Document> docs) override {
+        Tracing::Span span("hnsw::insert", "vdb");
+        span.SetItems(std::int64_t(docs.size()));
+        if (!is_open()) throw BackendClosed("HNSW backend closed");
+
+        for (const auto& d : docs) {
+            if (!d.embedding.has_value())
+                throw InsertionError("Document missing embedding data");
+            if (d.dim() != dim_)
+                throw DimensionMismatch("Dimension mismatch on insert");
+        }
+
+        // Labels are reserved up front so capacity can grow before any thread
+        // holds the shared lock; the graph work itself runs in parallel.
+        std::vector<label_t> labels(docs.size());
+        {
+            std::shared_lock lk(grow_mtx_);
+            for (std::size_t i = 0; i < docs.size(); ++i)
+                labels[i] = reserve_label(docs[i]);
+        }
+        if (!labels.empty())
+            ensure_capacity(std::size_t(*std::max_element(labels.begin(), labels.end())) + 1);
+
+        std::shared_lock lk(grow_mtx_);
+        // An exception must not leave the parallel region; the first one is
+        // rethrown once every point has been tried.
+        std::vector<std::uint8_t> added(docs.size(), 0);
+        std::exception_ptr error;
+        std::mutex error_mtx;
+        #pragma omp parallel for schedule(dynamic, 16) if (docs.size() > 64)
+        for (std::int64_t i = 0; i < std::int64_t(docs.size()); ++i) {
+            try {
+                add_point(labels[i], docs[i]);
+                added[i] = 1;
+            } catch (...) {
+                std::scoped_lock g(error_mtx);
+                if (!error) error = std::current_exception();
+            }
+        }
+
+        // Indexed only once written, so every id a filter yields is readable.
+        // Points that failed are tombstoned rather than left half-linked.
+        std::scoped_lock g(label_mtx_);
+        for (std::size_t i = 0; i < docs.size(); ++i) {
+            const label_t l = labels[i];
+            if (added[i]) {
+                attrs_.add(l, docs_[l].metadata);
+                continue;
+            }
+            std::atomic_ref<std::uint8_t>(deleted_[l]).store(1, std::memory_order_release);
+            auto it = id_to_label_.find(docs[i].metadata.contains("id") ? docs[i].metadata.at("id") : auto_id(l));
+            if (it != id_to_label_.end() && it->second == l) id_to_label_.erase(it);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    std::vector<QueryResult>
+    query(std::span<const float> embedding,
+          std::size_t k,
+          const std::unordered_map<std::string, std::string>* filter) override {
+        Tracing::Span span("hnsw::query", "vdb");
+        if (!is_open()) throw BackendClosed("HNSW backend closed");
+        if (embedding.size() != dim_)
+            throw DimensionMismatch("Dimension mismatch on query");
+
+        std::vector<float> q(embedding.begin(), embedding.end());
+        prepare(q.data());
+
+        std::shared_lock lk(grow_mtx_);
+        label_t ep;
+        int     top;
+        {
+            std::scoped_lock g(entry_mtx_);
+            ep  = entry_;
+            top = max_level_;
+        }
+        std::vector<QueryResult> out;
+        if (ep == kNone || k == 0) return out;
+
+        std::optional<Bitmap> allowed;
+        std::size_t live = 0;
+        if (filter && !filter->empty()) {
+            std::scoped_lock g(label_mtx_);
+            allowed = attrs_.match(*filter);
+            live    = id_to_label_.size();
+        }
+        if (allowed && allowed->empty()) return out;
+
+        std::size_t ef = std::max<std::size_t>(ef_search_, k);
+        MaxHeap top_k;
+        if (allowed && double(allowed->cardinality()) <= std::max(double(k), prefilter_ratio_ * double(live))) {
+            allowed->for_each([&](label_t l) {
+                if (is_deleted(l)) return;
+                const float d = distance(q.data(), vec(l));
+                if (top_k.size() < k) top_k.emplace(d, l);
+                else if (d < top_k.top().first) { top_k.pop(); top_k.emplace(d, l); }
+            });
+        } else {
+            // Only a fraction of the visited nodes can be admitted, so the
+            // beam grows with the inverse selectivity (bounded).
+            if (allowed)
+                ef = std::min(ef * std::clamp<std::size_t>(live / allowed->cardinality(), 1, 8), std::max(live, ef));
+
+            float ep_dist = distance(q.data(), vec(ep));
+            for (int lc = top; lc > 0; --lc)
+                greedy_step(q.data(), ep, ep_dist, lc);
+
+            auto admit = [&](label_t l) { return !is_deleted(l) && (!allowed || allowed->contains(l)); };
+            top_k = search_layer(q.data(), ep, ef, 0, admit);
+        }
+        while (top_k.size() > k) top_k.pop();
+
+        out.resize(top_k.size());
+        for (std::size_t i = top_k.size(); i-- > 0;) {
+            const auto [dist, l] = top_k.top();
+            top_k.pop();
+            RAGLibrary::Document doc = docs_[l];
+            doc.embedding = std::vector<float>(vec(l), vec(l) + dim_);
+            out[i] = QueryResult{std::move(doc), dist};
+        }
+        return out;
+    }
+
+    std::size_t erase(const std::vector<std::string>& ids) override {
+        if (!is_open()) throw BackendClosed("HNSW backend closed");
+        std::shared_lock lk(grow_mtx_);
+        std::scoped_lock g(label_mtx_);
+        std::size_t erased = 0;
+        for (const auto& id : ids) {
+            auto it = id_to_label_.find(id);
+            if (it == id_to_label_.end()) continue;
+            std::atomic_ref<std::uint8_t>(deleted_[it->second]).store(1, std::memory_order_release);
+            id_to_label_.erase(it);
+            ++erased;
+        }
+        return erased;
+    }
+
+    void save(const std::string& path) override {
+        if (!is_open()) throw BackendClosed("HNSW backend closed");
+        std::unique_lock lk(grow_mtx_);
+        write_file(path.empty() ? path_ : path);
+    }
+
+    void close() override {
+        if (!open_.exchange(false)) return;
+        if (!path_.empty()) {
+            std::unique_lock lk(grow_mtx_);
+            write_file(path_);
+        }
+    }
+
+private:
+    // ---- configuration ---------------------------------------------------
+    Metric      metric_;
+    std::size_t M_, maxM_ = 0, maxM0_ = 0;
+    std::size_t ef_construction_, ef_search_;
+    double      prefilter_ratio_;
+    double      level_mult_ = 0.0;
+    std::string path_;
+    std::atomic_bool open_{true};
+
+    // ---- graph storage (indexed by label) ---------------------------------
+    mutable std::shared_mutex           grow_mtx_;   // exclusive only to resize / persist
+    std::size_t                         capacity_ = 0;
+    std::vector<float>                  vectors_;    // capacity x dim
+    std::vector<label_t>                links0_;     // capacity x (maxM0 + 1), [count, n1, n2, ...]
+    std::vector<std::vector<label_t>>   upper_;      // level x (maxM + 1) per node
+    std::vector<int>                    levels_;     // -1 until the node is written
+    std::vector<std::uint8_t>           deleted_;    // tombstones, accessed through atomic_ref
+    std::vector<RAGLibrary::Document>   docs_;       // page + metadata, embedding kept in vectors_
+    std::unique_ptr<std::mutex[]>       link_locks_;
+
+    // ---- labels / ids ------------------------------------------------------
+    std::mutex                                  label_mtx_;
+    label_t                                     next_label_ = 0;
+    std::unordered_map<std::string, label_t>    id_to_label_;
+    AttributeIndex                              attrs_;       // written nodes only; tombstones stay until reload
+
+    // ---- entry point -------------------------------------------------------
+    std::mutex  entry_mtx_;
+    label_t     entry_     = kNone;
+    int         max_level_ = -1;
+
+    std::mutex   rng_mtx_;
+    std::mt19937 rng_;
+
+    // ---- visited sets ------------------------------------------------------
+    struct VisitedList {
+        std::vector<std::uint16_t> tags;
+        std::uint16_t              mark = 0;
+    };
+    std::mutex                                  visited_mtx_;
+    std::vector<std::unique_ptr<VisitedList>>   visited_pool_;
+
+    struct VisitedGuard {
+        HnswVectorBackend&           owner;
+        std::unique_ptr<VisitedList> list;
+        ~VisitedGuard() {
+            std::scoped_lock g(owner.visited_mtx_);
+            owner.visited_pool_.push_back(std::move(list));
+        }
+        bool test_and_set(label_t l) {
+            if (list->tags[l] == list->mark) return true;
+            list->tags[l] = list->mark;
+            return false;
+        }
+    };
+
+    VisitedGuard acquire_visited() {
+        std::unique_ptr<VisitedList> l;
+        {
+            std::scoped_lock g(visited_mtx_);
+            if (!visited_pool_.empty()) {
+                l = std::move(visited_pool_.back());
+                visited_pool_.pop_back();
+            }
+        }
+        if (!l) l = std::make_unique<VisitedList>();
+        if (l->tags.size() < capacity_) {
+            l->tags.assign(capacity_, 0);
+            l->mark = 0;
+        }
+        if (++l->mark == 0) {
+            std::fill(l->tags.begin(), l->tags.end(), 0);
+            l->mark = 1;
+        }
+        return VisitedGuard{*this, std::move(l)};
+    }
+
+    // ---- helpers -----------------------------------------------------------
+    const float* vec(label_t l) const { return vectors_.data() + std::size_t(l) * dim_; }
+    float*       vec(label_t l)       { return vectors_.data() + std::size_t(l) * dim_; }
+
+    label_t* links(label_t l, int layer) {
+        if (layer == 0) return links0_.data() + std::size_t(l) * (maxM0_ + 1);
+        return upper_[l].data() + std::size_t(layer - 1) * (maxM_ + 1);
+    }
+
+    void prepare(float* v) const {
+        if (metric_ != Metric::Cosine) return;
+        const float n = VectorUtils::norm(v, dim_);
+        if (n > 0.0f)
+            for (std::size_t i = 0; i < dim_; ++i) v[i] /= n;
+    }
+
+    float distance(const float* a, const float* b) const {
+        if (metric_ == Metric::L2) return VectorUtils::l2sq(a, b, dim_);
+        return 1.0f - VectorUtils::dot(a, b, dim_);
+    }
+
+    bool is_deleted(label_t l) const {
+        return std::atomic_ref<std::uint8_t>(const_cast<std::uint8_t&>(deleted_[l])).load(std::memory_order_acquire) != 0;
+    }
+
+    std::vector<label_t> copy_links(label_t l, int layer) {
+        std::scoped_lock g(link_locks_[l]);
+        const label_t* ll = links(l, layer);
+        return std::vector<label_t>(ll + 1, ll + 1 + ll[0]);
+    }
+
+    int random_level() {
+        std::scoped_lock g(rng_mtx_);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        return int(-std::log(std::max(u(rng_), 1e-12)) * level_mult_);
+    }
+
+    // Caller holds grow_mtx_ shared (tombstoning touches deleted_).
+    label_t reserve_label(const RAGLibrary::Document& d) {
+        std::scoped_lock g(label_mtx_);
+        const label_t l = next_label_++;
+        auto it = d.metadata.find("id");
+        const std::string id = it != d.metadata.end() ? it->second : auto_id(l);
+        auto [pos, inserted] = id_to_label_.try_emplace(id, l);
+        if (!inserted) {
+            // Upsert: the previous version becomes a tombstone.
+            std::atomic_ref<std::uint8_t>(deleted_[pos->second]).store(1, std::memory_order_release);
+            pos->second = l;
+        }
+        return l;
+    }
+
+    void ensure_capacity(std::size_t n) {
+        {
+            std::shared_lock lk(grow_mtx_);
+            if (n <= capacity_) return;
+        }
+        std::unique_lock lk(grow_mtx_);
+        if (n > capacity_) grow(std::max(n, capacity_ * 2));
+    }
+
+    // Caller holds grow_mtx_ exclusively (or is the constructor).
+    void grow(std::size_t cap) {
+        vectors_.resize(cap * dim_);
+        links0_.resize(cap * (maxM0_ + 1), 0);
+        upper_.resize(cap);
+        levels_.resize(cap, -1);
+        deleted_.resize(cap, 0);
+        docs_.resize(cap);
+        link_locks_ = std::make_unique<std::mutex[]>(cap);
+        capacity_ = cap;
+    }
+
+    void greedy_step(const float* q, label_t& ep, float& ep_dist, int layer) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (label_t nb : copy_links(ep, layer)) {
+                const float d = distance(q, vec(nb));
+                if (d < ep_dist) {
+                    ep_dist = d;
+                    ep      = nb;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Best-first search on one layer. Nodes failing `admit` are still expanded
+    // so tombstones and filtered-out nodes do not disconnect the graph.
+    template <class Admit>
+    MaxHeap search_layer(const float* q, label_t ep, std::size_t ef, int layer, Admit&& admit) {
+        auto visited = acquire_visited();
+        MaxHeap results;
+        MinHeap candidates;
+
+        const float d0 = distance(q, vec(ep));
+        visited.test_and_set(ep);
+        candidates.emplace(d0, ep);
+        if (admit(ep)) results.emplace(d0, ep);
+        float bound = results.empty() ? std::numeric_limits<float>::max() : results.top().first;
+
+        while (!candidates.empty()) {
+            const auto [cd, c] = candidates.top();
+            if (cd > bound && results.size() >= ef) break;
+            candidates.pop();
+
+            for (label_t nb : copy_links(c, layer)) {
+                if (visited.test_and_set(nb)) continue;
+                const float d = distance(q, vec(nb));
+                if (results.size() < ef || d < bound) {
+                    candidates.emplace(d, nb);
+                    if (admit(nb)) {
+                        results.emplace(d, nb);
+                        if (results.size() > ef) results.pop();
+                    }
+                    if (!results.empty()) bound = results.top().first;
+                }
+            }
+        }
+        return results;
+    }
+
+    // Neighbour selection heuristic (algorithm 4 of the paper): keep a
+    // candidate only if it is closer to the base than to every kept neighbour.
+    std::vector<label_t> select_neighbors(std::vector<DistLabel> candidates, std::size_t m) const {
+        std::sort(candidates.begin(), candidates.end());
+        std::vector<label_t> kept;
+        kept.reserve(m);
+        for (const auto& [d, c] : candidates) {
+            if (kept.size() >= m) break;
+            bool good = true;
+            for (label_t s : kept) {
+                if (distance(vec(c), vec(s)) < d) {
+                    good = false;
+                    break;
+                }
+            }
+            if (good) kept.push_back(c);
+        }
+        return kept;
+    }
+
+    void connect(label_t from, label_t to, int layer) {
+        const std::size_t cap = layer == 0 ? maxM0_ : maxM_;
+        std::scoped_lock g(link_locks_[from]);
+        label_t* ll = links(from, layer);
+        for (label_t i = 1; i <= ll[0]; ++i)
+            if (ll[i] == to) return;
+        if (ll[0] < cap) {
+            ll[++ll[0]] = to;
+            return;
+        }
+        std::vector<DistLabel> cand;
+        cand.reserve(cap + 1);
+        cand.emplace_back(distance(vec(from), vec(to)), to);
+        for (label_t i = 1; i <= ll[0]; ++i)
+            cand.emplace_back(distance(vec(from), vec(ll[i])), ll[i]);
+        const auto kept = select_neighbors(std::move(cand), cap);
+        ll[0] = label_t(kept.size());
+        std::copy(kept.begin(), kept.end(), ll + 1);
+    }
+
+    // Caller holds grow_mtx_ shared; `l` was reserved by reserve_label.
+    void add_point(label_t l, const RAGLibrary::Document& d) {
+        const int level = random_level();
+
+        // Everything a reader may touch is written before the node is linked.
+        std::copy(d.embedding->begin(), d.embedding->end(), vec(l));
+        prepare(vec(l));
+        docs_[l] = RAGLibrary::Document(d.metadata, d.page_content);
+        docs_[l].metadata.try_emplace("id", auto_id(l));
+        {
+            std::scoped_lock g(link_locks_[l]);
+            upper_[l].assign(std::size_t(level) * (maxM_ + 1), 0);
+            links(l, 0)[0] = 0;
+            levels_[l] = level;
+        }
+
+        label_t ep;
+        int     top;
+        {
+            std::scoped_lock g(entry_mtx_);
+            if (entry_ == kNone) {
+                entry_     = l;
+                max_level_ = level;
+                return;
+            }
+            ep  = entry_;
+            top = max_level_;
+        }
+
+        const float* q = vec(l);
+        float ep_dist = distance(q, vec(ep));
+        for (int lc = top; lc > level; --lc)
+            greedy_step(q, ep, ep_dist, lc);
+
+        auto any = [](label_t) { return true; };
+        for (int lc = std::min(level, top); lc >= 0; --lc) {
+            MaxHeap found = search_layer(q, ep, ef_construction_, lc, any);
+            std::vector<DistLabel> cand;
+            cand.reserve(found.size());
+            while (!found.empty()) {
+                if (found.top().second != l) cand.push_back(found.top());
+                found.pop();
+            }
+            if (cand.empty()) continue;
+            ep = std::min_element(cand.begin(), cand.end())->second;
+
+            const auto neighbors = select_neighbors(std::move(cand), M_);
+            {
+                std::scoped_lock g(link_locks_[l]);
+                label_t* ll = links(l, lc);
+                ll[0] = label_t(neighbors.size());
+                std::copy(neighbors.begin(), neighbors.end(), ll + 1);
+            }
+            for (label_t nb : neighbors)
+                connect(nb, l, lc);
+        }
+
+        if (level > top) {
+            std::scoped_lock g(entry_mtx_);
+            if (level > max_level_) {
+                entry_     = l;
+                max_level_ = level;
+            }
+        }
+    }
+
+    // ---- persistence -------------------------------------------------------
+    template <class T>
+    static void put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    template <class T>
+    static void get(std::ifstream& in, T& v) { in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+    static void put_str(std::ofstream& out, const std::string& s) {
+        put(out, std::uint64_t(s.size()));
+        out.write(s.data(), std::streamsize(s.size()));
+    }
+
+    static std::string get_str(std::ifstream& in) {
+        std::uint64_t n = 0;
+        get(in, n);
+        std::string s(n, '\0');
+        in.read(s.data(), std::streamsize(n));
+        return s;
+    }
+
+    // Caller holds grow_mtx_ exclusively.
+    void write_file(const std::string& path) {
+        if (path.empty()) throw InvalidConfiguration("hnsw: no path to save to");
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) throw VStoreError("hnsw: cannot open '" + tmp + "' for writing");
+
+            std::scoped_lock g(label_mtx_, entry_mtx_);
+            out.write(kMagic, sizeof(kMagic));
+            put(out, std::uint32_t(dim_));
+            put_str(out, metric_name(metric_));
+            put(out, std::uint64_t(M_));
+            put(out, std::uint64_t(ef_construction_));
+            put(out, std::uint64_t(next_label_));
+            put(out, entry_);
+            put(out, std::int32_t(max_level_));
+
+            for (label_t l = 0; l < next_label_; ++l) {
+                put(out, std::int32_t(levels_[l]));
+                put(out, deleted_[l]);
+                if (levels_[l] < 0) continue;
+                out.write(reinterpret_cast<const char*>(vec(l)), std::streamsize(dim_ * sizeof(float)));
+                out.write(reinterpret_cast<const char*>(links(l, 0)), std::streamsize((maxM0_ + 1) * sizeof(label_t)));
+                out.write(reinterpret_cast<const char*>(upper_[l].data()), std::streamsize(upper_[l].size() * sizeof(label_t)));
+                put_str(out, docs_[l].page_content);
+                put(out, std::uint64_t(docs_[l].metadata.size()));
+                for (const auto& [k, v] : docs_[l].metadata) {
+                    put_str(out, k);
+                    put_str(out, v);
+                }
+            }
+            if (!out) throw VStoreError("hnsw: write to '" + tmp + "' failed");
+        }
+        std::filesystem::rename(tmp, path);
+    }
+
+    void load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        in.read(magic, sizeof(magic));
+        if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+            throw InvalidConfiguration("hnsw: '" + path + "' is not an HNSW index file");
+
+        std::uint32_t dim = 0;
+        std::uint64_t m = 0, efc = 0, count = 0;
+        std::int32_t  top = -1;
+        get(in, dim);
+        if (dim != dim_) throw DimensionMismatch("hnsw: index file dimension differs from cfg");
+        metric_ = parse_metric(get_str(in), "hnsw");
+        get(in, m);
+        get(in, efc);
+        get(in, count);
+        get(in, entry_);
+        get(in, top);
+        max_level_       = top;
+        M_ = maxM_       = std::size_t(m);
+        maxM0_           = 2 * maxM_;
+        ef_construction_ = std::size_t(efc);
+        level_mult_      = 1.0 / std::log(double(M_));
+
+        grow(std::max<std::size_t>(count, 1024));
+        next_label_ = label_t(count);
+        for (label_t l = 0; l < next_label_; ++l) {
+            std::int32_t level = -1;
+            get(in, level);
+            get(in, deleted_[l]);
+            levels_[l] = level;
+            if (level < 0) continue;
+            in.read(reinterpret_cast<char*>(vec(l)), std::streamsize(dim_ * sizeof(float)));
+            in.read(reinterpret_cast<char*>(links(l, 0)), std::streamsize((maxM0_ + 1) * sizeof(label_t)));
+            upper_[l].assign(std::size_t(level) * (maxM_ + 1), 0);
+            in.read(reinterpret_cast<char*>(upper_[l].data()), std::streamsize(upper_[l].size() * sizeof(label_t)));
+            docs_[l].page_content = get_str(in);
+            std::uint64_t nmeta = 0;
+            get(in, nmeta);
+            for (std::uint64_t i = 0; i < nmeta; ++i) {
+                std::string k = get_str(in);
+                docs_[l].metadata[k] = get_str(in);
+            }
+            if (deleted_[l]) continue;
+            id_to_label_[docs_[l].metadata["id"]] = l;
+            attrs_.add(l, docs_[l].metadata);
+        }
+        if (!in) throw VStoreError("hnsw: '" + path + "' is truncated");
+    }
+};
+
+static AutoRegister<HnswVectorBackend> _auto_register_hnsw("hnsw");
+
+void force_link_hnsw_backend() {
+    (void)_auto_register_hnsw;
+}
+} // namespace vdb
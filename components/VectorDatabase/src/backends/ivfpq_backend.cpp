@@ -0,0 +1,716 @@
+// components/VectorDatabase/src/backends/ivfpq_backend.cpp
+#include "vectordb/attribute_index.h"
+#include "vectordb/backend.h"
+#include "vectordb/distance.h"
+#include "vectordb/mapped_rows.h"
+#include "vectordb/registry.h"
+#include "vectordb/exceptions.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CommonStructs.h"
+#include "Tracing.h"
+#include "TopK.h"
+#include "VectorUtils.h"
+
+namespace vdb {
+
+/**
+ * IvfPqVectorBackend
+ * ------------------
+ * Inverted file with product-quantized residuals (Jégou et al.), for corpora
+ * whose full-precision vectors do not fit in memory.
+ *
+ *  • A k-means coarse quantizer splits the space into `nlist` cells; a query
+ *    only scans the `nprobe` closest cells.
+ *  • Each vector is stored as `m` one-byte codes of its residual to the cell
+ *    centroid, scored through a per-query lookup table (ADC).
+ *  • Vectors are buffered and searched exactly until `train_size` of them
+ *    have arrived; the quantizers are then trained on that sample, outside
+ *    the writer lock.
+ *  • With cfg "path" the full-precision vectors are appended to
+ *    "<path>.vectors" and memory-mapped; the best `rerank * k` ADC candidates
+ *    are re-scored exactly from it. Only the codes stay resident.
+ *  • Deletes are tombstones; re-inserting an existing "id" replaces it.
+ *    Documents without one get "__auto:<label>".
+ *  • Filters resolve through an inverted attribute index. When at most
+ *    cfg "prefilter_ratio" of the documents match, only those are scored
+ *    (exactly when the vectors are mapped, otherwise over every cell);
+ *    broader filters probe proportionally more cells.
+ *
+ * Scores are distances, as in the other backends: 1 - cos for COSINE,
+ * 1 - dot for IP and squared L2 for L2.
+ */
+class IvfPqVectorBackend final : public VectorBackend {
+    using label_t = std::uint32_t;
+
+    static constexpr std::size_t kSub = 256;   // centroids per sub-quantizer, one byte per code
+    static constexpr char kMagic[8] = {'P', 'C', 'I', 'V', 'F', 'P', 'Q', '1'};
+
+public:
+    explicit IvfPqVectorBackend(const nlohmann::json& cfg)
+        : VectorBackend(cfg.at("dim").get<std::uint32_t>())
+        , metric_(parse_metric(cfg.value("metric", "COSINE"), "ivfpq"))   // "COSINE" | "L2" | "IP"
+        , nlist_(cfg.value("nlist", 1024))
+        , m_(cfg.value("m", 0))
+        , nprobe_(cfg.value("nprobe", 16))
+        , kmeans_iters_(cfg.value("kmeans_iters", 20))
+        , rerank_(cfg.value("rerank", 4))
+        , prefilter_ratio_(cfg.value("prefilter_ratio", 0.02))
+        , path_(cfg.value("path", ""))
+        , rng_(cfg.value("seed", 100))
+    {
+        if (nlist_ == 0 || nprobe_ == 0)
+            throw InvalidConfiguration("ivfpq: nlist and nprobe must be >= 1");
+        if (prefilter_ratio_ < 0.0 || prefilter_ratio_ > 1.0)
+            throw InvalidConfiguration("ivfpq: prefilter_ratio must be in [0, 1]");
+        if (m_ == 0) {
+            // Largest divisor of dim giving sub-vectors of at least 8 floats.
+            m_ = 1;
+            for (std::size_t c = std::max<std::size_t>(dim_ / 8, 1); c > 1; --c)
+                if (dim_ % c == 0) { m_ = c; break; }
+        }
+        if (dim_ % m_ != 0)
+            throw InvalidConfiguration("ivfpq: dim must be divisible by m");
+        dsub_       = dim_ / m_;
+        train_size_ = cfg.value("train_size", std::max<std::size_t>(39 * nlist_, kSub));
+        if (train_size_ < std::max<std::size_t>(nlist_, kSub))
+            throw InvalidConfiguration("ivfpq: train_size must be >= max(nlist, 256)");
+
+        if (!path_.empty()) {
+            vec_path_ = path_ + ".vectors";
+            if (std::filesystem::exists(path_)) {
+                load(path_);
+            } else {
+                std::ofstream(vec_path_, std::ios::binary | std::ios::trunc);
+            }
+            if (!vec_path_.empty()) vecs_.open(vec_path_, dim_);
+        }
+    }
+
+    ~IvfPqVectorBackend() override = default;
+
+    bool is_open() const noexcept override { return open_.load(); }
+
+    void insert(std::span<const RAGLibrary::Document> docs) override {
+        Tracing::Span span("ivfpq::insert", "vdb");
+        span.SetItems(std::int64_t(docs.size()));
+        if (!is_open()) throw BackendClosed("IVF-PQ backend closed");
+
+        for (const auto& d : docs) {
+            if (!d.embedding.has_value())
+                throw InsertionError("Document missing embedding data");
+            if (d.dim() != dim_)
+                throw DimensionMismatch("Dimension mismatch on insert");
+        }
+        if (docs.empty()) return;
+
+        std::vector<float> batch(docs.size() * dim_);
+        for (std::size_t i = 0; i < docs.size(); ++i) {
+            std::copy(docs[i].embedding->begin(), docs[i].embedding->end(), batch.begin() + i * dim_);
+            prepare(batch.data() + i * dim_);
+        }
+
+        std::unique_lock lk(rw_);
+        std::vector<label_t> labels(docs.size());
+        for (std::size_t i = 0; i < docs.size(); ++i)
+            labels[i] = add_document(docs[i]);
+
+        if (vecs_.is_open()) vecs_.append(batch.data(), docs.size());
+
+        if (trained_) {
+            add_encoded(labels.data(), batch.data(), labels.size());
+            return;
+        }
+        pending_labels_.insert(pending_labels_.end(), labels.begin(), labels.end());
+        pending_vecs_.insert(pending_vecs_.end(), batch.begin(), batch.end());
+        if (pending_labels_.size() < train_size_ || training_) return;
+
+        // Train on a snapshot without holding the writer lock; queries keep
+        // scanning the pending vectors exactly and later batches keep
+        // queueing until the quantizers are swapped in.
+        training_ = true;
+        std::vector<float> sample = sample_pending();
+        lk.unlock();
+        Quantizers q;
+        try {
+            q = train(sample);
+        } catch (...) {
+            lk.lock();
+            training_ = false;
+            throw;
+        }
+        lk.lock();
+        coarse_       = std::move(q.coarse);
+        coarse_norms_ = std::move(q.coarse_norms);
+        codebooks_    = std::move(q.codebooks);
+        lists_.assign(nlist_, InvList{});
+        trained_  = true;
+        training_ = false;
+        add_encoded(pending_labels_.data(), pending_vecs_.data(), pending_labels_.size());
+        pending_labels_ = {};
+        pending_vecs_   = {};
+    }
+
+    std::vector<QueryResult>
+    query(std::span<const float> embedding,
+          std::size_t k,
+          const std::unordered_map<std::string, std::string>* filter) override {
+        Tracing::Span span("ivfpq::query", "vdb");
+        if (!is_open()) throw BackendClosed("IVF-PQ backend closed");
+        if (embedding.size() != dim_)
+            throw DimensionMismatch("Dimension mismatch on query");
+
+        std::vector<float> q(embedding.begin(), embedding.end());
+        prepare(q.data());
+
+        std::shared_lock lk(rw_);
+        std::vector<QueryResult> out;
+        if (k == 0) return out;
+
+        std::optional<Bitmap> allowed;
+        if (filter && !filter->empty()) {
+            allowed = attrs_.match(*filter);
+            if (allowed->empty()) return out;
+        }
+        const Bitmap* mask = allowed ? &*allowed : nullptr;
+
+        const bool exact = vectors_mapped();
+        const std::size_t depth = exact && rerank_ > 1 ? k * rerank_ : k;
+        // Ranked by negated distance so TopK keeps the closest.
+        VectorUtils::TopK<label_t> best(depth);
+
+        const std::size_t live = id_to_label_.size();
+        const bool selective = allowed &&
+            double(allowed->cardinality()) <= std::max(double(depth), prefilter_ratio_ * double(live));
+
+        if (selective && exact) {
+            allowed->for_each([&](label_t l) {
+                if (deleted_[l]) return;
+                const float d = distance(q.data(), mapped_vec(l));
+                if (-d > best.threshold()) best.push(l, -d);
+            });
+        } else {
+            if (trained_) {
+                std::size_t nprobe = nprobe_;
+                if (selective)
+                    nprobe = nlist_;
+                else if (allowed)
+                    nprobe *= std::clamp<std::size_t>(live / allowed->cardinality(), 1, 8);
+                scan_lists(q.data(), mask, std::min(nprobe, nlist_), best);
+            }
+
+            for (std::size_t i = 0; i < pending_labels_.size(); ++i) {
+                const label_t l = pending_labels_[i];
+                if (!admissible(l, mask)) continue;
+                const float d = distance(q.data(), pending_vecs_.data() + i * dim_);
+                if (-d > best.threshold()) best.push(l, -d);
+            }
+        }
+
+        auto cand = best.sorted();
+        if (exact && !selective) {
+            for (auto& [l, score] : cand)
+                score = -distance(q.data(), mapped_vec(l));
+            std::sort(cand.begin(), cand.end(), [](const auto& a, const auto& b) {
+                return a.second > b.second || (a.second == b.second && a.first < b.first);
+            });
+        }
+        if (cand.size() > k) cand.resize(k);
+
+        out.reserve(cand.size());
+        for (const auto& [l, score] : cand) {
+            RAGLibrary::Document doc = docs_[l];
+            if (exact) doc.embedding = std::vector<float>(mapped_vec(l), mapped_vec(l) + dim_);
+            out.push_back(QueryResult{std::move(doc), -score});
+        }
+        return out;
+    }
+
+    std::size_t erase(const std::vector<std::string>& ids) override {
+        if (!is_open()) throw BackendClosed("IVF-PQ backend closed");
+        std::unique_lock lk(rw_);
+        std::size_t erased = 0;
+        for (const auto& id : ids) {
+            auto it = id_to_label_.find(id);
+            if (it == id_to_label_.end()) continue;
+            deleted_[it->second] = 1;
+            attrs_.remove(it->second, docs_[it->second].metadata);
+            id_to_label_.erase(it);
+            ++erased;
+        }
+        return erased;
+    }
+
+    void save(const std::string& path) override {
+        if (!is_open()) throw BackendClosed("IVF-PQ backend closed");
+        std::lock_guard save_lk(save_mtx_);
+        std::shared_lock lk(rw_);
+        write_file(path.empty() ? path_ : path);
+    }
+
+    void close() override {
+        if (!open_.exchange(false)) return;
+        std::lock_guard save_lk(save_mtx_);
+        std::unique_lock lk(rw_);
+        if (!path_.empty()) write_file(path_);
+        vecs_.close();
+    }
+
+private:
+    // ---- configuration ---------------------------------------------------
+    Metric      metric_;
+    std::size_t nlist_, m_, dsub_ = 0;
+    std::size_t nprobe_, kmeans_iters_, rerank_;
+    double      prefilter_ratio_;
+    std::size_t train_size_ = 0;
+    std::string path_, vec_path_;
+    std::mt19937 rng_;
+    std::atomic_bool open_{true};
+
+    // Writers (insert / erase / close) are exclusive, queries shared.
+    mutable std::shared_mutex rw_;
+    // Serialises save / close, which share the "<path>.tmp" file; taken
+    // before rw_.
+    std::mutex save_mtx_;
+
+    // ---- quantizers ----------------------------------------------------------
+    bool               trained_  = false;
+    bool               training_ = false;   // an insert is training outside rw_
+    std::vector<float> coarse_;         // nlist x dim
+    std::vector<float> coarse_norms_;   // |c|^2 per cell
+    std::vector<float> codebooks_;      // m x 256 x dsub
+
+    struct InvList {
+        std::vector<label_t>      labels;
+        std::vector<std::uint8_t> codes;    // labels.size() x m
+    };
+    std::vector<InvList> lists_;
+
+    // Vectors received before training, searched exactly.
+    std::vector<label_t> pending_labels_;
+    std::vector<float>   pending_vecs_;
+
+    // ---- documents (indexed by label) ----------------------------------------
+    std::vector<RAGLibrary::Document>        docs_;      // page + metadata only
+    std::vector<std::uint8_t>                deleted_;
+    std::unordered_map<std::string, label_t> id_to_label_;
+    AttributeIndex                           attrs_;     // live documents only
+
+    // Full-precision rows, indexed by label; only with cfg "path".
+    MappedRows vecs_;
+
+    // ---- helpers -------------------------------------------------------------
+    void prepare(float* v) const {
+        if (metric_ != Metric::Cosine) return;
+        const float n = VectorUtils::norm(v, dim_);
+        if (n > 0.0f)
+            for (std::size_t i = 0; i < dim_; ++i) v[i] /= n;
+    }
+
+    float distance(const float* a, const float* b) const {
+        if (metric_ == Metric::L2) return VectorUtils::l2sq(a, b, dim_);
+        return 1.0f - VectorUtils::dot(a, b, dim_);
+    }
+
+    bool admissible(label_t l, const Bitmap* allowed) const {
+        return !deleted_[l] && (!allowed || allowed->contains(l));
+    }
+
+    bool vectors_mapped() const {
+        return vecs_.is_open() && vecs_.rows() >= docs_.size();
+    }
+
+    const float* mapped_vec(label_t l) const {
+        return vecs_.row(l);
+    }
+
+    // Caller holds rw_ exclusively.
+    label_t add_document(const RAGLibrary::Document& d) {
+        const label_t l = label_t(docs_.size());
+        docs_.emplace_back(d.metadata, d.page_content);
+        deleted_.push_back(0);
+        const std::string id = docs_[l].metadata.try_emplace("id", auto_id(l)).first->second;
+        auto [pos, inserted] = id_to_label_.try_emplace(id, l);
+        if (!inserted) {
+            // Upsert: the previous version becomes a tombstone.
+            deleted_[pos->second] = 1;
+            attrs_.remove(pos->second, docs_[pos->second].metadata);
+            pos->second = l;
+        }
+        attrs_.add(l, docs_[l].metadata);
+        return l;
+    }
+
+    // Index of the nearest centroid (squared L2) for each of the n rows of x,
+    // scored block-wise through gemm_nt as |c|^2 - 2 x.c.
+    static std::vector<std::uint32_t> assign(const float* x, std::size_t n,
+                                             const float* cents, const float* cent_norms,
+                                             std::size_t k, std::size_t d) {
+        constexpr std::size_t kBlock = 64;
+        std::vector<std::uint32_t> out(n);
+        const std::int64_t nblocks = std::int64_t((n + kBlock - 1) / kBlock);
+
+        #pragma omp parallel
+        {
+            std::vector<float> dots(kBlock * k);
+            #pragma omp for schedule(static)
+            for (std::int64_t b = 0; b < nblocks; ++b) {
+                const std::size_t r0   = std::size_t(b) * kBlock;
+                const std::size_t rows = std::min(kBlock, n - r0);
+                VectorUtils::gemm_nt(x + r0 * d, rows, cents, k, d, dots.data());
+                for (std::size_t r = 0; r < rows; ++r) {
+                    const float* row = dots.data() + r * k;
+                    std::uint32_t arg = 0;
+                    float         lo  = std::numeric_limits<float>::max();
+                    for (std::size_t c = 0; c < k; ++c) {
+                        const float s = cent_norms[c] - 2.0f * row[c];
+                        if (s < lo) { lo = s; arg = std::uint32_t(c); }
+                    }
+                    out[r0 + r] = arg;
+                }
+            }
+        }
+        return out;
+    }
+
+    static std::vector<float> squared_norms(const float* x, std::size_t n, std::size_t d) {
+        std::vector<float> out(n);
+        for (std::size_t i = 0; i < n; ++i) out[i] = VectorUtils::dot(x + i * d, x + i * d, d);
+        return out;
+    }
+
+    // Lloyd's k-means seeded from k distinct rows. An empty cell takes half of
+    // the largest one by splitting its centroid with a small perturbation.
+    std::vector<float> kmeans(const float* x, std::size_t n, std::size_t d, std::size_t k) {
+        std::vector<std::size_t> perm(n);
+        std::iota(perm.begin(), perm.end(), 0);
+        std::shuffle(perm.begin(), perm.end(), rng_);
+        std::vector<float> cents(k * d);
+        for (std::size_t c = 0; c < k; ++c)
+            std::copy_n(x + perm[c] * d, d, cents.begin() + c * d);
+
+        std::vector<double>      sums(k * d);
+        std::vector<std::size_t> counts(k);
+        for (std::size_t it = 0; it < kmeans_iters_; ++it) {
+            const auto norms = squared_norms(cents.data(), k, d);
+            const auto owner = assign(x, n, cents.data(), norms.data(), k, d);
+
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(counts.begin(), counts.end(), 0);
+            for (std::size_t i = 0; i < n; ++i) {
+                double*      s  = sums.data() + std::size_t(owner[i]) * d;
+                const float* xi = x + i * d;
+                for (std::size_t t = 0; t < d; ++t) s[t] += xi[t];
+                ++counts[owner[i]];
+            }
+            for (std::size_t c = 0; c < k; ++c) {
+                if (counts[c] == 0) continue;
+                for (std::size_t t = 0; t < d; ++t)
+                    cents[c * d + t] = float(sums[c * d + t] / double(counts[c]));
+            }
+            for (std::size_t c = 0; c < k; ++c) {
+                if (counts[c] != 0) continue;
+                const std::size_t big = std::size_t(std::max_element(counts.begin(), counts.end()) - counts.begin());
+                for (std::size_t t = 0; t < d; ++t) {
+                    const float eps = (t % 2 ? 1.0f : -1.0f) * 1e-4f;
+                    cents[c * d + t]    = cents[big * d + t] * (1.0f + eps);
+                    cents[big * d + t] *= (1.0f - eps);
+                }
+                counts[c]   = counts[big] / 2;
+                counts[big] -= counts[c];
+            }
+        }
+        return cents;
+    }
+
+    struct Quantizers {
+        std::vector<float> coarse, coarse_norms, codebooks;
+    };
+
+    // Caller holds rw_ exclusively; copies `train_size` random pending rows.
+    std::vector<float> sample_pending() {
+        const std::size_t n = std::min(train_size_, pending_labels_.size());
+        std::vector<std::size_t> perm(pending_labels_.size());
+        std::iota(perm.begin(), perm.end(), 0);
+        std::shuffle(perm.begin(), perm.end(), rng_);
+        std::vector<float> sample(n * dim_);
+        for (std::size_t i = 0; i < n; ++i)
+            std::copy_n(pending_vecs_.data() + perm[i] * dim_, dim_, sample.begin() + i * dim_);
+        return sample;
+    }
+
+    // Runs without rw_; only the insert that set training_ calls it, so it
+    // has rng_ to itself.
+    Quantizers train(const std::vector<float>& sample) {
+        const std::size_t n = sample.size() / dim_;
+        Quantizers q;
+        q.coarse       = kmeans(sample.data(), n, dim_, nlist_);
+        q.coarse_norms = squared_norms(q.coarse.data(), nlist_, dim_);
+
+        // Sub-quantizers are trained on the residuals to the assigned cell.
+        const auto owner = assign(sample.data(), n, q.coarse.data(), q.coarse_norms.data(), nlist_, dim_);
+        q.codebooks.assign(m_ * kSub * dsub_, 0.0f);
+        std::vector<float> sub(n * dsub_);
+        for (std::size_t j = 0; j < m_; ++j) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const float* xi = sample.data() + i * dim_ + j * dsub_;
+                const float* ci = q.coarse.data() + std::size_t(owner[i]) * dim_ + j * dsub_;
+                for (std::size_t t = 0; t < dsub_; ++t) sub[i * dsub_ + t] = xi[t] - ci[t];
+            }
+            const auto cb = kmeans(sub.data(), n, dsub_, kSub);
+            std::copy(cb.begin(), cb.end(), q.codebooks.begin() + j * kSub * dsub_);
+        }
+        return q;
+    }
+
+    // Caller holds rw_ exclusively.
+    void add_encoded(const label_t* labels, const float* x, std::size_t n) {
+        const auto owner = assign(x, n, coarse_.data(), coarse_norms_.data(), nlist_, dim_);
+        std::vector<std::uint8_t> codes(n * m_);
+
+        #pragma omp parallel for schedule(static) if (n > 256)
+        for (std::int64_t i = 0; i < std::int64_t(n); ++i) {
+            std::vector<float> residual(dim_);
+            const float* xi = x + std::size_t(i) * dim_;
+            const float* ci = coarse_.data() + std::size_t(owner[i]) * dim_;
+            for (std::size_t t = 0; t < dim_; ++t) residual[t] = xi[t] - ci[t];
+            encode(residual.data(), codes.data() + std::size_t(i) * m_);
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            InvList& list = lists_[owner[i]];
+            list.labels.push_back(labels[i]);
+            list.codes.insert(list.codes.end(), codes.begin() + i * m_, codes.begin() + (i + 1) * m_);
+        }
+    }
+
+    void encode(const float* residual, std::uint8_t* code) const {
+        for (std::size_t j = 0; j < m_; ++j) {
+            const float* r  = residual + j * dsub_;
+            const float* cb = codebooks_.data() + j * kSub * dsub_;
+            std::size_t  arg = 0;
+            float        lo  = std::numeric_limits<float>::max();
+            for (std::size_t c = 0; c < kSub; ++c) {
+                const float dd = VectorUtils::l2sq(r, cb + c * dsub_, dsub_);
+                if (dd < lo) { lo = dd; arg = c; }
+            }
+            code[j] = std::uint8_t(arg);
+        }
+    }
+
+    // Fills table[j * 256 + c] with the partial score of sub-vector j of `q`
+    // against codeword c: the dot product for IP, squared L2 otherwise.
+    void build_lut(const float* q, bool ip, float* table) const {
+        for (std::size_t j = 0; j < m_; ++j) {
+            const float* qj = q + j * dsub_;
+            const float* cb = codebooks_.data() + j * kSub * dsub_;
+            for (std::size_t c = 0; c < kSub; ++c)
+                table[j * kSub + c] = ip ? VectorUtils::dot(qj, cb + c * dsub_, dsub_)
+                                         : VectorUtils::l2sq(qj, cb + c * dsub_, dsub_);
+        }
+    }
+
+    // Caller holds rw_ shared.
+    // COSINE vectors are unit length, so 1 - cos = |q - x|^2 / 2 and they are
+    // scanned with the L2 tables, which rank far better than q.x estimates.
+    void scan_lists(const float* q, const Bitmap* allowed, std::size_t nprobe,
+                    VectorUtils::TopK<label_t>& best) const {
+        const bool  ip    = metric_ == Metric::IP;
+        const float scale = metric_ == Metric::Cosine ? 0.5f : 1.0f;
+
+        // Vectors were assigned to cells by L2, so cells are probed by
+        // |q - c|^2 (up to |q|^2); only raw IP ranks them by q.c.
+        std::vector<float> qc(nlist_);
+        VectorUtils::gemm_nt(q, 1, coarse_.data(), nlist_, dim_, qc.data());
+        VectorUtils::TopK<std::uint32_t> probes(nprobe);
+        for (std::size_t c = 0; c < nlist_; ++c)
+            probes.push(std::uint32_t(c), ip ? qc[c] : 2.0f * qc[c] - coarse_norms_[c]);
+
+        // For IP the table does not depend on the cell: q.(c + r) = q.c + q.r.
+        std::vector<float> lut(m_ * kSub);
+        std::vector<float> residual(ip ? 0 : dim_);
+        if (ip) build_lut(q, true, lut.data());
+
+        std::vector<float> scores;
+        for (const auto& [cell, unused] : probes.sorted()) {
+            const InvList& list = lists_[cell];
+            if (list.labels.empty()) continue;
+            if (!ip) {
+                const float* c = coarse_.data() + std::size_t(cell) * dim_;
+                for (std::size_t t = 0; t < dim_; ++t) residual[t] = q[t] - c[t];
+                build_lut(residual.data(), false, lut.data());
+            }
+            scores.resize(list.labels.size());
+            VectorUtils::adc_scan(list.codes.data(), list.labels.size(), m_, lut.data(),
+                                  ip ? qc[cell] : 0.0f, scores.data());
+            for (std::size_t i = 0; i < scores.size(); ++i) {
+                const float d = ip ? 1.0f - scores[i] : scale * scores[i];
+                if (-d > best.threshold() && admissible(list.labels[i], allowed))
+                    best.push(list.labels[i], -d);
+            }
+        }
+    }
+
+    // ---- persistence -------------------------------------------------------
+    template <class T>
+    static void put(std::ofstream& out, const T& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    template <class T>
+    static void get(std::ifstream& in, T& v) { in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+
+    template <class T>
+    static void put_vec(std::ofstream& out, const std::vector<T>& v) {
+        put(out, std::uint64_t(v.size()));
+        out.write(reinterpret_cast<const char*>(v.data()), std::streamsize(v.size() * sizeof(T)));
+    }
+
+    template <class T>
+    static void get_vec(std::ifstream& in, std::vector<T>& v) {
+        std::uint64_t n = 0;
+        get(in, n);
+        v.resize(n);
+        in.read(reinterpret_cast<char*>(v.data()), std::streamsize(n * sizeof(T)));
+    }
+
+    static void put_str(std::ofstream& out, const std::string& s) {
+        put(out, std::uint64_t(s.size()));
+        out.write(s.data(), std::streamsize(s.size()));
+    }
+
+    static std::string get_str(std::ifstream& in) {
+        std::uint64_t n = 0;
+        get(in, n);
+        std::string s(n, '\0');
+        in.read(s.data(), std::streamsize(n));
+        return s;
+    }
+
+    // Caller holds rw_. The raw vectors file is already up to date; only the
+    // quantizers, codes and documents are written here.
+    void write_file(const std::string& path) const {
+        if (path.empty()) throw InvalidConfiguration("ivfpq: no path to save to");
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) throw VStoreError("ivfpq: cannot open '" + tmp + "' for writing");
+
+            out.write(kMagic, sizeof(kMagic));
+            put(out, std::uint32_t(dim_));
+            put_str(out, metric_name(metric_));
+            put(out, std::uint64_t(nlist_));
+            put(out, std::uint64_t(m_));
+            put(out, std::uint8_t(trained_));
+            put_vec(out, coarse_);
+            put_vec(out, codebooks_);
+            for (const auto& list : lists_) {
+                put_vec(out, list.labels);
+                put_vec(out, list.codes);
+            }
+            put_vec(out, pending_labels_);
+            put_vec(out, pending_vecs_);
+
+            put(out, std::uint64_t(docs_.size()));
+            for (std::size_t l = 0; l < docs_.size(); ++l) {
+                put(out, deleted_[l]);
+                put_str(out, docs_[l].page_content);
+                put(out, std::uint64_t(docs_[l].metadata.size()));
+                for (const auto& [k, v] : docs_[l].metadata) {
+                    put_str(out, k);
+                    put_str(out, v);
+                }
+            }
+            if (!out) throw VStoreError("ivfpq: write to '" + tmp + "' failed");
+        }
+        std::filesystem::rename(tmp, path);
+    }
+
+    void load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        in.read(magic, sizeof(magic));
+        if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+            throw InvalidConfiguration("ivfpq: '" + path + "' is not an IVF-PQ index file");
+
+        std::uint32_t dim = 0;
+        std::uint64_t nlist = 0, m = 0;
+        std::uint8_t  trained = 0;
+        get(in, dim);
+        if (dim != dim_) throw DimensionMismatch("ivfpq: index file dimension differs from cfg");
+        metric_ = parse_metric(get_str(in), "ivfpq");
+        get(in, nlist);
+        get(in, m);
+        get(in, trained);
+        nlist_   = std::size_t(nlist);
+        m_       = std::size_t(m);
+        dsub_    = dim_ / m_;
+        trained_ = trained != 0;
+
+        get_vec(in, coarse_);
+        get_vec(in, codebooks_);
+        coarse_norms_ = squared_norms(coarse_.data(), coarse_.size() / dim_, dim_);
+        if (trained_) {
+            lists_.assign(nlist_, InvList{});
+            for (auto& list : lists_) {
+                get_vec(in, list.labels);
+                get_vec(in, list.codes);
+            }
+        }
+        get_vec(in, pending_labels_);
+        get_vec(in, pending_vecs_);
+
+        std::uint64_t count = 0;
+        get(in, count);
+        docs_.resize(count);
+        deleted_.resize(count);
+        for (std::size_t l = 0; l < count; ++l) {
+            get(in, deleted_[l]);
+            docs_[l].page_content = get_str(in);
+            std::uint64_t nmeta = 0;
+            get(in, nmeta);
+            for (std::uint64_t i = 0; i < nmeta; ++i) {
+                std::string k = get_str(in);
+                docs_[l].metadata[k] = get_str(in);
+            }
+            if (deleted_[l]) continue;
+            id_to_label_[docs_[l].metadata["id"]] = label_t(l);
+            attrs_.add(label_t(l), docs_[l].metadata);
+        }
+        if (!in) throw VStoreError("ivfpq: '" + path + "' is truncated");
+
+        // Rows appended after the last save belong to documents that were
+        // never persisted; drop them so row i stays label i. A missing or
+        // short file cannot be realigned, so re-ranking is turned off.
+        const std::uintmax_t rows = count * dim_ * sizeof(float);
+        if (std::filesystem::exists(vec_path_) && std::filesystem::file_size(vec_path_) >= rows)
+            std::filesystem::resize_file(vec_path_, rows);
+        else
+            vec_path_.clear();
+    }
+};
+
+static AutoRegister<IvfPqVectorBackend> _auto_register_ivfpq("ivfpq");
+
+void force_link_ivfpq_backend() {
+    (void)_auto_register_ivfpq;
+}
+} // namespace vdb
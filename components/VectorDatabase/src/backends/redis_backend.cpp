@@ -7,102 +7,191 @@
 #include <sw/redis++/redis++.h>
 #include <hiredis/hiredis.h>
 
-#include <random>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
-#include <cstring>
-#include <stdexcept>
-#include <memory>
 
 #include "CommonStructs.h"
+#include "Tracing.h"
 
 namespace vdb {
 
+/**
+ * RedisVectorBackend
+ * ------------------
+ * RediSearch-backed store: one hash per document holding the raw FLOAT32
+ * vector, the page text and one "meta:<key>" field per metadata entry.
+ *
+ *  • Inserts are split into pipelines of cfg "batch_size" documents, sent
+ *    in parallel over a pool of cfg "connections" connections.
+ *  • Keys are stable: "<prefix>:<id>" when the document has an "id",
+ *    otherwise "<prefix>:<hash of text and metadata>", so re-inserting a
+ *    document replaces it instead of duplicating it.
+ *  • Metadata keys listed in cfg "tag_fields" are indexed as exact,
+ *    case-sensitive TAG fields; only those can be used in query filters.
+ *  • The vector field is an HNSW graph by default (cfg "algorithm",
+ *    "M", "ef_construction", "ef_runtime"); "FLAT" takes "block_size".
+ *    Both take "capacity" as the initial allocation.
+ *  • Queries return the page, the score and the "id", tag and cfg
+ *    "return_fields" metadata; the vector is only sent back with
+ *    "return_vector", and "return_fields": ["*"] returns every field.
+ *  • cfg "resp": 3 switches the connections to RESP3; both reply shapes
+ *    are parsed in place, without copying fields into temporaries.
+ */
 class RedisVectorBackend final : public VectorBackend {
     using redis_t = sw::redis::Redis;
+    using Field = std::pair<sw::redis::StringView, sw::redis::StringView>;
+
+    static constexpr std::string_view kMetaPrefix = "meta:";
 
 public:
     explicit RedisVectorBackend(const nlohmann::json& cfg)
         : VectorBackend(cfg.at("dim").get<std::uint32_t>())
-        , redis_(std::make_shared<redis_t>(cfg.value("uri", "tcp://127.0.0.1:6379")))
         , index_(cfg.value("index",  "vstore_idx"))
         , prefix_(cfg.value("prefix", "doc"))
         , metric_(cfg.value("metric", "COSINE"))  // "COSINE" | "L2" | "IP"
+        , algorithm_(cfg.value("algorithm", "HNSW"))   // "HNSW" | "FLAT"
+        , M_(cfg.value("M", 16))
+        , ef_construction_(cfg.value("ef_construction", 200))
+        , ef_runtime_(cfg.value("ef_runtime", 10))
+        , block_size_(cfg.value("block_size", 1024))
+        , batch_size_(cfg.value("batch_size", 1000))
+        , connections_(cfg.value("connections", 4))
+        , return_vector_(cfg.value("return_vector", false))
     {
+        if (algorithm_ != "HNSW" && algorithm_ != "FLAT")
+            throw InvalidConfiguration("redis: unknown algorithm '" + algorithm_ + "'");
+        if (M_ < 2 || ef_construction_ < 1 || ef_runtime_ < 1 || block_size_ < 1)
+            throw InvalidConfiguration("redis: M must be >= 2, ef_* and block_size >= 1");
+        if (batch_size_ < 1)
+            throw InvalidConfiguration("redis: batch_size must be >= 1");
+        if (connections_ < 1)
+            throw InvalidConfiguration("redis: connections must be >= 1");
+        for (const auto& tag : cfg.value("tag_fields", std::vector<std::string>{}))
+            tag_fields_.insert(tag);
+        projection_ = make_projection(cfg.value("return_fields", std::vector<std::string>{}));
+
+        sw::redis::ConnectionOptions opts(cfg.value("uri", "tcp://127.0.0.1:6379"));
+        const int resp = cfg.value("resp", 2);
+        if (resp != 2 && resp != 3)
+            throw InvalidConfiguration("redis: resp must be 2 or 3");
+        opts.resp = resp;
+        sw::redis::ConnectionPoolOptions pool;
+        pool.size = std::size_t(connections_);
+        redis_ = std::make_shared<redis_t>(opts, pool);
+
         ensure_index(cfg.value("capacity", 0));
     }
 
     bool is_open() const noexcept override { return static_cast<bool>(redis_); }
 
     void insert(std::span<const RAGLibrary::Document> docs) override {
+        Tracing::Span span("redis::insert", "vdb");
+        span.SetItems(std::int64_t(docs.size()));
         if (!is_open()) throw BackendClosed("Redis backend closed");
 
-        auto pipe = redis_->pipeline(false); // non-atomic
-
         for (const auto& d : docs) {
+            if (!d.embedding.has_value())
+                throw InsertionError("Document missing embedding data");
             if (d.dim() != dim_)
                 throw DimensionMismatch("Dimension mismatch on insert");
-    
-            if (!d.embedding.has_value())  // check if has embedding
-                throw InsertionError("Document missing embedding data");
-
-            const auto& embedding = *d.embedding;
-            const std::string key = prefix_ + ":" + gen_uuid();
-
-            const std::string binary(reinterpret_cast<const char*>(embedding.data()),
-                                     embedding.size() * sizeof(float));
-
-            pipe.hset(key, std::initializer_list<std::pair<std::string,std::string>>{
-                {"vector",   binary},
-                {"page",     d.page_content},
-                {"metadata", d.to_json()}
-            });
         }
 
-        try {
-            pipe.exec();
-        } catch (const sw::redis::Error& e) {
-            throw InsertionError(e.what());
+        // Each batch is one pipeline on its own pooled connection. A key is
+        // deleted before it is written so stale metadata fields of a
+        // replaced document do not survive the upsert.
+        const std::size_t batch   = std::size_t(batch_size_);
+        const std::size_t batches = (docs.size() + batch - 1) / batch;
+        std::string error;
+        std::mutex  error_mtx;
+
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(connections_) if (batches > 1)
+        for (std::int64_t b = 0; b < std::int64_t(batches); ++b) {
+            const std::size_t first = std::size_t(b) * batch;
+            const std::size_t last  = std::min(first + batch, docs.size());
+            try {
+                auto pipe = redis_->pipeline(false);
+                std::vector<std::string> meta_names;
+                std::vector<Field> fields;
+                for (std::size_t i = first; i < last; ++i) {
+                    const auto& d   = docs[i];
+                    const auto& emb = *d.embedding;
+                    const std::string key = make_key(d);
+
+                    fields.clear();
+                    fields.emplace_back("vector", sw::redis::StringView(
+                        reinterpret_cast<const char*>(emb.data()), emb.size() * sizeof(float)));
+                    fields.emplace_back("page", d.page_content);
+                    // Reserved up front: the views below point into it.
+                    meta_names.clear();
+                    meta_names.reserve(d.metadata.size());
+                    for (const auto& [k, v] : d.metadata) {
+                        meta_names.push_back(std::string(kMetaPrefix) + k);
+                        fields.emplace_back(meta_names.back(), v);
+                    }
+
+                    pipe.del(key);
+                    pipe.hset(key, fields.begin(), fields.end());
+                }
+                pipe.exec();
+            } catch (const std::exception& e) {
+                std::scoped_lock g(error_mtx);
+                if (error.empty()) error = e.what();
+            }
         }
+
+        if (!error.empty()) throw InsertionError(error);
     }
 
     std::vector<QueryResult>
     query(std::span<const float> embedding,
           std::size_t k,
           const std::unordered_map<std::string, std::string>* filter) override {
+        Tracing::Span span("redis::query", "vdb");
 
         if (embedding.size() != dim_)
             throw DimensionMismatch("Dimension mismatch on query");
 
-        const std::string vec_bin(reinterpret_cast<const char*>(embedding.data()),
-                                  embedding.size() * sizeof(float));
+        const sw::redis::StringView vec_bin(reinterpret_cast<const char*>(embedding.data()),
+                                            embedding.size() * sizeof(float));
 
         std::string base = "*";
         if (filter && !filter->empty()) {
             std::string f;
             for (const auto& [field, value] : *filter) {
-                (void)field; 
-                f += "@metadata:\"" + value + "\" ";
+                if (!tag_fields_.count(field))
+                    throw QueryError("redis: metadata key '" + field +
+                                     "' is not declared in tag_fields and cannot be filtered on");
+                f += "@" + escape(field) + ":{" + escape(value) + "} ";
             }
-            base = std::move(f);
+            base = "(" + f + ")";
         }
 
         const std::string knn_clause =
             "=>[KNN " + std::to_string(k) + " @vector $vec AS score]";
         const std::string q = base + " " + knn_clause;
+        const std::string limit = std::to_string(k);
 
-        std::vector<std::string> argv = {
+        // Views only: the vector bytes and the projection are not copied.
+        std::vector<sw::redis::StringView> argv = {
             "FT.SEARCH",
             index_,
             q,
-            "PARAMS", "2", "vec", vec_bin,
-            "RETURN", "4", "page", "metadata", "vector", "score", 
-            "DIALECT", "2",
-            "SORTBY", "score", "ASC"
+            "PARAMS", "2", "vec", vec_bin
         };
+        argv.insert(argv.end(), projection_.begin(), projection_.end());
+        argv.insert(argv.end(), {"DIALECT", "2", "SORTBY", "score", "ASC", "LIMIT", "0", limit});
 
         sw::redis::ReplyUPtr reply;
         try {
@@ -111,45 +200,112 @@ public:
             throw QueryError(e.what());
         }
 
-        return parse_search_reply_tree(reply.get());
+        return parse_search_reply(reply.get());
     }
 
     void close() override { redis_.reset(); }
 
 private:
     std::shared_ptr<redis_t> redis_;
-    std::string              index_, prefix_, metric_;
+    std::string              index_, prefix_, metric_, algorithm_;
+    int                      M_, ef_construction_, ef_runtime_, block_size_;
+    int                      batch_size_;
+    int                      connections_;
+    bool                     return_vector_;
+    std::set<std::string>    tag_fields_;
+    std::vector<std::string> projection_;   // "RETURN n f1 .. fn", or empty for all
+
+    std::vector<std::string> make_projection(const std::vector<std::string>& extra) const {
+        if (std::find(extra.begin(), extra.end(), "*") != extra.end()) return {};
+
+        std::set<std::string> meta(tag_fields_);
+        meta.insert("id");
+        meta.insert(extra.begin(), extra.end());
+
+        std::vector<std::string> fields = {"page", "score"};
+        if (return_vector_) fields.push_back("vector");
+        for (const auto& m : meta) fields.push_back(std::string(kMetaPrefix) + m);
+
+        std::vector<std::string> out = {"RETURN", std::to_string(fields.size())};
+        out.insert(out.end(), fields.begin(), fields.end());
+        return out;
+    }
 
+    static std::string_view view(const redisReply* r) {
+        return (r && r->str) ? std::string_view(r->str, r->len) : std::string_view();
+    }
 
-    static std::string safe_str(const redisReply* r) {
-        return (r && r->str) ? std::string(r->str, r->len) : std::string();
+    static float to_float(const redisReply* r) {
+        if (!r) return 0.f;
+        if (r->type == REDIS_REPLY_DOUBLE)  return float(r->dval);
+        if (r->type == REDIS_REPLY_INTEGER) return float(r->integer);
+        const std::string_view s = view(r);
+        float x = 0.f;
+        if (std::from_chars(s.data(), s.data() + s.size(), x).ec != std::errc()) return 0.f;
+        return x;
     }
 
-    static std::string gen_uuid() {
-        static thread_local std::mt19937_64 rng{std::random_device{}()};
-        static constexpr char hex[] = "0123456789abcdef";
-        std::uniform_int_distribution<uint64_t> dist;
+    // Backslash-escapes everything but [A-Za-z0-9_] and UTF-8 bytes, which is
+    // what the query syntax needs for both field names and TAG values.
+    static std::string escape(std::string_view s) {
+        std::string out;
+        out.reserve(s.size() * 2);
+        for (char c : s) {
+            const unsigned char u = static_cast<unsigned char>(c);
+            if (!((u >= '0' && u <= '9') || (u >= 'a' && u <= 'z') ||
+                  (u >= 'A' && u <= 'Z') || u == '_' || u >= 0x80))
+                out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
 
-        auto to_hex = [&](uint64_t x, int bytes) {
-            std::string out;
-            out.reserve(bytes * 2);
-            for (int i = bytes * 2 - 1; i >= 0; --i)
-                out.push_back(hex[(x >> (i * 4)) & 0xF]);
-            return out;
-        };
+    // 64-bit FNV-1a, continued from `h`; mix64 is the murmur3 finalizer.
+    static std::uint64_t hash64(std::string_view s, std::uint64_t h = 0xcbf29ce484222325ULL) {
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static std::uint64_t mix64(std::uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
 
-        uint64_t a = dist(rng);
-        uint64_t b = dist(rng);
+    std::string make_key(const RAGLibrary::Document& d) const {
+        std::string key;
+        key.reserve(prefix_.size() + 33);
+        key.append(prefix_).push_back(':');
+        if (auto it = d.metadata.find("id"); it != d.metadata.end()) {
+            key.append(it->second);
+            return key;
+        }
 
-        a = (a & 0xFFFFFFFFFFFF0FFFULL) | 0x0000000000004000ULL;
-        b = (b & 0x3FFFFFFFFFFFFFFFULL) | 0x8000000000000000ULL;
+        // Two independently seeded passes give a 128-bit content key; field
+        // separators keep ("ab","c") and ("a","bc") apart.
+        std::uint64_t h[2] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL};
+        for (auto& x : h) {
+            x = hash64(d.page_content, x);
+            for (const auto& [k, v] : d.metadata) {
+                x = hash64(std::string_view("\x1e", 1), x);
+                x = hash64(k, x);
+                x = hash64(std::string_view("\x1f", 1), x);
+                x = hash64(v, x);
+            }
+            x = mix64(x);
+        }
 
-        std::string s = to_hex(a >> 32, 4) + "-" +
-                        to_hex(a & 0xFFFFFFFFULL, 4).substr(0,4) + "-" +
-                        to_hex(a & 0xFFFFFFFFULL, 4).substr(4,4) + "-" +
-                        to_hex(b >> 48, 2) + "-" +
-                        to_hex(b & 0x0000FFFFFFFFFFFFULL, 6);
-        return s;
+        static constexpr char hex[] = "0123456789abcdef";
+        for (std::uint64_t x : h)
+            for (int i = 60; i >= 0; i -= 4)
+                key.push_back(hex[(x >> i) & 0xF]);
+        return key;
     }
 
     void ensure_index(int capacity) {
@@ -162,27 +318,34 @@ private:
             // create
         }
 
-        const std::string dim_str    = std::to_string(dim_);
-        const std::string algo       = "FLAT"; // or HNSW
-        const std::string cmd_metric = metric_;
+        std::vector<std::string> attrs = {
+            "TYPE", "FLOAT32",
+            "DIM", std::to_string(dim_),
+            "DISTANCE_METRIC", metric_
+        };
+        if (algorithm_ == "HNSW") {
+            attrs.insert(attrs.end(), {"M", std::to_string(M_),
+                                       "EF_CONSTRUCTION", std::to_string(ef_construction_),
+                                       "EF_RUNTIME", std::to_string(ef_runtime_)});
+        } else {
+            attrs.insert(attrs.end(), {"BLOCK_SIZE", std::to_string(block_size_)});
+        }
+        if (capacity > 0) {
+            attrs.insert(attrs.end(), {"INITIAL_CAP", std::to_string(capacity)});
+        }
 
         std::vector<std::string> args = {
             "FT.CREATE", index_,
             "ON", "HASH",
             "PREFIX", "1", prefix_,
             "SCHEMA",
-            "vector", "VECTOR", algo,
-            "6",
-            "TYPE", "FLOAT32",
-            "DIM", dim_str,
-            "DISTANCE_METRIC", cmd_metric,
-            "page", "TEXT",
-            "metadata", "TEXT"
+            "vector", "VECTOR", algorithm_, std::to_string(attrs.size())
         };
-
-        if (capacity > 0 && algo == "HNSW") {
-            args.push_back("INITIAL_CAP");
-            args.push_back(std::to_string(capacity));
+        args.insert(args.end(), attrs.begin(), attrs.end());
+        args.insert(args.end(), {"page", "TEXT"});
+        for (const auto& tag : tag_fields_) {
+            args.insert(args.end(), {std::string(kMetaPrefix) + tag, "AS", tag,
+                                     "TAG", "SEPARATOR", "\x1f", "CASESENSITIVE"});
         }
 
         try {
@@ -192,61 +355,71 @@ private:
         }
     }
 
-    static std::vector<QueryResult> parse_search_reply_tree(const redisReply* root) {
-        std::vector<QueryResult> out;
-        if (!root || root->type != REDIS_REPLY_ARRAY || root->elements == 0)
-            return out;
-
-        const redisReply* count_r = root->element[0];
-        if (!count_r) return out;
-        std::size_t total = 0;
-        if (count_r->type == REDIS_REPLY_INTEGER) {
-            total = static_cast<std::size_t>(count_r->integer);
-        } else if (count_r->type == REDIS_REPLY_STRING) {
-            total = std::stoull(safe_str(count_r));
-        } else {
-            return out;
+    // Field/value pairs of one hit: a flat array under RESP2, a map under
+    // RESP3. Values are read straight out of the reply buffer.
+    static QueryResult parse_hit(const redisReply* fields) {
+        QueryResult hit{RAGLibrary::Document{}, 0.f};
+        auto& doc = hit.doc;
+        for (std::size_t j = 0; j + 1 < fields->elements; j += 2) {
+            const std::string_view field = view(fields->element[j]);
+            const redisReply*      v     = fields->element[j + 1];
+
+            if (field == "page") {
+                doc.page_content.assign(view(v));
+            } else if (field.starts_with(kMetaPrefix)) {
+                doc.metadata.emplace(field.substr(kMetaPrefix.size()), view(v));
+            } else if (field == "vector") {
+                const std::string_view bin = view(v);
+                std::vector<float> emb(bin.size() / sizeof(float));
+                std::memcpy(emb.data(), bin.data(), emb.size() * sizeof(float));
+                doc.embedding = std::move(emb);
+            } else if (field == "score") {
+                hit.score = to_float(v);
+            } else if (field == "metadata") {   // pre-tag layout
+                doc.metadata.merge(RAGLibrary::Document::from_json(view(v)).metadata);
+            }
         }
+        return hit;
+    }
 
-        std::size_t pos = 1;
-        out.reserve(total);
-
-        for (std::size_t i = 0; i < total && pos + 1 < root->elements; ++i) {
-            const redisReply* key_r  = root->element[pos++];
-            const redisReply* arr_r  = root->element[pos++];
-
-            (void)key_r; 
-
-            if (!arr_r || arr_r->type != REDIS_REPLY_ARRAY) continue;
-
-            std::string page, metadata_json, vector_bin;
-            float score = 0.f;
-
-            for (size_t j = 0; j + 1 < arr_r->elements; j += 2) {
-                const redisReply* f = arr_r->element[j];
-                const redisReply* v = arr_r->element[j+1];
-                std::string field = safe_str(f);
-                std::string value = safe_str(v);
+    static bool is_map(const redisReply* r) {
+        return r && (r->type == REDIS_REPLY_MAP ||
+                     (r->type == REDIS_REPLY_ARRAY && r->elements % 2 == 0));
+    }
 
-                if      (field == "page")     page = std::move(value);
-                else if (field == "metadata") metadata_json = std::move(value);
-                else if (field == "vector")   vector_bin = std::move(value);
-                else if (field == "score") {
-                    try { score = std::stof(value); } catch(...) { score = 0.f; }
-                }
-            }
+    // Value of `key` in a RESP3 map, or nullptr.
+    static const redisReply* map_get(const redisReply* m, std::string_view key) {
+        for (std::size_t j = 0; j + 1 < m->elements; j += 2)
+            if (view(m->element[j]) == key) return m->element[j + 1];
+        return nullptr;
+    }
 
-            std::vector<float> emb;
-            if (!vector_bin.empty()) {
-                emb.resize(vector_bin.size() / sizeof(float));
-                std::memcpy(emb.data(), vector_bin.data(), vector_bin.size());
+    static std::vector<QueryResult> parse_search_reply(const redisReply* root) {
+        std::vector<QueryResult> out;
+        if (!root) return out;
+
+        // RESP3: {total_results, results: [{id, extra_attributes: {...}}, ...]}
+        if (root->type == REDIS_REPLY_MAP) {
+            const redisReply* results = map_get(root, "results");
+            if (!results || results->type != REDIS_REPLY_ARRAY) return out;
+            out.reserve(results->elements);
+            for (std::size_t i = 0; i < results->elements; ++i) {
+                const redisReply* r = results->element[i];
+                if (!is_map(r)) continue;
+                const redisReply* attrs = map_get(r, "extra_attributes");
+                if (is_map(attrs)) out.push_back(parse_hit(attrs));
             }
-
-            auto meta = RAGLibrary::Document::from_json(metadata_json).metadata;
-            RAGLibrary::Document doc{std::move(meta), page, std::move(emb)};
-            out.push_back(QueryResult{std::move(doc), score});
+            return out;
         }
 
+        // RESP2: [total, key1, [f, v, ...], key2, [f, v, ...], ...]
+        if (root->type != REDIS_REPLY_ARRAY || root->elements == 0)
+            return out;
+        out.reserve((root->elements - 1) / 2);
+        for (std::size_t pos = 1; pos + 1 < root->elements; pos += 2) {
+            const redisReply* fields = root->element[pos + 1];
+            if (fields && fields->type == REDIS_REPLY_ARRAY) out.push_back(parse_hit(fields));
+        }
         return out;
     }
 };
@@ -1,7 +1,10 @@
 #include "vectordb/wrappers/concurrent.h"
 #include "vectordb/exceptions.h"
 
+#include <algorithm>
 #include <future>
+#include <mutex>
+#include <shared_mutex>
 #include <utility>
 
 #include "CommonStructs.h"
@@ -13,8 +16,10 @@ ConcurrentSearchWrapper::ConcurrentSearchWrapper(VectorBackendPtr backend,
                                                  bool             threadSafe)
     : VectorBackend(backend->dim())          
     , backend_(std::move(backend))
-    , workers_(maxWorkers ? maxWorkers : 1)  
-    , backendThreadSafe_(threadSafe) {}
+    , workers_(maxWorkers == auto_workers ? std::max(1u, std::thread::hardware_concurrency())
+                                          : std::max<std::size_t>(maxWorkers, 1))
+    , backendThreadSafe_(threadSafe)
+    , pool_(workers_) {}
 
 ConcurrentSearchWrapper::~ConcurrentSearchWrapper() { close(); }
 
@@ -24,51 +29,89 @@ bool ConcurrentSearchWrapper::is_open() const noexcept {
 }
 
 void ConcurrentSearchWrapper::insert(std::span<const RAGLibrary::Document> docs) {
-    std::scoped_lock g(mtx_);        
+    std::unique_lock g(mtx_);
+    if (!backend_) throw BackendClosed("ConcurrentSearchWrapper closed");
     backend_->insert(docs);
 }
 
 std::vector<QueryResult>
-ConcurrentSearchWrapper::query(std::span<const float>               emb,
-                               std::size_t                         k,
-                               const std::unordered_map<std::string, std::string>* filter) {
+ConcurrentSearchWrapper::query_locked(std::span<const float> emb,
+                                      std::size_t            k,
+                                      const Filter*          filter) {
     if (!backendThreadSafe_) {
-        std::scoped_lock g(mtx_);
+        std::unique_lock g(mtx_);
+        if (!backend_) throw BackendClosed("ConcurrentSearchWrapper closed");
         return backend_->query(emb, k, filter);
     }
+    std::shared_lock g(mtx_);
+    if (!backend_) throw BackendClosed("ConcurrentSearchWrapper closed");
     return backend_->query(emb, k, filter);
 }
 
+std::vector<QueryResult>
+ConcurrentSearchWrapper::query(std::span<const float>               emb,
+                               std::size_t                         k,
+                               const std::unordered_map<std::string, std::string>* filter) {
+    return query_locked(emb, k, filter);
+}
+
 std::vector<std::vector<QueryResult>>
 ConcurrentSearchWrapper::query_many(const std::vector<std::vector<float>>&            embs,
                                     std::size_t                                       k,
                                     const std::unordered_map<std::string, std::string>* filter,
                                     bool                                              raiseOnErr) {
-    std::vector<std::future<std::vector<QueryResult>>> futs;
-    futs.reserve(embs.size());
-
-    /* launch each search in its own async task (simple pool) */
-    for (const auto& v : embs) {
-        futs.emplace_back(std::async(std::launch::async, [&, vec = v]() {
-            return query(vec, k, filter);
-        }));
-    }
-
-    /* collect preserving order */
+    /* chunked over the pool; results land in place, preserving order */
     std::vector<std::vector<QueryResult>> out(embs.size());
-    for (std::size_t i = 0; i < futs.size(); ++i) {
+    pool_.ParallelFor(0, embs.size(), [&](std::size_t i) {
         try {
-            out[i] = futs[i].get();
+            out[i] = query_locked(embs[i], k, filter);
         } catch (...) {
             if (raiseOnErr) throw;     // propagate first exception
             out[i].clear();            // else: empty result set
         }
-    }
+    });
     return out;
 }
 
+std::future<std::vector<QueryResult>>
+ConcurrentSearchWrapper::query_async(std::vector<float>    emb,
+                                     std::size_t           k,
+                                     std::optional<Filter> filter) {
+    return pool_.Submit([this, emb = std::move(emb), k, filter = std::move(filter)] {
+        return query_locked(emb, k, filter ? &*filter : nullptr);
+    });
+}
+
+void ConcurrentSearchWrapper::query_async(std::vector<float>    emb,
+                                          std::size_t           k,
+                                          std::optional<Filter> filter,
+                                          Callback              done) {
+    pool_.Post([this, emb = std::move(emb), k, filter = std::move(filter), done = std::move(done)] {
+        std::vector<QueryResult> res;
+        std::exception_ptr       err;
+        try {
+            res = query_locked(emb, k, filter ? &*filter : nullptr);
+        } catch (...) {
+            err = std::current_exception();
+        }
+        try { done(std::move(res), err); } catch (...) {}
+    });
+}
+
+std::size_t ConcurrentSearchWrapper::erase(const std::vector<std::string>& ids) {
+    std::unique_lock g(mtx_);
+    if (!backend_) throw BackendClosed("ConcurrentSearchWrapper closed");
+    return backend_->erase(ids);
+}
+
+void ConcurrentSearchWrapper::save(const std::string& path) {
+    std::unique_lock g(mtx_);
+    if (!backend_) throw BackendClosed("ConcurrentSearchWrapper closed");
+    backend_->save(path);
+}
+
 void ConcurrentSearchWrapper::close() {
-    std::scoped_lock g(mtx_);
+    std::unique_lock g(mtx_);
     if (backend_) {
         backend_->close();
         backend_.reset();
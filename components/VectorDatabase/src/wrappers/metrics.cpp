@@ -4,8 +4,11 @@
 #include <nlohmann/json.hpp>
 
 #include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cmath>
 #include <functional>
+#include <sstream>
 #include <type_traits>
 #include <utility>
 
@@ -15,70 +18,174 @@ using namespace std::chrono;
 
 namespace vdb::wrappers {
 
-void CallStats::observe(double elapsed, bool ok) noexcept {
-    ++calls;
-    if (!ok) ++errors;
-    total += elapsed;
-    min_t  = std::min(min_t, elapsed);
-    max_t  = std::max(max_t, elapsed);
+namespace {
+
+// Threads are dealt shards round-robin on first use.
+std::size_t thread_shard(std::size_t shards) noexcept {
+    static std::atomic<std::size_t> next{0};
+    static thread_local const std::size_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id % shards;
+}
+
+// Upper bounds of the exported Prometheus buckets, in seconds.
+constexpr double kPromBounds[] = {
+    0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005,
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+} // namespace
+
+const char* method_name(Method m) noexcept {
+    switch (m) {
+        case Method::Insert: return "insert";
+        case Method::Query:  return "query";
+        case Method::Erase:  return "erase";
+        case Method::Save:   return "save";
+        case Method::Close:  return "close";
+        default:             return "unknown";
+    }
+}
+
+// Values below kSubBuckets get a bucket each; above, a power of two
+// [2^e, 2^(e+1)) is split into kSubBuckets equal parts.
+std::size_t CallStats::bucket_of(std::uint64_t ns) noexcept {
+    if (ns < kSubBuckets) return std::size_t(ns);
+    const int e = std::min(int(std::bit_width(ns)) - 1, 43);
+    if (e == 43 && ns >> 44) return kBuckets - 1;
+    const std::size_t sub = std::size_t(ns >> (e - 4)) & (kSubBuckets - 1);
+    return std::size_t(e - 3) * kSubBuckets + sub;
+}
+
+std::uint64_t CallStats::bucket_lower(std::size_t b) noexcept {
+    if (b < kSubBuckets) return b;
+    const int e = int(b / kSubBuckets) + 3;
+    return (kSubBuckets + b % kSubBuckets) << (e - 4);
+}
+
+std::uint64_t CallStats::bucket_upper(std::size_t b) noexcept {
+    if (b < kSubBuckets) return b + 1;
+    const int e = int(b / kSubBuckets) + 3;
+    return bucket_lower(b) + (std::uint64_t(1) << (e - 4));
+}
+
+double CallStats::quantile(double q) const noexcept {
+    if (calls == 0 || buckets.empty()) return 0.0;
+    q = std::clamp(q, 0.0, 1.0);
+    const double rank = q * double(calls - 1);
+    double seen = 0.0;
+    for (std::size_t b = 0; b < buckets.size(); ++b) {
+        if (!buckets[b]) continue;
+        if (seen + double(buckets[b]) > rank) {
+            const double frac = (rank - seen + 0.5) / double(buckets[b]);
+            const double lo   = double(bucket_lower(b));
+            const double hi   = double(bucket_upper(b));
+            const double t    = (lo + frac * (hi - lo)) * 1e-9;
+            return std::clamp(t, min_t, max_t);
+        }
+        seen += double(buckets[b]);
+    }
+    return max_t;
+}
+
+void MetricsWrapper::Counters::observe(std::uint64_t ns, bool ok) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    calls.fetch_add(1, relaxed);
+    if (!ok) errors.fetch_add(1, relaxed);
+    total_ns.fetch_add(ns, relaxed);
+    buckets[CallStats::bucket_of(ns)].fetch_add(1, relaxed);
+
+    std::uint64_t cur = min_ns.load(relaxed);
+    while (ns < cur && !min_ns.compare_exchange_weak(cur, ns, relaxed)) {}
+    cur = max_ns.load(relaxed);
+    while (ns > cur && !max_ns.compare_exchange_weak(cur, ns, relaxed)) {}
 }
 
 MetricsWrapper::MetricsWrapper(VectorBackendPtr backend, std::string ns)
     : VectorBackend(backend->dim())
     , backend_(std::move(backend))
+    , shards_(std::make_unique<Shard[]>(kShards))
     , ns_(std::move(ns)) {}
 
 bool MetricsWrapper::is_open() const noexcept { return backend_->is_open(); }
 
 template <typename F, typename... Args>
-auto MetricsWrapper::measure(const std::string& method, F&& fn, Args&&... args) {
+auto MetricsWrapper::measure(Method method, F&& fn, Args&&... args) {
+    Counters& c = shards_[thread_shard(kShards)].methods[std::size_t(method)];
     const auto start = steady_clock::now();
-    bool ok = true;
+    auto elapsed = [&] {
+        return std::uint64_t(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    };
 
     using R = std::invoke_result_t<F, Args...>;
     try {
         if constexpr (std::is_void_v<R>) {
             std::invoke(std::forward<F>(fn), std::forward<Args>(args)...);
-            const auto elapsed = duration<double>(steady_clock::now() - start).count();
-            std::scoped_lock g(mtx_);
-            stats_[method].observe(elapsed, ok);
+            c.observe(elapsed(), true);
             return; // void
         } else {
             R result = std::invoke(std::forward<F>(fn), std::forward<Args>(args)...);
-            const auto elapsed = duration<double>(steady_clock::now() - start).count();
-            std::scoped_lock g(mtx_);
-            stats_[method].observe(elapsed, ok);
+            c.observe(elapsed(), true);
             return result;
         }
     } catch (...) {
-        ok = false;
-        const auto elapsed = duration<double>(steady_clock::now() - start).count();
-        {
-            std::scoped_lock g(mtx_);
-            stats_[method].observe(elapsed, ok);
-        }
+        c.observe(elapsed(), false);
         throw;
     }
 }
 
 void MetricsWrapper::insert(std::span<const RAGLibrary::Document> docs) {
-    measure("insert", &VectorBackend::insert, backend_.get(), docs);
+    measure(Method::Insert, &VectorBackend::insert, backend_.get(), docs);
 }
 
 std::vector<QueryResult>
 MetricsWrapper::query(std::span<const float> emb,
                       std::size_t            k,
                       const std::unordered_map<std::string, std::string>* filter) {
-    return measure("query", &VectorBackend::query, backend_.get(), emb, k, filter);
+    return measure(Method::Query, &VectorBackend::query, backend_.get(), emb, k, filter);
+}
+
+std::size_t MetricsWrapper::erase(const std::vector<std::string>& ids) {
+    return measure(Method::Erase, &VectorBackend::erase, backend_.get(), ids);
+}
+
+void MetricsWrapper::save(const std::string& path) {
+    measure(Method::Save, &VectorBackend::save, backend_.get(), path);
 }
 
 void MetricsWrapper::close() {
-    measure("close", &VectorBackend::close, backend_.get());
+    measure(Method::Close, &VectorBackend::close, backend_.get());
+}
+
+CallStats MetricsWrapper::collect(Method m) const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    CallStats s;
+    s.buckets.assign(CallStats::kBuckets, 0);
+    std::uint64_t total_ns = 0, min_ns = std::numeric_limits<std::uint64_t>::max(), max_ns = 0;
+    for (std::size_t i = 0; i < kShards; ++i) {
+        const Counters& c = shards_[i].methods[std::size_t(m)];
+        s.calls  += c.calls.load(relaxed);
+        s.errors += c.errors.load(relaxed);
+        total_ns += c.total_ns.load(relaxed);
+        min_ns    = std::min(min_ns, c.min_ns.load(relaxed));
+        max_ns    = std::max(max_ns, c.max_ns.load(relaxed));
+        for (std::size_t b = 0; b < CallStats::kBuckets; ++b)
+            s.buckets[b] += c.buckets[b].load(relaxed);
+    }
+    s.total = double(total_ns) * 1e-9;
+    if (s.calls) {
+        s.min_t = double(min_ns) * 1e-9;
+        s.max_t = double(max_ns) * 1e-9;
+    }
+    return s;
 }
 
 std::unordered_map<std::string, CallStats> MetricsWrapper::snapshot() const {
-    std::scoped_lock g(mtx_);
-    return stats_;
+    std::unordered_map<std::string, CallStats> out;
+    for (std::size_t m = 0; m < kMethods; ++m) {
+        CallStats s = collect(Method(m));
+        if (s.calls) out.emplace(method_name(Method(m)), std::move(s));
+    }
+    return out;
 }
 
 std::string MetricsWrapper::snapshot_json(int indent) const {
@@ -91,15 +198,64 @@ std::string MetricsWrapper::snapshot_json(int indent) const {
             {"total",  s.total},
             {"min",    std::isinf(s.min_t) ? nlohmann::json(nullptr) : nlohmann::json(s.min_t)},
             {"max",    s.max_t},
-            {"avg",    s.calls ? s.total / s.calls : 0.0}
+            {"avg",    s.calls ? s.total / s.calls : 0.0},
+            {"p50",    s.quantile(0.50)},
+            {"p95",    s.quantile(0.95)},
+            {"p99",    s.quantile(0.99)},
+            {"p999",   s.quantile(0.999)}
         };
     }
     return j.dump(indent);
 }
 
+// A native bucket is counted under the first exported bound at or above
+// its upper edge, so exported counts never include slower calls.
+std::string MetricsWrapper::prometheus() const {
+    const auto snap = snapshot();
+    std::ostringstream o;
+    o.precision(9);
+
+    o << "# HELP " << ns_ << "_calls_total Calls per backend method.\n"
+      << "# TYPE " << ns_ << "_calls_total counter\n";
+    for (const auto& [m, s] : snap)
+        o << ns_ << "_calls_total{method=\"" << m << "\"} " << s.calls << '\n';
+
+    o << "# HELP " << ns_ << "_errors_total Calls that threw, per backend method.\n"
+      << "# TYPE " << ns_ << "_errors_total counter\n";
+    for (const auto& [m, s] : snap)
+        o << ns_ << "_errors_total{method=\"" << m << "\"} " << s.errors << '\n';
+
+    o << "# HELP " << ns_ << "_latency_seconds Call latency per backend method.\n"
+      << "# TYPE " << ns_ << "_latency_seconds histogram\n";
+    for (const auto& [m, s] : snap) {
+        std::uint64_t cum = 0;
+        std::size_t   b   = 0;
+        for (double le : kPromBounds) {
+            const auto limit = std::uint64_t(std::llround(le * 1e9));
+            for (; b < s.buckets.size() && CallStats::bucket_upper(b) <= limit; ++b)
+                cum += s.buckets[b];
+            o << ns_ << "_latency_seconds_bucket{method=\"" << m << "\",le=\"" << le << "\"} "
+              << cum << '\n';
+        }
+        o << ns_ << "_latency_seconds_bucket{method=\"" << m << "\",le=\"+Inf\"} " << s.calls << '\n'
+          << ns_ << "_latency_seconds_sum{method=\"" << m << "\"} " << s.total << '\n'
+          << ns_ << "_latency_seconds_count{method=\"" << m << "\"} " << s.calls << '\n';
+    }
+    return o.str();
+}
+
 void MetricsWrapper::reset() {
-    std::scoped_lock g(mtx_);
-    stats_.clear();
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (std::size_t i = 0; i < kShards; ++i) {
+        for (auto& c : shards_[i].methods) {
+            c.calls.store(0, relaxed);
+            c.errors.store(0, relaxed);
+            c.total_ns.store(0, relaxed);
+            c.min_ns.store(std::numeric_limits<std::uint64_t>::max(), relaxed);
+            c.max_ns.store(0, relaxed);
+            for (auto& b : c.buckets) b.store(0, relaxed);
+        }
+    }
 }
 
 } // namespace vdb::wrappers
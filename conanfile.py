@@ -40,6 +40,7 @@ class RagPureAIConan(ConanFile):
         self.requires("nlohmann_json/3.11.3")
         self.requires("libcurl/8.10.1")
         self.requires("redis-plus-plus/1.3.13")
+        self.test_requires("benchmark/1.9.1")
 
 
     def configure(self):
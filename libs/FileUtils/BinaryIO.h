@@ -0,0 +1,113 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RagException.h"
+
+namespace RAGLibrary
+{
+    // Helpers for the native-endian binary formats (chunk stores, index
+    // files): PODs are written raw, strings with a u32 length prefix and
+    // arrays with a u64 element count.
+    template <typename T>
+    inline void WritePod(std::ostream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    inline void WriteString(std::ostream &out, std::string_view s)
+    {
+        WritePod(out, static_cast<std::uint32_t>(s.size()));
+        out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    template <typename T>
+    inline void WriteArray(std::ostream &out, const std::vector<T> &v)
+    {
+        WritePod(out, static_cast<std::uint64_t>(v.size()));
+        out.write(reinterpret_cast<const char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+    }
+
+    // Pads the stream with zeros up to the next multiple of `alignment`.
+    inline void WritePadding(std::ostream &out, std::size_t alignment)
+    {
+        static const char zeros[256] = {};
+        const auto pos = static_cast<std::size_t>(out.tellp());
+        const std::size_t pad = (alignment - pos % alignment) % alignment;
+        out.write(zeros, static_cast<std::streamsize>(pad));
+    }
+
+    // Bounds-checked cursor over an in-memory (typically mapped) buffer.
+    // Every read past the end throws, so a truncated or corrupt file fails
+    // cleanly instead of reading out of the mapping.
+    class ByteReader
+    {
+    public:
+        ByteReader(const char *data, std::size_t size) : m_data(data), m_size(size) {}
+
+        template <typename T>
+        T Read()
+        {
+            T value;
+            std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        std::string ReadString()
+        {
+            const auto n = Read<std::uint32_t>();
+            return std::string(Take(n), n);
+        }
+
+        template <typename T>
+        std::vector<T> ReadArray()
+        {
+            const auto n = Read<std::uint64_t>();
+            if (n > (m_size - m_pos) / sizeof(T))
+                throw RagException("ByteReader: truncated or corrupt data.");
+            std::vector<T> v(n);
+            const char *src = Take(n * sizeof(T));
+            if (n != 0)
+                std::memcpy(v.data(), src, n * sizeof(T));
+            return v;
+        }
+
+        // Pointer to the next `bytes` bytes, advancing past them.
+        const char *Take(std::size_t bytes)
+        {
+            const char *p = At(m_pos, bytes);
+            m_pos += bytes;
+            return p;
+        }
+
+        // Pointer to `bytes` bytes at an absolute offset; does not move.
+        const char *At(std::size_t offset, std::size_t bytes) const
+        {
+            if (offset > m_size || bytes > m_size - offset)
+                throw RagException("ByteReader: truncated or corrupt data.");
+            return m_data + offset;
+        }
+
+        void Seek(std::size_t offset)
+        {
+            if (offset > m_size)
+                throw RagException("ByteReader: truncated or corrupt data.");
+            m_pos = offset;
+        }
+
+        std::size_t Tell() const noexcept { return m_pos; }
+
+    private:
+        const char *m_data;
+        std::size_t m_size;
+        std::size_t m_pos = 0;
+    };
+}
+#endif
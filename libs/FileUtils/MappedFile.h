@@ -0,0 +1,146 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "RagException.h"
+
+namespace RAGLibrary
+{
+    // Read-only memory mapping of a whole file. Pages are faulted in by the OS
+    // on first touch, so large side files (raw vectors, chunk stores) cost no
+    // resident memory until they are actually read.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string &path) { Open(path); }
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+        MappedFile &operator=(MappedFile &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Close();
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+#ifdef _WIN32
+                std::swap(m_file, other.m_file);
+                std::swap(m_mapping, other.m_mapping);
+#endif
+            }
+            return *this;
+        }
+
+        void Open(const std::string &path)
+        {
+            Close();
+#ifdef _WIN32
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                throw RagException("MappedFile: cannot open '" + path + "'");
+            LARGE_INTEGER size;
+            GetFileSizeEx(m_file, &size);
+            m_size = static_cast<std::size_t>(size.QuadPart);
+            if (m_size == 0)
+                return;
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!m_mapping)
+            {
+                Close();
+                throw RagException("MappedFile: cannot map '" + path + "'");
+            }
+            m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!m_data)
+            {
+                Close();
+                throw RagException("MappedFile: cannot map '" + path + "'");
+            }
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw RagException("MappedFile: cannot open '" + path + "'");
+            struct stat st{};
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                throw RagException("MappedFile: cannot stat '" + path + "'");
+            }
+            m_size = static_cast<std::size_t>(st.st_size);
+            if (m_size > 0)
+            {
+                void *p = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (p == MAP_FAILED)
+                {
+                    ::close(fd);
+                    m_size = 0;
+                    throw RagException("MappedFile: cannot map '" + path + "'");
+                }
+                m_data = static_cast<const char *>(p);
+            }
+            // The mapping keeps its own reference to the file.
+            ::close(fd);
+#endif
+        }
+
+        void Close() noexcept
+        {
+#ifdef _WIN32
+            if (m_data)
+                UnmapViewOfFile(m_data);
+            if (m_mapping)
+                CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                CloseHandle(m_file);
+            m_mapping = nullptr;
+            m_file = INVALID_HANDLE_VALUE;
+#else
+            if (m_data)
+                ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        // Hint that the mapping will be read in random order (re-ranking,
+        // point lookups) so the kernel does not read ahead.
+        void AdviseRandom() const noexcept
+        {
+#ifndef _WIN32
+            if (m_data)
+                ::madvise(const_cast<char *>(m_data), m_size, MADV_RANDOM);
+#endif
+        }
+
+        const char *Data() const noexcept { return m_data; }
+        std::size_t Size() const noexcept { return m_size; }
+        bool IsOpen() const noexcept { return m_data != nullptr; }
+
+    private:
+        const char *m_data = nullptr;
+        std::size_t m_size = 0;
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+    };
+}
+#endif
@@ -1,9 +1,16 @@
 #include "StringUtils.h"
 
-#include <re2/re2.h>
+#include <omp.h>
+#include <unicode/normalizer2.h>
+#include <unicode/uchar.h>
+#include <unicode/unistr.h>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <numeric>
 #include <regex>
+#include <sstream>
 #include <unordered_map>
 
 using namespace StringUtils;
@@ -66,17 +73,161 @@ std::string StringUtils::str_details(const std::string &text)
     return ss.str();
 }
 
-std::string StringUtils::removeAccents(const std::string &input)
+namespace
 {
-    std::string result = input;
+    // Replacement for a code point: 0 keeps it, kDrop removes it, anything
+    // else is the ASCII letter it becomes.
+    constexpr char kDrop = '\x01';
+
+    // Two-byte sequences cover U+0080..U+07FF (Latin-1, Latin Extended-A/B
+    // and the combining diacritics); three-byte ones starting with E1 cover
+    // U+1A00..U+1EFF (combining extended and supplement, Latin Extended
+    // Additional).
+    struct AccentTable
+    {
+        std::array<char, 0x800> two{};
+        std::array<char, 0x500> three{};
 
-    static std::vector<std::pair<std::string, std::string>> replacements = {
-        {"á", "a"}, {"é", "e"}, {"í", "i"}, {"ó", "o"}, {"ú", "u"}, {"â", "a"}, {"ê", "e"}, {"î", "i"}, {"ô", "o"}, {"û", "u"}, {"à", "a"}, {"è", "e"}, {"ì", "i"}, {"ò", "o"}, {"ù", "u"}, {"ä", "a"}, {"ë", "e"}, {"ï", "i"}, {"ö", "o"}, {"ü", "u"}, {"ã", "a"}, {"õ", "o"}, {"ç", "c"}, {"Á", "A"}, {"É", "E"}, {"Í", "I"}, {"Ó", "O"}, {"Ú", "U"}, {"Â", "A"}, {"Ê", "E"}, {"Î", "I"}, {"Ô", "O"}, {"Û", "U"}, {"À", "A"}, {"È", "E"}, {"Ì", "I"}, {"Ò", "O"}, {"Ù", "U"}, {"Ä", "A"}, {"Ë", "E"}, {"Ï", "I"}, {"Ö", "O"}, {"Ü", "U"}, {"Ã", "A"}, {"Õ", "O"}, {"Ç", "C"}};
+        char &At(UChar32 cp)
+        {
+            return cp < 0x800 ? two[cp] : three[cp - 0x1A00];
+        }
+    };
 
-    for (const auto &pair : replacements)
+    // Only the generic combining diacritics are dropped; the non-spacing
+    // marks of Hebrew, Arabic, Syriac, Thaana or NKo are part of the text.
+    bool isCombiningDiacritic(UChar32 cp)
     {
-        re2::RE2::GlobalReplace(&result, pair.first, pair.second);
+        return (cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) || (cp >= 0x1DC0 && cp <= 0x1DFF);
     }
 
+    // Built once from ICU's canonical decompositions, so every precomposed
+    // Latin letter is covered rather than a hand-picked list.
+    const AccentTable &accentTable()
+    {
+        static const AccentTable table = []
+        {
+            AccentTable t;
+            UErrorCode status = U_ZERO_ERROR;
+            const icu::Normalizer2 *nfd = icu::Normalizer2::getNFDInstance(status);
+            auto fill = [&](UChar32 first, UChar32 last)
+            {
+                for (UChar32 cp = first; cp <= last; ++cp)
+                {
+                    if (isCombiningDiacritic(cp))
+                    {
+                        t.At(cp) = kDrop;
+                        continue;
+                    }
+                    icu::UnicodeString decomposed;
+                    if (U_FAILURE(status) || !nfd->getDecomposition(cp, decomposed) || decomposed.length() < 2)
+                        continue;
+                    const UChar32 base = decomposed.char32At(0);
+                    if (base >= 0x80 || !u_isalpha(base))
+                        continue;
+                    bool marks = true;
+                    for (int32_t i = decomposed.moveIndex32(0, 1); i < decomposed.length(); i = decomposed.moveIndex32(i, 1))
+                        marks = marks && u_charType(decomposed.char32At(i)) == U_NON_SPACING_MARK;
+                    if (marks)
+                        t.At(cp) = char(base);
+                }
+            };
+            fill(0x80, 0x7FF);
+            fill(0x1AB0, 0x1AFF);
+            fill(0x1D00, 0x1EFF);
+
+            // Letters with a stroke or bar have no decomposition.
+            for (auto [cp, ascii] : {std::pair<UChar32, char>{0x00D8, 'O'}, {0x00F8, 'o'}, {0x0110, 'D'}, {0x0111, 'd'},
+                                     {0x0126, 'H'}, {0x0127, 'h'}, {0x0141, 'L'}, {0x0142, 'l'}, {0x0166, 'T'},
+                                     {0x0167, 't'}, {0x0180, 'b'}, {0x0197, 'I'}, {0x01B5, 'Z'}, {0x01B6, 'z'},
+                                     {0x01E4, 'G'}, {0x01E5, 'g'}, {0x0268, 'i'}})
+                t.At(cp) = ascii;
+            return t;
+        }();
+        return table;
+    }
+
+    // Index of the first byte >= 0x80 at or after `i`, eight bytes at a time.
+    size_t nextNonAscii(const unsigned char *p, size_t i, size_t n)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, p + i, sizeof(word));
+            if (word & 0x8080808080808080ull)
+                break;
+        }
+        while (i < n && p[i] < 0x80)
+            ++i;
+        return i;
+    }
+
+    bool isContinuation(unsigned char c)
+    {
+        return (c & 0xC0) == 0x80;
+    }
+}
+
+void StringUtils::removeAccents(std::string_view input, std::string &output)
+{
+    const AccentTable &table = accentTable();
+    const auto *p = reinterpret_cast<const unsigned char *>(input.data());
+    const size_t n = input.size();
+    output.reserve(output.size() + n);
+    size_t i = 0;
+    while (i < n)
+    {
+        const size_t next = nextNonAscii(p, i, n);
+        output.append(input, i, next - i);
+        i = next;
+        if (i == n)
+            break;
+
+        // Malformed bytes and code points outside the tables are copied one
+        // byte at a time, so they come out unchanged.
+        size_t len = 1;
+        char replacement = 0;
+        if (p[i] >= 0xC2 && p[i] <= 0xDF && i + 1 < n && isContinuation(p[i + 1]))
+        {
+            len = 2;
+            replacement = table.two[((p[i] & 0x1F) << 6) | (p[i + 1] & 0x3F)];
+        }
+        else if (p[i] == 0xE1 && i + 2 < n && p[i + 1] >= 0xA8 && p[i + 1] <= 0xBB && isContinuation(p[i + 2]))
+        {
+            len = 3;
+            const UChar32 cp = 0x1000 | ((p[i + 1] & 0x3F) << 6) | (p[i + 2] & 0x3F);
+            replacement = table.three[cp - 0x1A00];
+        }
+
+        if (replacement == 0)
+            output.append(input, i, len);
+        else if (replacement != kDrop)
+            output += replacement;
+        i += len;
+    }
+}
+
+std::string StringUtils::removeAccents(const std::string &input)
+{
+    std::string result;
+    removeAccents(std::string_view(input), result);
     return result;
-}
\ No newline at end of file
+}
+
+std::vector<std::string> StringUtils::removeAccents(const std::vector<std::string> &inputs, int max_workers)
+{
+    std::vector<std::string> results(inputs.size());
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+    {
+        max_threads = max_workers;
+    }
+
+    omp_set_num_threads(max_threads);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        removeAccents(std::string_view(inputs[i]), results[i]);
+    }
+    return results;
+}
@@ -3,6 +3,7 @@
 
 #include <any>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace StringUtils 
@@ -19,6 +20,16 @@ namespace StringUtils
 
     std::string str_details(const std::string& text);
 
+    // Strips Latin diacritics in one pass over the UTF-8 input: precomposed
+    // letters whose canonical decomposition is an ASCII letter plus marks
+    // ("ç" -> "c", "ệ" -> "e"), letters with a stroke ("ø", "ł", "đ") and
+    // standalone combining marks. Everything else is copied as is.
     std::string removeAccents(const std::string &input);
+
+    // Same, appending to `output`.
+    void removeAccents(std::string_view input, std::string &output);
+
+    // Same over many strings, in parallel.
+    std::vector<std::string> removeAccents(const std::vector<std::string> &inputs, int max_workers = 4);
 }
 #endif
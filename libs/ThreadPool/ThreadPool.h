@@ -0,0 +1,173 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace RAGLibrary
+{
+    // Fixed set of worker threads fed from one FIFO queue.
+    //
+    // Submit() returns a future for a single task. ParallelFor() splits an
+    // index range into chunks that workers claim from a shared counter; the
+    // calling thread claims chunks too, so it is safe to call from inside a
+    // task and never waits on a pool that is busy with its own caller.
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency())
+        {
+            threads = std::max<std::size_t>(threads, 1);
+            m_workers.reserve(threads);
+            for (std::size_t i = 0; i < threads; ++i)
+            {
+                m_workers.emplace_back([this]
+                                       { WorkerLoop(); });
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Runs every task already queued, then joins the workers.
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_all();
+            for (auto &w : m_workers)
+            {
+                w.join();
+            }
+        }
+
+        template <typename F, typename... Args>
+        auto Submit(F &&fn, Args &&...args) -> std::future<std::invoke_result_t<F, Args...>>
+        {
+            using R = std::invoke_result_t<F, Args...>;
+            auto task = std::make_shared<std::packaged_task<R()>>(
+                [fn = std::forward<F>(fn), ... args = std::forward<Args>(args)]() mutable
+                { return std::invoke(std::move(fn), std::move(args)...); });
+            auto future = task->get_future();
+            Post([task]
+                 { (*task)(); });
+            return future;
+        }
+
+        // Fire-and-forget; `fn` must not throw.
+        void Post(std::function<void()> fn)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_tasks.push(std::move(fn));
+            }
+            m_cv.notify_one();
+        }
+
+        // Calls fn(i) for every i in [begin, end), `chunk` indices at a time
+        // (0 picks about four chunks per thread), on at most `max_threads`
+        // threads counting the caller (0 for no limit). Blocks until done and
+        // rethrows the first exception after the remaining chunks drain.
+        template <typename F>
+        void ParallelFor(std::size_t begin, std::size_t end, F &&fn, std::size_t chunk = 0, std::size_t max_threads = 0)
+        {
+            if (begin >= end)
+                return;
+            const std::size_t n = end - begin;
+            const std::size_t threads = max_threads == 0 ? m_workers.size() + 1 : std::min(max_threads, m_workers.size() + 1);
+            if (chunk == 0)
+                chunk = std::max<std::size_t>(1, n / (4 * threads));
+            const std::size_t chunks = (n + chunk - 1) / chunk;
+
+            struct State
+            {
+                std::atomic<std::size_t> next{0};
+                std::atomic<std::size_t> done{0};
+                std::exception_ptr error;
+                std::mutex mutex;
+                std::condition_variable cv;
+            };
+            auto state = std::make_shared<State>();
+
+            // Each runner returns once the counter is exhausted; the last
+            // finished chunk wakes the caller.
+            auto run = [state, begin, end, chunk, chunks, &fn]
+            {
+                for (std::size_t c; (c = state->next.fetch_add(1)) < chunks;)
+                {
+                    const std::size_t lo = begin + c * chunk;
+                    const std::size_t hi = std::min(lo + chunk, end);
+                    try
+                    {
+                        for (std::size_t i = lo; i < hi; ++i)
+                            fn(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(state->mutex);
+                        if (!state->error)
+                            state->error = std::current_exception();
+                    }
+                    if (state->done.fetch_add(1) + 1 == chunks)
+                    {
+                        std::lock_guard lock(state->mutex);
+                        state->cv.notify_all();
+                    }
+                }
+            };
+
+            const std::size_t helpers = std::min(threads - 1, chunks - 1);
+            for (std::size_t i = 0; i < helpers; ++i)
+                Post(run);
+            run();
+
+            std::unique_lock lock(state->mutex);
+            state->cv.wait(lock, [&]
+                           { return state->done.load() == chunks; });
+            if (state->error)
+                std::rethrow_exception(state->error);
+        }
+
+        inline std::size_t size(void) const { return m_workers.size(); }
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_stop = false;
+
+        void WorkerLoop()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(m_mutex);
+                    m_cv.wait(lock, [this]
+                              { return m_stop || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                        return;
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop();
+                }
+                task();
+            }
+        }
+    };
+}
+#endif
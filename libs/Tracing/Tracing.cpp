@@ -0,0 +1,285 @@
+#include "Tracing.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+#include "RagException.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point g_epoch = Clock::now();
+    const std::int64_t g_epoch_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::system_clock::now().time_since_epoch())
+                                             .count();
+
+    inline std::uint64_t NowNs()
+    {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - g_epoch).count());
+    }
+
+    // Per-thread ring, grown on demand up to `capacity` events. The mutex is
+    // only ever contended by Collect/Clear.
+    struct Buffer
+    {
+        std::mutex mutex;
+        std::vector<Tracing::Event> ring;
+        std::size_t capacity = 0;
+        std::size_t next = 0;
+        std::uint32_t tid = 0;
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Buffer>> buffers;
+        std::size_t capacity = 1 << 16;
+        std::uint32_t next_tid = 0;
+        std::unordered_set<std::string> names;
+    };
+
+    Registry &GetRegistry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    struct OpenSpan
+    {
+        std::uint64_t id;
+        std::uint64_t trace;
+    };
+
+    struct ThreadState
+    {
+        std::shared_ptr<Buffer> buffer;
+        std::vector<OpenSpan> open; // spans open on this thread, innermost last
+    };
+
+    ThreadState &Local()
+    {
+        thread_local ThreadState s;
+        if (!s.buffer)
+        {
+            auto &reg = GetRegistry();
+            auto b = std::make_shared<Buffer>();
+            std::lock_guard lock(reg.mutex);
+            b->tid = reg.next_tid++;
+            b->capacity = reg.capacity;
+            reg.buffers.push_back(b);
+            s.buffer = std::move(b);
+        }
+        return s;
+    }
+
+    // Unique, non-zero ids: a process-random salt mixed with a counter.
+    std::uint64_t NewId()
+    {
+        static const std::uint64_t salt = std::random_device{}() * 0x9e3779b97f4a7c15ULL ^ std::uint64_t(g_epoch_unix_ns);
+        static std::atomic<std::uint64_t> counter{0};
+        std::uint64_t x = salt + counter.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x ? x : 1;
+    }
+
+    std::string Hex(std::uint64_t x)
+    {
+        static constexpr char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i, x >>= 4)
+            out[i] = digits[x & 0xF];
+        return out;
+    }
+
+    void WriteFile(const std::string &path, const std::string &data)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw RAGLibrary::RagException("Tracing: cannot open " + path + " for writing.");
+        out << data;
+        if (!out)
+            throw RAGLibrary::RagException("Tracing: failed writing " + path + ".");
+    }
+}
+
+void Tracing::Enable(bool on)
+{
+    detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void Tracing::SetBufferCapacity(std::size_t events)
+{
+    auto &reg = GetRegistry();
+    std::lock_guard lock(reg.mutex);
+    reg.capacity = std::max<std::size_t>(events, 1);
+}
+
+// Also forgets the buffers of threads that have exited.
+void Tracing::Clear()
+{
+    auto &reg = GetRegistry();
+    std::lock_guard lock(reg.mutex);
+    std::erase_if(reg.buffers, [](const std::shared_ptr<Buffer> &b)
+                  { return b.use_count() == 1; });
+    for (auto &b : reg.buffers)
+    {
+        std::lock_guard g(b->mutex);
+        std::vector<Event>().swap(b->ring);
+        b->capacity = reg.capacity;
+        b->next = 0;
+    }
+}
+
+std::vector<Tracing::Event> Tracing::Collect()
+{
+    std::vector<Event> out;
+    auto &reg = GetRegistry();
+    std::lock_guard lock(reg.mutex);
+    for (auto &b : reg.buffers)
+    {
+        std::lock_guard g(b->mutex);
+        out.insert(out.end(), b->ring.begin(), b->ring.end());
+    }
+    std::sort(out.begin(), out.end(), [](const Event &a, const Event &b)
+              { return a.start_ns < b.start_ns; });
+    return out;
+}
+
+const char *Tracing::Intern(std::string_view name)
+{
+    auto &reg = GetRegistry();
+    std::lock_guard lock(reg.mutex);
+    return reg.names.emplace(name).first->c_str();
+}
+
+// Allocation failures (thread buffer, open-span stack) leave the span
+// inactive instead of escaping the noexcept constructor.
+void Tracing::Span::Begin(const char *name, const char *category) noexcept
+{
+    try
+    {
+        auto &s = Local();
+        m_id = NewId();
+        m_parent = s.open.empty() ? 0 : s.open.back().id;
+        m_trace = s.open.empty() ? NewId() : s.open.back().trace;
+        s.open.push_back({m_id, m_trace});
+    }
+    catch (...)
+    {
+        return;
+    }
+    m_name = name;
+    m_category = category;
+    m_active = true;
+    m_start = NowNs();
+}
+
+void Tracing::Span::End() noexcept
+{
+    const std::uint64_t end = NowNs();
+    m_active = false;
+    try
+    {
+        auto &s = Local();
+        // Only this span is popped. One ended out of order, or on another
+        // thread (a Python __exit__), must not unwind spans still open there.
+        if (!s.open.empty() && s.open.back().id == m_id)
+            s.open.pop_back();
+        else if (auto it = std::find_if(s.open.begin(), s.open.end(), [this](const OpenSpan &o)
+                                        { return o.id == m_id; });
+                 it != s.open.end())
+            s.open.erase(it);
+
+        Buffer &b = *s.buffer;
+        const Event e{m_name, m_category, m_start, end - m_start, m_trace, m_id, m_parent, b.tid, m_items, m_bytes};
+
+        std::lock_guard g(b.mutex);
+        if (b.ring.size() < b.capacity)
+            b.ring.push_back(e);
+        else
+            b.ring[b.next] = e;
+        b.next = (b.next + 1) % b.capacity;
+    }
+    catch (...)
+    {
+        // The event is dropped.
+    }
+}
+
+std::string Tracing::ChromeTraceJson()
+{
+    nlohmann::json events = nlohmann::json::array();
+    for (const auto &e : Collect())
+    {
+        nlohmann::json args = nlohmann::json::object();
+        if (e.items >= 0)
+            args["items"] = e.items;
+        if (e.bytes >= 0)
+            args["bytes"] = e.bytes;
+        events.push_back({{"name", e.name},
+                          {"cat", e.category},
+                          {"ph", "X"},
+                          {"ts", double(e.start_ns) / 1e3},
+                          {"dur", double(e.dur_ns) / 1e3},
+                          {"pid", 1},
+                          {"tid", e.tid},
+                          {"args", std::move(args)}});
+    }
+    return nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}.dump();
+}
+
+void Tracing::WriteChromeTrace(const std::string &path)
+{
+    WriteFile(path, ChromeTraceJson());
+}
+
+std::string Tracing::OtlpJson(const std::string &service)
+{
+    auto attr_int = [](const char *key, std::int64_t v)
+    {
+        return nlohmann::json{{"key", key}, {"value", {{"intValue", std::to_string(v)}}}};
+    };
+
+    nlohmann::json spans = nlohmann::json::array();
+    for (const auto &e : Collect())
+    {
+        nlohmann::json attrs = nlohmann::json::array();
+        attrs.push_back(attr_int("thread.id", e.tid));
+        attrs.push_back({{"key", "category"}, {"value", {{"stringValue", e.category}}}});
+        if (e.items >= 0)
+            attrs.push_back(attr_int("items", e.items));
+        if (e.bytes >= 0)
+            attrs.push_back(attr_int("bytes", e.bytes));
+
+        const std::int64_t start = g_epoch_unix_ns + std::int64_t(e.start_ns);
+        nlohmann::json span = {{"traceId", Hex(0) + Hex(e.trace_id)},
+                               {"spanId", Hex(e.span_id)},
+                               {"name", e.name},
+                               {"kind", 1},
+                               {"startTimeUnixNano", std::to_string(start)},
+                               {"endTimeUnixNano", std::to_string(start + std::int64_t(e.dur_ns))},
+                               {"attributes", std::move(attrs)}};
+        if (e.parent_id)
+            span["parentSpanId"] = Hex(e.parent_id);
+        spans.push_back(std::move(span));
+    }
+
+    nlohmann::json resource = {{"attributes", nlohmann::json::array({{{"key", "service.name"}, {"value", {{"stringValue", service}}}}})}};
+    nlohmann::json scope = {{"scope", {{"name", "purecpp"}}}, {"spans", std::move(spans)}};
+    return nlohmann::json{{"resourceSpans", nlohmann::json::array({{{"resource", std::move(resource)}, {"scopeSpans", nlohmann::json::array({std::move(scope)})}}})}}.dump();
+}
+
+void Tracing::WriteOtlpJson(const std::string &path, const std::string &service)
+{
+    WriteFile(path, OtlpJson(service));
+}
@@ -0,0 +1,107 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// In-process tracing of pipeline stages (loading, cleaning, chunking,
+// embedding, retrieval, vector store calls).
+//
+// Spans are recorded into a fixed-size ring buffer owned by each thread, so
+// recording never contends with other threads and old events are dropped
+// rather than growing memory. While tracing is disabled a Span costs one
+// relaxed atomic load.
+namespace Tracing
+{
+    struct Event
+    {
+        const char *name;       // static or Intern()ed
+        const char *category;
+        std::uint64_t start_ns; // since process start (steady clock)
+        std::uint64_t dur_ns;
+        std::uint64_t trace_id; // shared by a root span and its descendants
+        std::uint64_t span_id;
+        std::uint64_t parent_id; // 0 for roots
+        std::uint32_t tid;       // small sequential thread number
+        std::int64_t items;      // -1 when not set
+        std::int64_t bytes;      // -1 when not set
+    };
+
+    namespace detail
+    {
+        inline std::atomic<bool> enabled{false};
+    }
+
+    inline bool Enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+    void Enable(bool on = true);
+
+    // Ring size, in events, for buffers created or cleared afterwards.
+    void SetBufferCapacity(std::size_t events);
+    void Clear();
+
+    // Every buffered event, ordered by start time.
+    std::vector<Event> Collect();
+
+    // Chrome trace-event JSON (chrome://tracing, Perfetto).
+    std::string ChromeTraceJson();
+    void WriteChromeTrace(const std::string &path);
+    // OTLP/JSON (ExportTraceServiceRequest), for OpenTelemetry collectors.
+    std::string OtlpJson(const std::string &service = "purecpp");
+    void WriteOtlpJson(const std::string &path, const std::string &service = "purecpp");
+
+    // Stable copy of a dynamic span name; repeated names share storage.
+    const char *Intern(std::string_view name);
+
+    // Total `page_content` size of a range of documents, for Span::SetBytes.
+    template <typename Docs>
+    std::int64_t ContentBytes(const Docs &docs) noexcept
+    {
+        std::int64_t bytes = 0;
+        for (const auto &d : docs)
+            bytes += std::int64_t(d.page_content.size());
+        return bytes;
+    }
+
+    // RAII span; nests with the spans already open on the same thread. A span
+    // that cannot be recorded (out of memory) is silently dropped. Items and
+    // bytes are the stage's volume, e.g. documents and text in, or chunks
+    // and embedding bytes out.
+    class Span
+    {
+    public:
+        explicit Span(const char *name, const char *category = "rag") noexcept
+        {
+            if (Enabled())
+                Begin(name, category);
+        }
+        ~Span()
+        {
+            if (m_active)
+                End();
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        inline void SetItems(std::int64_t n) noexcept { m_items = n; }
+        inline void SetBytes(std::int64_t n) noexcept { m_bytes = n; }
+        inline bool active(void) const noexcept { return m_active; }
+
+    private:
+        const char *m_name = nullptr;
+        const char *m_category = nullptr;
+        std::uint64_t m_start = 0;
+        std::uint64_t m_trace = 0;
+        std::uint64_t m_id = 0;
+        std::uint64_t m_parent = 0;
+        std::int64_t m_items = -1;
+        std::int64_t m_bytes = -1;
+        bool m_active = false;
+
+        void Begin(const char *name, const char *category) noexcept;
+        void End() noexcept;
+    };
+}
+#endif
@@ -0,0 +1,250 @@
+#ifndef VECTOR_UTILS_QUANTIZE_H
+#define VECTOR_UTILS_QUANTIZE_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace VectorUtils
+{
+    // Scalar storage formats for embeddings and the kernels scoring a float
+    // query directly against them. Rows are never expanded to float32 in
+    // memory: each kernel widens one register of codes at a time.
+
+    // ---- conversions ------------------------------------------------------
+
+    // IEEE binary16 -> float32, subnormals and NaN payloads included.
+    inline float half_to_float(std::uint16_t h) noexcept
+    {
+        const std::uint32_t sign = std::uint32_t(h & 0x8000u) << 16;
+        std::uint32_t exp = (h >> 10) & 0x1fu;
+        std::uint32_t mant = h & 0x3ffu;
+        std::uint32_t bits;
+        if (exp == 0)
+        {
+            if (mant == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                exp = 113;
+                while (!(mant & 0x400u))
+                {
+                    mant <<= 1;
+                    --exp;
+                }
+                bits = sign | (exp << 23) | ((mant & 0x3ffu) << 13);
+            }
+        }
+        else if (exp == 0x1f)
+        {
+            bits = sign | 0x7f800000u | (mant << 13);
+        }
+        else
+        {
+            bits = sign | ((exp + 112) << 23) | (mant << 13);
+        }
+        return std::bit_cast<float>(bits);
+    }
+
+    // float32 -> IEEE binary16 with round-to-nearest-even; overflow saturates to inf.
+    inline std::uint16_t float_to_half(float f) noexcept
+    {
+        std::uint32_t x = std::bit_cast<std::uint32_t>(f);
+        const std::uint16_t sign = std::uint16_t((x >> 16) & 0x8000u);
+        x &= 0x7fffffffu;
+        if (x >= 0x7f800000u)
+            return std::uint16_t(sign | 0x7c00u | (x > 0x7f800000u ? 0x200u : 0u));
+        if (x >= 0x477ff000u)
+            return std::uint16_t(sign | 0x7c00u);
+        if (x < 0x38800000u)
+        {
+            // Result is subnormal (or zero): value = r * 2^-24.
+            if (x < 0x33000000u)
+                return sign;
+            const std::uint32_t e = x >> 23;
+            const std::uint32_t m = (x & 0x7fffffu) | 0x800000u;
+            const std::uint32_t shift = 126 - e;
+            std::uint32_t r = m >> shift;
+            const std::uint32_t rem = m & ((1u << shift) - 1);
+            const std::uint32_t half = 1u << (shift - 1);
+            if (rem > half || (rem == half && (r & 1u)))
+                ++r;
+            return std::uint16_t(sign | r);
+        }
+        std::uint32_t r = (x - 0x38000000u) >> 13;
+        const std::uint32_t rem = x & 0x1fffu;
+        if (rem > 0x1000u || (rem == 0x1000u && (r & 1u)))
+            ++r;
+        return std::uint16_t(sign | r);
+    }
+
+    inline float bf16_to_float(std::uint16_t b) noexcept
+    {
+        return std::bit_cast<float>(std::uint32_t(b) << 16);
+    }
+
+    // float32 -> bfloat16 with round-to-nearest-even; NaN stays NaN.
+    inline std::uint16_t float_to_bf16(float f) noexcept
+    {
+        const std::uint32_t x = std::bit_cast<std::uint32_t>(f);
+        if ((x & 0x7fffffffu) > 0x7f800000u)
+            return std::uint16_t((x >> 16) | 0x40u);
+        return std::uint16_t((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+    }
+
+    // Symmetric per-vector int8: out[i] = round(x[i] / scale), scale = max|x| / 127.
+    // Returns the scale (0 for an all-zero row).
+    inline float quantize_i8(const float *x, std::size_t n, std::int8_t *out) noexcept
+    {
+        float amax = 0.0f;
+        for (std::size_t i = 0; i < n; ++i)
+            amax = std::max(amax, std::fabs(x[i]));
+        const float scale = amax / 127.0f;
+        const float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = static_cast<std::int8_t>(std::clamp(std::lrint(x[i] * inv), -127L, 127L));
+        return scale;
+    }
+
+    // ---- dot products: float query x stored row --------------------------
+
+#if defined(__AVX2__)
+    inline float hsum256(__m256 v) noexcept
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+    }
+#endif
+
+    // Unscaled: multiply by the row scale to get the float dot product.
+    inline float dot_i8(const float *a, const std::int8_t *b, std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        float sum = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(raw));
+            const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(raw, 8)));
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), lo));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), hi));
+        }
+        sum = hsum256(_mm256_add_ps(acc0, acc1));
+#endif
+#pragma omp simd reduction(+ : sum)
+        for (std::size_t t = i; t < n; ++t)
+        {
+            sum += a[t] * static_cast<float>(b[t]);
+        }
+        return sum;
+    }
+
+    inline float dot_bf16(const float *a, const std::uint16_t *b, std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        float sum = 0.0f;
+#if defined(__AVX2__)
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+            const __m256 bv = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(raw), 16));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), bv));
+        }
+        sum = hsum256(acc);
+#endif
+        for (; i < n; ++i)
+        {
+            sum += a[i] * bf16_to_float(b[i]);
+        }
+        return sum;
+    }
+
+    inline float dot_f16(const float *a, const std::uint16_t *b, std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        float sum = 0.0f;
+#if defined(__AVX2__) && defined(__F16C__)
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m256 bv = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), bv));
+        }
+        sum = hsum256(acc);
+#endif
+        for (; i < n; ++i)
+        {
+            sum += a[i] * half_to_float(b[i]);
+        }
+        return sum;
+    }
+
+    // ---- 1-bit sign codes -------------------------------------------------
+
+    inline std::size_t binary_words(std::size_t n) noexcept
+    {
+        return (n + 63) / 64;
+    }
+
+    // Bit i of the code is set when x[i] > center[i] (0 without a center);
+    // `out` holds binary_words(n) words. Embeddings are rarely zero-mean, so
+    // centering on the corpus mean keeps the bits informative.
+    inline void binarize(const float *x, std::size_t n, std::uint64_t *out, const float *center = nullptr) noexcept
+    {
+        for (std::size_t w = 0; w < binary_words(n); ++w)
+        {
+            std::uint64_t word = 0;
+            const std::size_t end = std::min(n, (w + 1) * 64);
+            for (std::size_t i = w * 64; i < end; ++i)
+                word |= std::uint64_t(x[i] > (center ? center[i] : 0.0f)) << (i - w * 64);
+            out[w] = word;
+        }
+    }
+
+    // Number of differing bits; proportional to the angle between the
+    // original vectors in expectation.
+    inline std::uint32_t hamming(const std::uint64_t *a, const std::uint64_t *b, std::size_t words) noexcept
+    {
+        std::size_t i = 0;
+        std::uint64_t total = 0;
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+        __m512i acc = _mm512_setzero_si512();
+        for (; i + 8 <= words; i += 8)
+        {
+            const __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+        total = static_cast<std::uint64_t>(_mm512_reduce_add_epi64(acc));
+#elif defined(__ARM_NEON)
+        uint64x2_t acc = vdupq_n_u64(0);
+        for (; i + 2 <= words; i += 2)
+        {
+            const uint8x16_t x = veorq_u8(vld1q_u8(reinterpret_cast<const std::uint8_t *>(a + i)),
+                                          vld1q_u8(reinterpret_cast<const std::uint8_t *>(b + i)));
+            acc = vpadalq_u32(acc, vpaddlq_u16(vpaddlq_u8(vcntq_u8(x))));
+        }
+        total = vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+#endif
+        for (; i < words; ++i)
+            total += static_cast<std::uint64_t>(std::popcount(a[i] ^ b[i]));
+        return static_cast<std::uint32_t>(total);
+    }
+}
+#endif
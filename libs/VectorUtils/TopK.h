@@ -0,0 +1,75 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace VectorUtils
+{
+    // Bounded selection of the k highest scores in O(n log k).
+    // The heap keeps the worst retained entry at the front so every candidate
+    // is either rejected with one comparison or replaces it.
+    // Callers ranking by distance push the negated distance.
+    template <typename Id = std::size_t>
+    class TopK
+    {
+    public:
+        using Entry = std::pair<Id, float>;
+
+        explicit TopK(std::size_t k) : m_k(k) {}
+
+        std::size_t capacity() const noexcept { return m_k; }
+        std::size_t size() const noexcept { return m_heap.size(); }
+        bool full() const noexcept { return m_heap.size() >= m_k; }
+
+        // Lowest score still retained once the heap is full, -inf before that.
+        float threshold() const noexcept
+        {
+            return full() && !m_heap.empty() ? m_heap.front().second : -std::numeric_limits<float>::infinity();
+        }
+
+        bool push(Id id, float score)
+        {
+            if (m_k == 0)
+                return false;
+            if (!full())
+            {
+                m_heap.emplace_back(id, score);
+                std::push_heap(m_heap.begin(), m_heap.end(), Better);
+                return true;
+            }
+            if (!Better({id, score}, m_heap.front()))
+                return false;
+            std::pop_heap(m_heap.begin(), m_heap.end(), Better);
+            m_heap.back() = {id, score};
+            std::push_heap(m_heap.begin(), m_heap.end(), Better);
+            return true;
+        }
+
+        void merge(const TopK &other)
+        {
+            for (const auto &[id, score] : other.m_heap)
+                push(id, score);
+        }
+
+        // Drains the heap into a list ordered by descending score (ties by id).
+        std::vector<Entry> sorted()
+        {
+            std::sort_heap(m_heap.begin(), m_heap.end(), Better);
+            return std::move(m_heap);
+        }
+
+    private:
+        static bool Better(const Entry &a, const Entry &b) noexcept
+        {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        }
+
+        std::size_t m_k;
+        std::vector<Entry> m_heap;
+    };
+}
+#endif
@@ -0,0 +1,151 @@
+#ifndef VECTOR_UTILS_H
+#define VECTOR_UTILS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace VectorUtils
+{
+    // Dense float kernels shared by the retrieval paths. They are written as plain
+    // reductions so that `omp simd` lets the compiler emit packed FMA code for the
+    // target ISA instead of going through a tensor library per row.
+    inline float dot(const float *a, const float *b, std::size_t n) noexcept
+    {
+        float sum = 0.0f;
+#pragma omp simd reduction(+ : sum)
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    inline float l2sq(const float *a, const float *b, std::size_t n) noexcept
+    {
+        float sum = 0.0f;
+#pragma omp simd reduction(+ : sum)
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const float d = a[i] - b[i];
+            sum += d * d;
+        }
+        return sum;
+    }
+
+    inline float norm(const float *a, std::size_t n) noexcept
+    {
+        return std::sqrt(dot(a, a, n));
+    }
+
+    // C (rows x cols, row-major) = A (rows x d) * B (cols x d)^T.
+    // Four rows of A are scored against each row of B at once so every B row
+    // is loaded once per four A rows; callers tile `rows`/`cols` so that the
+    // B block stays cache resident while A is streamed exactly once.
+    inline void gemm_nt(const float *A, std::size_t rows, const float *B, std::size_t cols, std::size_t d, float *C) noexcept
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= rows; i += 4)
+        {
+            const float *a0 = A + i * d;
+            const float *a1 = a0 + d;
+            const float *a2 = a1 + d;
+            const float *a3 = a2 + d;
+            for (std::size_t j = 0; j < cols; ++j)
+            {
+                const float *b = B + j * d;
+                float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+#pragma omp simd reduction(+ : s0, s1, s2, s3)
+                for (std::size_t t = 0; t < d; ++t)
+                {
+                    const float bv = b[t];
+                    s0 += a0[t] * bv;
+                    s1 += a1[t] * bv;
+                    s2 += a2[t] * bv;
+                    s3 += a3[t] * bv;
+                }
+                C[i * cols + j] = s0;
+                C[(i + 1) * cols + j] = s1;
+                C[(i + 2) * cols + j] = s2;
+                C[(i + 3) * cols + j] = s3;
+            }
+        }
+        for (; i < rows; ++i)
+        {
+            for (std::size_t j = 0; j < cols; ++j)
+            {
+                C[i * cols + j] = dot(A + i * d, B + j * d, d);
+            }
+        }
+    }
+
+    // Cosine similarity given a precomputed norm for each side; zero vectors score 0.
+    inline float cosine(const float *a, float norm_a, const float *b, float norm_b, std::size_t n) noexcept
+    {
+        const float denom = norm_a * norm_b;
+        return denom > 0.0f ? dot(a, b, n) / denom : 0.0f;
+    }
+
+    // Asymmetric distance computation for product-quantized codes.
+    // `codes` holds n rows of m bytes, `lut` holds m tables of 256 partial
+    // scores; out[i] = bias + sum_j lut[j * 256 + codes[i * m + j]].
+    // With AVX2 eight rows are accumulated per gather, otherwise four rows are
+    // interleaved so the table lookups of independent rows overlap.
+    inline void adc_scan(const std::uint8_t *codes, std::size_t n, std::size_t m, const float *lut, float bias, float *out) noexcept
+    {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i stride = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i row_step = _mm256_mullo_epi32(stride, _mm256_set1_epi32(static_cast<int>(m)));
+        // The 4-byte gather of row i+7 reads up to three bytes into row i+8, so
+        // the final block of a list is always left to the scalar loops below.
+        for (; m >= 3 && i + 9 <= n; i += 8)
+        {
+            const std::uint8_t *c = codes + i * m;
+            __m256 acc = _mm256_set1_ps(bias);
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                // Byte j of each of the eight rows, widened to table offsets.
+                const __m256i raw = _mm256_i32gather_epi32(reinterpret_cast<const int *>(c + j), row_step, 1);
+                const __m256i idx = _mm256_add_epi32(_mm256_and_si256(raw, _mm256_set1_epi32(0xff)),
+                                                     _mm256_set1_epi32(static_cast<int>(j * 256)));
+                acc = _mm256_add_ps(acc, _mm256_i32gather_ps(lut, idx, 4));
+            }
+            _mm256_storeu_ps(out + i, acc);
+        }
+#endif
+        for (; i + 4 <= n; i += 4)
+        {
+            const std::uint8_t *c0 = codes + i * m;
+            const std::uint8_t *c1 = c0 + m;
+            const std::uint8_t *c2 = c1 + m;
+            const std::uint8_t *c3 = c2 + m;
+            float s0 = bias, s1 = bias, s2 = bias, s3 = bias;
+            for (std::size_t j = 0; j < m; ++j)
+            {
+                const float *t = lut + j * 256;
+                s0 += t[c0[j]];
+                s1 += t[c1[j]];
+                s2 += t[c2[j]];
+                s3 += t[c3[j]];
+            }
+            out[i] = s0;
+            out[i + 1] = s1;
+            out[i + 2] = s2;
+            out[i + 3] = s3;
+        }
+        for (; i < n; ++i)
+        {
+            const std::uint8_t *c = codes + i * m;
+            float s = bias;
+            for (std::size_t j = 0; j < m; ++j)
+                s += lut[j * 256 + c[j]];
+            out[i] = s;
+        }
+    }
+}
+#endif
@@ -0,0 +1,64 @@
+#!/bin/bash
+# Profile-guided build of RagPUREAI.
+#
+#   1. build an instrumented module (PURECPP_PGO=GENERATE)
+#   2. run a training workload that exercises the hot paths
+#   3. rebuild the same tree from the recorded profiles (PURECPP_PGO=USE)
+#
+# The default workload is the benchmark suite (bench/, BUILD_BENCHMARKS=ON).
+# Set PGO_TRAIN_CMD to train on something else instead, e.g. a Python
+# script that imports the instrumented module from build/Release:
+#
+#   PGO_TRAIN_CMD="python3 my_pipeline.py" ./scripts/pgo_build.sh
+#
+# Any extra arguments are forwarded to both cmake configure steps
+# (e.g. -DPURECPP_ARCH=x86-64-v3).
+set -e
+set -x
+
+BUILD_DIR=build/Release
+PGO_DIR=${PGO_DIR:-$(pwd)/build/pgo}
+TRAIN_FILTER=${PGO_TRAIN_FILTER:-.}
+
+configure() {
+  cmake \
+    --preset conan-release \
+    -DCMAKE_POLICY_DEFAULT_CMP0091=NEW \
+    -DCMAKE_POLICY_VERSION_MINIMUM=3.5 \
+    -DSPM_USE_BUILTIN_PROTOBUF=OFF \
+    -DBUILD_BENCHMARKS=ON \
+    -DPURECPP_PGO_DIR="${PGO_DIR}" \
+    -G "Unix Makefiles" \
+    "$@"
+}
+
+build() {
+  cmake --build --preset conan-release --parallel $(nproc) --target "$1" --
+}
+
+conan install . --build=missing
+
+# 1. Instrumented build; profiles from an earlier run would be stale.
+rm -rf "${PGO_DIR}"
+configure -DPURECPP_PGO=GENERATE "$@"
+build RagPUREAI
+if [ -z "${PGO_TRAIN_CMD}" ]; then
+  build purecpp_bench
+fi
+
+# 2. Training run.
+if [ -n "${PGO_TRAIN_CMD}" ]; then
+  PYTHONPATH="${BUILD_DIR}:${PYTHONPATH}" bash -c "${PGO_TRAIN_CMD}"
+else
+  "${BUILD_DIR}/bench/purecpp_bench" --benchmark_filter="${TRAIN_FILTER}" --benchmark_min_time=0.2s
+fi
+
+# Clang writes raw profiles that have to be merged first; GCC reads its
+# .gcda files directly.
+if compgen -G "${PGO_DIR}/*.profraw" > /dev/null; then
+  llvm-profdata merge -output="${PGO_DIR}/purecpp.profdata" "${PGO_DIR}"/*.profraw
+fi
+
+# 3. Optimized rebuild in the same tree (GCC matches profiles by object path).
+configure -DPURECPP_PGO=USE "$@"
+build RagPUREAI
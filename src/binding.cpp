@@ -21,6 +21,7 @@
 #include "RagException.h"
 #include "ThreadSafeQueue.h"
 #include "StringUtils.h"
+#include "Tracing.h"
 #include "FileUtilsLocal.h"
 #include "CommonStructs.h"
 
@@ -119,8 +120,66 @@ void bind_StringUtils(py::module &m)
 
     m.def("str_details", &StringUtils::str_details, py::arg("text"),
           "Returns details of the provided string.");
-    m.def("removeAccents", &StringUtils::removeAccents, py::arg("input"),
+    m.def("removeAccents", py::overload_cast<const std::string &>(&StringUtils::removeAccents), py::arg("input"),
           "Removes accents from the provided string.");
+    m.def("removeAccents", py::overload_cast<const std::vector<std::string> &, int>(&StringUtils::removeAccents),
+          py::arg("inputs"), py::arg("max_workers") = 4,
+          py::call_guard<py::gil_scoped_release>(),
+          "Removes accents from each string in the list, in parallel.");
+}
+//--------------------------------------------------------------------------
+// Binding function for Tracing
+//--------------------------------------------------------------------------
+// Context manager around Tracing::Span; names are interned so the span can
+// outlive the Python string.
+class PyTraceSpan
+{
+public:
+    PyTraceSpan(const std::string &name, const std::string &category)
+        : m_name(Tracing::Intern(name)), m_category(Tracing::Intern(category)) {}
+
+    PyTraceSpan &Enter()
+    {
+        m_span.emplace(m_name, m_category);
+        return *this;
+    }
+    void Exit(const py::object &, const py::object &, const py::object &) { m_span.reset(); }
+    void SetItems(int64_t n)
+    {
+        if (m_span) m_span->SetItems(n);
+    }
+    void SetBytes(int64_t n)
+    {
+        if (m_span) m_span->SetBytes(n);
+    }
+
+private:
+    const char *m_name;
+    const char *m_category;
+    std::optional<Tracing::Span> m_span;
+};
+
+void bind_Tracing(py::module &m)
+{
+    m.def("enable_tracing", &Tracing::Enable, py::arg("on") = true,
+          "Starts (or stops) recording pipeline spans.");
+    m.def("tracing_enabled", &Tracing::Enabled);
+    m.def("set_trace_buffer_capacity", &Tracing::SetBufferCapacity, py::arg("events"),
+          "Per-thread ring size, in spans, for buffers created or cleared afterwards.");
+    m.def("clear_traces", &Tracing::Clear);
+    m.def("chrome_trace_json", &Tracing::ChromeTraceJson);
+    m.def("write_chrome_trace", &Tracing::WriteChromeTrace, py::arg("path"),
+          "Writes the recorded spans as Chrome trace-event JSON (chrome://tracing, Perfetto).");
+    m.def("otlp_trace_json", &Tracing::OtlpJson, py::arg("service") = "purecpp");
+    m.def("write_otlp_trace", &Tracing::WriteOtlpJson, py::arg("path"), py::arg("service") = "purecpp",
+          "Writes the recorded spans as OTLP/JSON for OpenTelemetry collectors.");
+
+    py::class_<PyTraceSpan>(m, "TraceSpan")
+        .def(py::init<const std::string &, const std::string &>(), py::arg("name"), py::arg("category") = "python")
+        .def("__enter__", &PyTraceSpan::Enter, py::return_value_policy::reference_internal)
+        .def("__exit__", &PyTraceSpan::Exit)
+        .def("set_items", &PyTraceSpan::SetItems, py::arg("n"))
+        .def("set_bytes", &PyTraceSpan::SetBytes, py::arg("n"));
 }
 //--------------------------------------------------------------------------
 // Template for ThreadSafeQueue.
@@ -329,7 +388,7 @@ void bind_BaseDataLoader(py::module &m)
 {
     py::class_<BaseDataLoader, PyBaseDataLoader, std::shared_ptr<BaseDataLoader>, IBaseDataLoader>(m, "BaseDataLoader")
         .def(py::init<unsigned int>(), py::arg("threadsNum"))
-        .def("Load", &BaseDataLoader::Load)
+        .def("Load", &BaseDataLoader::Load, py::call_guard<py::gil_scoped_release>())
         .def("KeywordExists", &BaseDataLoader::KeywordExists, py::arg("pdfFileName"), py::arg("keyword"))
         .def("GetKeywordOccurences", &BaseDataLoader::GetKeywordOccurences, py::arg("keyword"));
 }
@@ -338,6 +397,22 @@ void bind_BaseDataLoader(py::module &m)
 // Binding for ContentCleaner.
 //--------------------------------------------------------------------------
 typedef std::vector<std::pair<std::string, std::string>> test_vec_pair;
+
+// Read-only [n, dim] view of an element's float rows, without copying. The
+// array's base is a capsule holding a reference to the rows' owner (the
+// shared array or the store mapping), so Quantize, clear and Load only drop
+// the element's reference and the view stays valid.
+py::array_t<float> FloatRowsView(const Chunk::vdb_data &d)
+{
+    auto owner = std::make_unique<std::shared_ptr<const void>>(d.f32Owner());
+    py::capsule base(owner.get(), [](void *p)
+                     { delete static_cast<std::shared_ptr<const void> *>(p); });
+    owner.release();
+    py::array_t<float> a({d.n, d.dim}, {sizeof(float) * d.dim, sizeof(float)}, d.f32Data(), base);
+    a.attr("setflags")(false);
+    return a;
+}
+
 void bind_ChunkCommons(py::module& m)
 {
     //--------------------------------------------------------------------------
@@ -354,22 +429,40 @@ void bind_ChunkCommons(py::module& m)
     m.def("resolve_vendor_from_model", &Chunk::resolve_vendor_from_model);
     m.def("resolve_vendor", &Chunk::resolve_vendor);
     m.def("to_lowercase", &Chunk::to_lowercase);
+    py::enum_<Chunk::StorageType>(m, "StorageType")
+        .value("FP32", Chunk::StorageType::FP32)
+        .value("FP16", Chunk::StorageType::FP16)
+        .value("BF16", Chunk::StorageType::BF16)
+        .value("INT8", Chunk::StorageType::INT8)
+        .export_values();
+
     py::class_<Chunk::vdb_data>(m, "VDBdata", R"doc(
             Represents an entry in the Vector DataBase.
 
             Attributes:
-                flatVD (List[float]): Flat vector of embeddings.
+                flatVD (List[float]): Flat vector of embeddings (empty once quantized without keep_float).
+                storage (StorageType): Element type scanned at query time.
                 vendor (str): Vendor used.
                 model (str): Model name.
                 dim (int): Embedding dimension.
                 n (int): Number of chunks.
         )doc")
     .def(py::init<>())
-    .def_readwrite("flatVD", &Chunk::vdb_data::flatVD)
+    .def_property("flatVD",
+        [](const Chunk::vdb_data &d) { return d.flatVD ? *d.flatVD : std::vector<float>{}; },
+        [](Chunk::vdb_data &d, std::vector<float> flat) { d.flatVD = std::make_shared<const std::vector<float>>(std::move(flat)); })
+    .def_readonly("storage", &Chunk::vdb_data::storage)
     .def_readwrite("vendor", &Chunk::vdb_data::vendor)
     .def_readwrite("model", &Chunk::vdb_data::model)
     .def_readwrite("dim", &Chunk::vdb_data::dim)
-    .def_readwrite("n", &Chunk::vdb_data::n);
+    .def_readwrite("n", &Chunk::vdb_data::n)
+    .def("bytes", &Chunk::vdb_data::bytes, "Memory held by the stored embeddings, in bytes.")
+    .def("as_array", [](const Chunk::vdb_data &d) -> py::object {
+            const float *data = d.f32Data();
+            if (data == nullptr) return py::none();
+            return FloatRowsView(d);
+        },
+        "Read-only [n, dim] float32 view of the embeddings (no copy), or None when no float copy is kept.");
 
 
     //--------------------------------------------------------------------------
@@ -405,6 +498,7 @@ void bind_ChunkCommons(py::module& m)
     // Binding function for EmbeddingModelBatch
     //--------------------------------------------------------------------------
     m.def("EmbeddingModelBatch", &Chunk::EmbeddingModelBatch,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("chunks"), py::arg("model"), py::arg("batch_size") = 32,
         R"doc(
                Generates embeddings for a batch of chunks using a specified model.
@@ -418,10 +512,30 @@ void bind_ChunkCommons(py::module& m)
                    list[list[float]]: List of lists of embeddings.
            )doc");
  
+    //--------------------------------------------------------------------------
+    // Binding function for EmbeddingModelPooled
+    //--------------------------------------------------------------------------
+    m.def("EmbeddingModelPooled", &Chunk::EmbeddingModelPooled,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("chunks"), py::arg("model"), py::arg("batch_size") = 32,
+        R"doc(
+               Generates one mean-pooled, L2-normalized embedding per chunk
+               using a specified model.
+
+               Parameters:
+                   chunks (list[str]): List of strings to be embedded.
+                   model (str): Name of the model to be used.
+                   batch_size (int, optional): Batch size (default=32).
+
+               Returns:
+                   list[list[float]]: One embedding per chunk.
+           )doc");
+ 
     //--------------------------------------------------------------------------
     // Binding function for EmbeddingHuggingFaceTransformers
     //--------------------------------------------------------------------------
     m.def("EmbeddingHuggingFaceTransformers", &Chunk::EmbeddingHuggingFaceTransformers,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("chunks"),
         R"doc(
                Generates embeddings using the HuggingFace model 'sentence-transformers/all-MiniLM-L6-v2'.
@@ -437,6 +551,7 @@ void bind_ChunkCommons(py::module& m)
     // Binding function for EmbeddingOpeanAI
     //--------------------------------------------------------------------------
     m.def("EmbeddingOpeanAI", &Chunk::EmbeddingOpeanAI,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("chunks"), py::arg("openai_api_key"),
         R"doc(
                Generates embeddings using the OpenAI API.
@@ -468,6 +583,7 @@ void bind_ChunkCommons(py::module& m)
     // Binding function for SplitText
     //--------------------------------------------------------------------------
     m.def("SplitText", &Chunk::SplitText,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("inputs"), py::arg("overlap"), py::arg("chunk_size"),
         R"doc(
                Splits text into chunks with overlap.
@@ -485,6 +601,7 @@ void bind_ChunkCommons(py::module& m)
     // Binding for the function SplitTextByCount
     //--------------------------------------------------------------------------
     m.def("SplitTextByCount", &Chunk::SplitTextByCount,
+        py::call_guard<py::gil_scoped_release>(),
         py::arg("inputs"), py::arg("overlap"), py::arg("count_threshold"), py::arg("regex"),
         R"doc(
                Splits text into chunks based on a count and a regex.
@@ -510,20 +627,72 @@ void bind_ChunkDefault(py::module& m)
              py::arg("chunk_size") = 100,
              py::arg("overlap") = 20,
              py::arg("items_opt") = std::nullopt,
-             py::arg("max_workers") = 4)
+             py::arg("max_workers") = 4,
+             py::call_guard<py::gil_scoped_release>())
 
         .def("ProcessDocuments", &Chunk::ChunkDefault::ProcessDocuments,
              py::arg("items_opt") = std::nullopt,
              py::arg("max_workers") = 4,
+             py::call_guard<py::gil_scoped_release>(),
              "Processes a list of documents into chunks.")
 
+        .def("Deduplicate", &Chunk::ChunkDefault::Deduplicate,
+             py::arg("threshold") = 0.8f,
+             py::arg("link") = false,
+             py::arg("max_workers") = 4,
+             py::call_guard<py::gil_scoped_release>(),
+             "Drops (or, with link=True, tags with 'duplicate_of') duplicate and near-duplicate chunks before embedding. Returns the number of duplicates.")
+
         .def("CreateEmb", &Chunk::ChunkDefault::CreateEmb,
              py::arg("model") = "text-embedding-ada-002",
              py::return_value_policy::reference,
+             py::call_guard<py::gil_scoped_release>(),
              "Creates and stores embeddings for the current chunks.")
 
+        .def("AddEmb", &Chunk::ChunkDefault::AddEmb,
+             py::arg("model"),
+             py::arg("flat"),
+             py::arg("dim"),
+             py::return_value_policy::reference,
+             py::call_guard<py::gil_scoped_release>(),
+             "Stores precomputed embeddings (one row of dim floats per chunk, in chunk order) as a new element.")
+
+        .def("Quantize", &Chunk::ChunkDefault::Quantize,
+             py::arg("pos"),
+             py::arg("type"),
+             py::arg("keep_float") = false,
+             py::arg("max_workers") = 4,
+             py::return_value_policy::reference,
+             py::call_guard<py::gil_scoped_release>(),
+             "Re-encodes the embeddings at pos as FP16/BF16/INT8; keep_float retains the float copy for re-ranking.")
+
+        .def("BuildBinaryIndex", &Chunk::ChunkDefault::BuildBinaryIndex,
+             py::arg("pos"),
+             py::arg("max_workers") = 4,
+             py::return_value_policy::reference,
+             py::call_guard<py::gil_scoped_release>(),
+             "Builds the 1-bit sign codes used by SearchMode.Binary.")
+
+        .def("Save", &Chunk::ChunkDefault::Save,
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Writes chunks, metadata, the BM25 index and all embeddings to a binary chunk store.")
+
+        .def("Load", &Chunk::ChunkDefault::Load,
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>(),
+             "Opens a chunk store written by Save; embeddings are memory-mapped, not copied.")
+
+        .def("SearchLexical", [](const Chunk::ChunkDefault &self, const std::string &query, size_t k) {
+                return self.getLexicalIndex().Search(query, k);
+             },
+             py::arg("query"),
+             py::arg("k") = 10,
+             py::call_guard<py::gil_scoped_release>(),
+             "BM25 keyword search over the chunks; returns top-k (index, score).")
+
         .def("getflatVD", [](const Chunk::ChunkDefault &self, size_t idx) {
-            const auto &vec = self.getFlatVD(idx);
+            const auto vec = self.getFlatVD(idx);
             const auto *elem = self.getElement(idx);
             if (!elem) throw std::out_of_range("Invalid index for get_flat_vd");
 
@@ -531,14 +700,9 @@ void bind_ChunkDefault(py::module& m)
             size_t dim = elem->dim;
             if (vec.size() != n * dim) throw std::runtime_error("Inconsistency in the flattened vector.");
 
-            return py::array_t<float>(
-                {n, dim},
-                {sizeof(float) * dim, sizeof(float)},
-                vec.data(),
-                py::cast(self)
-            );
+            return FloatRowsView(*elem);
         }, py::arg("idx"),
-        "Returns the flattened vector as a numpy array [n, dim].")
+        "Returns the flattened vector as a read-only numpy array [n, dim] without copying.")
 
         .def("printVD", &Chunk::ChunkDefault::printVD)
         .def("clear", &Chunk::ChunkDefault::clear)
@@ -560,7 +724,8 @@ void bind_ChunkCount(py::module& m)
         .def("ProcessSingleDocument", &Chunk::ChunkCount::ProcessSingleDocument, py::arg("item"))
  
         .def("ProcessDocuments", &Chunk::ChunkCount::ProcessDocuments,
-            py::arg("items"), py::arg("max_workers") = 4);
+            py::arg("items"), py::arg("max_workers") = 4,
+            py::call_guard<py::gil_scoped_release>());
 }
  
 // --------------------------------------------------------------------------
@@ -571,34 +736,39 @@ void bind_ChunkSimilarity(py::module& m)
 {
  
     py::class_<Chunk::ChunkSimilarity>(m, "ChunkSimilarity", R"doc(
-        Class to process RAGDocuments and generate chunks and embeddings,
-        allowing for document similarity assessment. It has options to
-        define chunk size, overlap, embedding model (HuggingFace or OpenAI),
-        and an API key for OpenAI if needed.
+        Semantic chunker. Documents are split into sentences, all sentences
+        are embedded in one batch (HuggingFace or OpenAI), and a chunk ends
+        where neighbouring sentences drift apart in meaning or where it would
+        exceed chunk_size characters.
     )doc")
         .def(
-            py::init<int, int, std::string, const std::string&>(),
+            py::init<int, int, std::string, const std::string&, float>(),
             py::arg("chunk_size") = 100,
             py::arg("overlap") = 20,
             py::arg("embedding_model") = "openai",
             py::arg("openai_api_key") = "",
+            py::arg("breakpoint_percentile") = 90.0f,
             R"doc(
                 Constructor that initializes the ChunkSimilarity class.
 
                 Parameters:
-                    chunk_size (int): Default size of each text chunk (default=100).
-                    overlap (int): Overlap between successive chunks (default=20).
+                    chunk_size (int): Maximum chunk length in characters (default=100).
+                    overlap (int): Overlap between the windows a sentence longer
+                        than chunk_size is split into (default=20).
                     embedding_model (EmbeddingModel): Embedding model (HuggingFace or OpenAI).
                     openai_api_key (str): OpenAI API key (only if embedding_model=OpenAI).
+                    breakpoint_percentile (float): A chunk ends where the cosine
+                        distance between neighbouring sentences is above this
+                        percentile of the document's distances (default=90).
             )doc")
         .def(
             "ProcessSingleDocument",
             &Chunk::ChunkSimilarity::ProcessSingleDocument,
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("item"),
             R"doc(
-                Given a single RAGDocument, splits its content into chunks
-                and generates embeddings according to the chosen model, returning
-                a vector of RAGLibrary::Document.
+                Given a single RAGDocument, splits its content into semantic
+                chunks, returning a vector of RAGLibrary::Document in text order.
 
                 Parameters:
                     item (RAGDocument): Structure containing
@@ -606,17 +776,18 @@ void bind_ChunkSimilarity(py::module& m)
 
                 Returns:
                     list[RAGDocument]: Vector of resulting documents,
-                    each with its chunked content and possibly
-                    with associated embeddings in its metadata.
+                    each with its chunked content and the item's metadata.
             )doc")
         .def(
             "ProcessDocuments",
             &Chunk::ChunkSimilarity::ProcessDocuments,
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("items"),
             py::arg("max_workers") = 4,
             R"doc(
                 Similar to ProcessSingleDocument, but processes multiple
-                RAGDocuments in parallel (up to max_workers).
+                RAGDocuments in parallel (up to max_workers). The sentences of
+                all items are embedded together in batched requests.
 
                 Parameters:
                     items (list[RAGDocument]): List of
@@ -626,7 +797,7 @@ void bind_ChunkSimilarity(py::module& m)
 
                 Returns:
                     list[RAGDocument]: Concatenated list of documents
-                    resulting from the chunking of each item.
+                    resulting from the chunking of each item, in item order.
             )doc");
 }
 //--------------------------------------------------------------------------
@@ -634,6 +805,16 @@ void bind_ChunkSimilarity(py::module& m)
 //--------------------------------------------------------------------------
 
 void bind_ChunkQuery(py::module_& m) {
+    py::enum_<Chunk::SearchMode>(m, "SearchMode")
+        .value("Exact", Chunk::SearchMode::Exact)
+        .value("Binary", Chunk::SearchMode::Binary)
+        .export_values();
+
+    py::enum_<Chunk::Fusion>(m, "Fusion")
+        .value("RRF", Chunk::Fusion::RRF)
+        .value("Weighted", Chunk::Fusion::Weighted)
+        .export_values();
+
     py::class_<Chunk::ChunkQuery>(m, "ChunkQuery")
         .def(py::init<
             std::string,
@@ -645,7 +826,8 @@ void bind_ChunkQuery(py::module_& m) {
             py::arg("query_doc") = RAGLibrary::Document(),
             py::arg("chunks") = nullptr,
             py::arg("pos") = std::nullopt,
-            py::arg("threshold") = -5
+            py::arg("threshold") = -5,
+            py::call_guard<py::gil_scoped_release>()
         )
 
         .def("Query", 
@@ -656,7 +838,8 @@ void bind_ChunkQuery(py::module_& m) {
             >(&Chunk::ChunkQuery::Query),
             py::arg("query"),
             py::arg("chunks") = nullptr,
-            py::arg("pos") = std::nullopt
+            py::arg("pos") = std::nullopt,
+            py::call_guard<py::gil_scoped_release>()
         )
 
         .def("Query", 
@@ -667,13 +850,70 @@ void bind_ChunkQuery(py::module_& m) {
             >(&Chunk::ChunkQuery::Query),
             py::arg("query_doc"),
             py::arg("chunks") = nullptr,
-            py::arg("pos") = std::nullopt
+            py::arg("pos") = std::nullopt,
+            py::call_guard<py::gil_scoped_release>()
         )
 
-        .def("Retrieve", &Chunk::ChunkQuery::Retrieve,
+        .def("setRerank", &Chunk::ChunkQuery::setRerank,
+            py::arg("factor"),
+            "For quantized stores, re-scores the k * factor best hits against the kept float copy (0 disables).")
+        .def("getRerank", &Chunk::ChunkQuery::getRerank)
+        .def("setSearchMode", &Chunk::ChunkQuery::setSearchMode,
+            py::arg("mode"),
+            py::arg("candidates") = 10,
+            "Binary: Hamming scan over the sign codes, then cosine re-ranking of k * candidates hits.")
+        .def("getSearchMode", &Chunk::ChunkQuery::getSearchMode)
+        .def("setFilter", &Chunk::ChunkQuery::setFilter,
+            py::arg("filter"),
+            "Restricts Retrieve/RetrieveBatch to chunks whose metadata matches every key/value pair.")
+        .def("clearFilter", &Chunk::ChunkQuery::clearFilter)
+        .def("getFilter", &Chunk::ChunkQuery::getFilter)
+        .def("RetrieveHybrid", &Chunk::ChunkQuery::RetrieveHybrid,
+            py::arg("k"),
+            py::arg("fusion") = Chunk::Fusion::RRF,
+            py::arg("weight") = 0.5f,
+            py::arg("depth") = 0,
+            py::call_guard<py::gil_scoped_release>(),
+            "Fuses vector and BM25 retrieval of the current query (RRF or weighted sum); returns top-k (index, score).")
+
+        .def("QueryBatch", &Chunk::ChunkQuery::QueryBatch,
+            py::arg("queries"),
+            py::arg("chunks") = nullptr,
+            py::arg("pos") = std::nullopt,
+            py::call_guard<py::gil_scoped_release>(),
+            "Embeds a batch of queries with a single embedding request.")
+
+        .def("RetrieveBatch", &Chunk::ChunkQuery::RetrieveBatch,
+            py::arg("k"),
+            py::arg("threshold") = -1.0f,
+            py::call_guard<py::gil_scoped_release>(),
+            "Scores the QueryBatch queries against the store in one blocked matrix product; returns top-k (index, score) per query.")
+
+        .def("RetrieveTopK",
+            py::overload_cast<
+                size_t,
+                float,
+                const Chunk::ChunkDefault*,
+                std::optional<size_t>
+            >(&Chunk::ChunkQuery::Retrieve),
+            py::arg("k"),
+            py::arg("threshold") = -1.0f,
+            py::arg("chunks") = nullptr,
+            py::arg("pos") = std::nullopt,
+            py::call_guard<py::gil_scoped_release>(),
+            "Returns the k best (index, score) pairs above threshold; use getChunkText(index) for the text."
+        )
+
+        .def("Retrieve",
+            py::overload_cast<
+                float,
+                const Chunk::ChunkDefault*,
+                std::optional<size_t>
+            >(&Chunk::ChunkQuery::Retrieve),
             py::arg("threshold") = 0.5f,
             py::arg("chunks") = nullptr,
-            py::arg("pos") = std::nullopt
+            py::arg("pos") = std::nullopt,
+            py::call_guard<py::gil_scoped_release>()
         )
 
         .def("getQuery", &Chunk::ChunkQuery::getQuery)
@@ -683,11 +923,13 @@ void bind_ChunkQuery(py::module_& m) {
             py::return_value_policy::reference)
 
         .def("getRetrieveList", &Chunk::ChunkQuery::getRetrieveList)
+        .def("getChunkText", &Chunk::ChunkQuery::getChunkText, py::arg("index"))
         .def("strQ", &Chunk::ChunkQuery::StrQ, py::arg("index") = -1)
 
         .def("setChunks", &Chunk::ChunkQuery::setChunks,
         py::arg("chunks"),
         py::arg("pos") = 0,
+        py::call_guard<py::gil_scoped_release>(),
         "Configures the chunk structure and prepares spans for retrieval")
 
         ;
@@ -701,9 +943,11 @@ void bind_ContentCleaner(py::module& m)
     py::class_<CleanData::ContentCleaner>(m, "ContentCleaner")
         .def(py::init<const std::vector<std::string> &>(), py::arg("default_patterns") = std::vector<std::string>{})
         .def("ProcessDocument", &CleanData::ContentCleaner::ProcessDocument,
-            py::arg("doc"), py::arg("custom_patterns") = std::vector<std::string>{})
+            py::arg("doc"), py::arg("custom_patterns") = std::vector<std::string>{},
+            py::call_guard<py::gil_scoped_release>())
         .def("ProcessDocuments", &CleanData::ContentCleaner::ProcessDocuments,
-            py::arg("docs"), py::arg("custom_patterns") = std::vector<std::string>{}, py::arg("max_workers") = 4);
+            py::arg("docs"), py::arg("custom_patterns") = std::vector<std::string>{}, py::arg("max_workers") = 4,
+            py::call_guard<py::gil_scoped_release>());
 }
 
 
@@ -745,11 +989,37 @@ void bind_WebLoader(py::module& m)
             "Creates a WebLoader with optional URLs and a defined number of threads.");
 }
  
+// Maps every UTF-8 byte offset of `text` (0..size) to the number of code
+// points before it, so C++ byte offsets can be handed to Python as str indices.
+static std::vector<size_t> CodePointOffsets(std::string_view text)
+{
+    std::vector<size_t> offsets(text.size() + 1);
+    size_t code_points = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        offsets[i] = code_points;
+        if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80)
+            ++code_points;
+    }
+    offsets[text.size()] = code_points;
+    return offsets;
+}
+
 // --------------------------------------------------------------------------
 // Binding for MetadataExtractor::Document
 // --------------------------------------------------------------------------
 void bind_Document(py::module& m)
 {
+    py::class_<::MetadataExtractor::MetadataSpan>(m, "MetadataSpan")
+        .def_readonly("name", &::MetadataExtractor::MetadataSpan::name)
+        .def_readonly("page", &::MetadataExtractor::MetadataSpan::page)
+        .def_readonly("begin", &::MetadataExtractor::MetadataSpan::begin)
+        .def_readonly("end", &::MetadataExtractor::MetadataSpan::end)
+        .def("__repr__", [](const ::MetadataExtractor::MetadataSpan& span) {
+            return "<MetadataSpan " + span.name + " page " + std::to_string(span.page) +
+                   " [" + std::to_string(span.begin) + ", " + std::to_string(span.end) + ")>";
+        });
+
     py::class_<::MetadataExtractor::Document>(m, "Document")
         .def(
             py::init<
@@ -770,6 +1040,24 @@ void bind_Document(py::module& m)
         .def_readwrite("metadata", &::MetadataExtractor::Document::metadata, R"doc(
                 Document metadata, stored as key-value pairs.
             )doc")
+        .def_property_readonly("spans", [](const ::MetadataExtractor::Document& doc) {
+            std::vector<::MetadataExtractor::MetadataSpan> spans;
+            spans.reserve(doc.spans.size());
+            std::vector<std::vector<size_t>> offsets(doc.pageContent.size());
+            for (const auto& span : doc.spans)
+            {
+                if (span.page >= doc.pageContent.size() || span.end > doc.pageContent[span.page].size())
+                    throw RAGLibrary::RagException("Document span is out of range of its page.");
+                auto& page_offsets = offsets[span.page];
+                if (page_offsets.empty())
+                    page_offsets = CodePointOffsets(doc.pageContent[span.page]);
+                spans.push_back({span.name, span.page, page_offsets[span.begin], page_offsets[span.end]});
+            }
+            return spans;
+        }, R"doc(
+                Positions of extracted metadata as MetadataSpan(name, page, begin, end),
+                with code-point offsets: doc.pageContent[s.page][s.begin:s.end] is the match.
+            )doc")
         .def("StringRepr", &::MetadataExtractor::Document::StringRepr,
             R"doc(
                 Returns a string representation that lists each metadata item contained in the document.
@@ -790,7 +1078,7 @@ public:
             doc);
     }
 
-    std::vector<::MetadataExtractor::Document> ProcessDocuments(std::vector<::MetadataExtractor::Document> docs, const int& maxWorkers) override
+    std::vector<::MetadataExtractor::Document> ProcessDocuments(const std::vector<::MetadataExtractor::Document>& docs, const int& maxWorkers) override
     {
         PYBIND11_OVERRIDE_PURE(
             std::vector<::MetadataExtractor::Document>,
@@ -805,7 +1093,7 @@ void bind_IMetadataExtractor(py::module& m)
     py::class_<MetadataExtractor::IMetadataExtractor, PyIMetadataExtractor, MetadataExtractor::IMetadataExtractorPtr>(m, "IMetadataExtractor")
         .def(py::init<>())
         .def("ProcessDocument", &MetadataExtractor::IMetadataExtractor::ProcessDocument, py::arg("doc"))
-        .def("ProcessDocuments", &MetadataExtractor::IMetadataExtractor::ProcessDocuments, py::arg("docs"), py::arg("maxWorkers"));
+        .def("ProcessDocuments", &MetadataExtractor::IMetadataExtractor::ProcessDocuments, py::call_guard<py::gil_scoped_release>(), py::arg("docs"), py::arg("maxWorkers"));
 }
 // --------------------------------------------------------------------------
 // Binding for MetadataExtractor::MetadataExtractor
@@ -825,7 +1113,7 @@ public:
         );
     }
 
-    std::vector<::MetadataExtractor::Document> ProcessDocuments(std::vector<::MetadataExtractor::Document> docs, const int& maxWorkers) override
+    std::vector<::MetadataExtractor::Document> ProcessDocuments(const std::vector<::MetadataExtractor::Document>& docs, const int& maxWorkers) override
     {
         PYBIND11_OVERRIDE(
             std::vector<::MetadataExtractor::Document>, // Return type
@@ -864,11 +1152,13 @@ void bind_MetadataExtractor(py::module& m)
         .def(
             "ProcessDocuments",
             &MetadataExtractor::MetadataExtractor::ProcessDocuments,
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("docs"),
             py::arg("maxWorkers") = 4,
             R"doc(
-            Processes metadata from multiple documents, with support for parallelism.
-            By default, it uses up to 4 threads (maxWorkers=4).
+            Processes metadata from multiple documents on a shared thread pool,
+            using up to maxWorkers threads (default=4). Results keep the input
+            order; the first exception raised by ProcessDocument is re-raised.
         )doc");
 }
 
@@ -976,11 +1266,34 @@ void bind_IMetadataHFExtractor(py::module& m)
 
 void bind_MetadataRegexExtractor(py::module& m)
 {
+    py::class_<MetadataRegexExtractor::MetadataRegexExtractor::Match>(m, "RegexMatch")
+        .def_readonly("name", &MetadataRegexExtractor::MetadataRegexExtractor::Match::name)
+        .def_readonly("begin", &MetadataRegexExtractor::MetadataRegexExtractor::Match::begin)
+        .def_readonly("end", &MetadataRegexExtractor::MetadataRegexExtractor::Match::end)
+        .def("__repr__", [](const MetadataRegexExtractor::MetadataRegexExtractor::Match& match) {
+            return "<RegexMatch " + match.name + " [" + std::to_string(match.begin) + ", " + std::to_string(match.end) + ")>";
+        });
+
     py::class_<MetadataRegexExtractor::MetadataRegexExtractor, std::shared_ptr<MetadataRegexExtractor::MetadataRegexExtractor>, ::MetadataExtractor::MetadataExtractor, MetadataRegexExtractor::IMetadataRegexExtractor>(m, "MetadataRegexExtractor")
         .def(py::init<>())
         .def("AddPattern", &MetadataRegexExtractor::MetadataRegexExtractor::AddPattern, py::arg("name"), py::arg("pattern"))
+        .def("FindMatches", [](const MetadataRegexExtractor::MetadataRegexExtractor& self, std::string_view text) {
+            auto matches = self.FindMatches(text);
+            const auto offsets = CodePointOffsets(text);
+            for (auto& match : matches)
+            {
+                match.begin = offsets[match.begin];
+                match.end = offsets[match.end];
+            }
+            return matches;
+        }, py::arg("text"),
+             R"doc(
+            Returns every match of the registered patterns in `text` as
+            RegexMatch(name, begin, end), ordered by offset. Offsets count code
+            points, so text[m.begin:m.end] is the matched text.
+        )doc")
         .def("ProcessDocument", &MetadataRegexExtractor::MetadataRegexExtractor::ProcessDocument, py::arg("doc"))
-        .def("ProcessDocuments", &MetadataRegexExtractor::MetadataRegexExtractor::ProcessDocuments, py::arg("docs"), py::arg("maxWorkers"));
+        .def("ProcessDocuments", &MetadataRegexExtractor::MetadataRegexExtractor::ProcessDocuments, py::call_guard<py::gil_scoped_release>(), py::arg("docs"), py::arg("maxWorkers"));
 }
 
 // --------------------------------------------------------------------------
@@ -999,10 +1312,25 @@ void bind_MetadataHFExtractor(py::module& m)
             via ONNXRuntime and tokenization libraries (HuggingFace tokenizers).
         )doc")
         .def(
-            py::init<>(),
+            py::init<size_t, size_t, size_t, size_t>(),
+            py::arg("maxLength") = 512,
+            py::arg("stride") = 128,
+            py::arg("batchSize") = 8,
+            py::arg("intraOpThreads") = 0,
             R"doc(
-            Default constructor that configures the ONNXRuntime environment, sessions, and 
-            tokenizers needed for metadata extraction.
+            Constructor that configures how texts are fed to the NER model.
+            The model itself is loaded by InitializeNERModel.
+
+            Parameters:
+                maxLength (int): Tokens per model window, special tokens
+                    included (default=512).
+                stride (int): Tokens shared by neighbouring windows of a long
+                    text (default=128).
+                batchSize (int): Windows per inference run (default=8).
+                intraOpThreads (int): ONNXRuntime threads per inference run;
+                    0 uses one per hardware thread (default=0). Batches only
+                    run concurrently while their threads fit in the hardware,
+                    so pass 1 to spread maxWorkers batches over the cores.
         )doc")
         .def(
             "InitializeNERModel",
@@ -1014,6 +1342,7 @@ void bind_MetadataHFExtractor(py::module& m)
         .def(
             "ExtractMetadata",
             &MetadataHFExtractor::MetadataHFExtractor::ExtractMetadata,
+            py::call_guard<py::gil_scoped_release>(),
             py::arg("text"),
             R"doc(
             Executes metadata extraction (named entities) on one or more
@@ -1023,7 +1352,26 @@ void bind_MetadataHFExtractor(py::module& m)
                 text (list[str]): List of strings to be processed.
 
             Returns:
-                list[tuple[str, str]]: Each element is a (token, entity) pair.
+                list[tuple[str, str]]: Each element is an (entity text, entity
+                type) pair, e.g. ("Barack Obama", "PER"), in text order.
+        )doc")
+        .def(
+            "ExtractMetadataBatch",
+            &MetadataHFExtractor::MetadataHFExtractor::ExtractMetadataBatch,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("texts"),
+            py::arg("maxWorkers") = 1,
+            R"doc(
+            Same as ExtractMetadata for several documents at once. The windows
+            of all documents share inference batches.
+
+            Parameters:
+                texts (list[list[str]]): Pages of each document.
+                maxWorkers (int): Batches run concurrently (default=1), at
+                    most hardware threads / intraOpThreads.
+
+            Returns:
+                list[list[tuple[str, str]]]: Entities of each document.
         )doc")
         .def(
             "ProcessDocument",
@@ -1040,6 +1388,16 @@ void bind_MetadataHFExtractor(py::module& m)
             Returns:
                 MetadataExtractor.Document: Document with named entities
                 added to its metadata set.
+        )doc")
+        .def(
+            "ProcessDocuments",
+            &MetadataHFExtractor::MetadataHFExtractor::ProcessDocuments,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("docs"),
+            py::arg("maxWorkers") = 4,
+            R"doc(
+            Processes several documents with batched inference and returns
+            them in input order. Up to maxWorkers batches run concurrently.
         )doc");
 }
 // --------------------------------------------------------------------------
@@ -1386,6 +1744,7 @@ PYBIND11_MODULE(RagPUREAI, m)
     bind_RagException(m);
     bind_FileUtilsLocal(m);
     bind_StringUtils(m);
+    bind_Tracing(m);
 
     bind_CommonStructs(m);
 